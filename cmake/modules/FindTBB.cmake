@@ -283,23 +283,38 @@ if(NOT TBB_FOUND)
     add_library(tbb UNKNOWN IMPORTED)
     set_target_properties(tbb PROPERTIES
           INTERFACE_INCLUDE_DIRECTORIES  ${TBB_INCLUDE_DIRS}
-          IMPORTED_LOCATION              ${TBB_LIBRARIES})
-    if(TBB_LIBRARIES_RELEASE AND TBB_LIBRARIES_DEBUG)
+          IMPORTED_LOCATION              ${TBB_tbb_LIBRARY})
+    if(TBB_tbb_LIBRARY_RELEASE AND TBB_tbb_LIBRARY_DEBUG)
       set_target_properties(tbb PROPERTIES
           INTERFACE_COMPILE_DEFINITIONS "$<$<OR:$<CONFIG:Debug>,$<CONFIG:RelWithDebInfo>>:TBB_USE_DEBUG=1>"
-          IMPORTED_LOCATION_DEBUG          ${TBB_LIBRARIES_DEBUG}
-          IMPORTED_LOCATION_RELWITHDEBINFO ${TBB_LIBRARIES_RELEASE}
-          IMPORTED_LOCATION_RELEASE        ${TBB_LIBRARIES_RELEASE}
-          IMPORTED_LOCATION_MINSIZEREL     ${TBB_LIBRARIES_RELEASE}
+          IMPORTED_LOCATION_DEBUG          ${TBB_tbb_LIBRARY_DEBUG}
+          IMPORTED_LOCATION_RELWITHDEBINFO ${TBB_tbb_LIBRARY_RELEASE}
+          IMPORTED_LOCATION_RELEASE        ${TBB_tbb_LIBRARY_RELEASE}
+          IMPORTED_LOCATION_MINSIZEREL     ${TBB_tbb_LIBRARY_RELEASE}
           )
-    elseif(TBB_LIBRARIES_RELEASE)
-      set_target_properties(tbb PROPERTIES IMPORTED_LOCATION ${TBB_LIBRARIES_RELEASE})
+    elseif(TBB_tbb_LIBRARY_RELEASE)
+      set_target_properties(tbb PROPERTIES IMPORTED_LOCATION ${TBB_tbb_LIBRARY_RELEASE})
     else()
       set_target_properties(tbb PROPERTIES
           INTERFACE_COMPILE_DEFINITIONS "${TBB_DEFINITIONS_DEBUG}"
-          IMPORTED_LOCATION              ${TBB_LIBRARIES_DEBUG}
+          IMPORTED_LOCATION              ${TBB_tbb_LIBRARY_DEBUG}
           )
     endif()
+    # The tbbmalloc component, if requested.
+    if(TBB_tbbmalloc_FOUND)
+      add_library(tbbmalloc UNKNOWN IMPORTED)
+      set_target_properties(tbbmalloc PROPERTIES
+          INTERFACE_INCLUDE_DIRECTORIES  ${TBB_INCLUDE_DIRS}
+          IMPORTED_LOCATION              ${TBB_tbbmalloc_LIBRARY})
+      if(TBB_tbbmalloc_LIBRARY_RELEASE AND TBB_tbbmalloc_LIBRARY_DEBUG)
+        set_target_properties(tbbmalloc PROPERTIES
+            IMPORTED_LOCATION_DEBUG          ${TBB_tbbmalloc_LIBRARY_DEBUG}
+            IMPORTED_LOCATION_RELWITHDEBINFO ${TBB_tbbmalloc_LIBRARY_RELEASE}
+            IMPORTED_LOCATION_RELEASE        ${TBB_tbbmalloc_LIBRARY_RELEASE}
+            IMPORTED_LOCATION_MINSIZEREL     ${TBB_tbbmalloc_LIBRARY_RELEASE}
+            )
+      endif()
+    endif()
   endif()
 
   mark_as_advanced(TBB_INCLUDE_DIRS TBB_LIBRARIES)
@@ -0,0 +1,166 @@
+#include <iostream>
+#include <iomanip>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/TriangleMesh.hpp>
+#include <libslic3r/ClipperUtils.hpp>
+#include <libnest2d/tools/benchmark.h>
+
+// Count the heap allocations of the whole process.
+static std::atomic<size_t> g_num_allocations(0);
+
+void* operator new(std::size_t size)
+{
+    ++ g_num_allocations;
+    if (void *ptr = std::malloc(size == 0 ? 1 : size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+
+const std::string USAGE_STR = {
+    "Usage: clipperbench stlfilename.stl [layer_height=0.2] [extrusion_width=0.45]"
+};
+
+using namespace Slic3r;
+
+namespace Slic3r {
+    // Not exported by ClipperUtils.hpp.
+    void scaleClipperPolygons(ClipperLib::Paths &polygons);
+    void unscaleClipperPolygons(ClipperLib::Paths &polygons);
+}
+
+// The former way of running a Clipper operation: a fresh engine for each call and conversions without reserving the memory.
+static ClipperLib::Paths fresh_engine_paths(const Polygons &polygons)
+{
+    ClipperLib::Paths out;
+    for (const Polygon &polygon : polygons) {
+        ClipperLib::Path path;
+        for (const Point &pt : polygon.points)
+            path.push_back(ClipperLib::IntPoint(pt(0), pt(1)));
+        out.push_back(path);
+    }
+    return out;
+}
+
+static ExPolygons fresh_engine_diff_ex(const Polygons &subject, const Polygons &clip)
+{
+    ClipperLib::Clipper clipper;
+    clipper.AddPaths(fresh_engine_paths(subject), ClipperLib::ptSubject, true);
+    clipper.AddPaths(fresh_engine_paths(clip), ClipperLib::ptClip, true);
+    ClipperLib::Paths output;
+    clipper.Execute(ClipperLib::ctDifference, output, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
+    ClipperLib::Clipper clipper2;
+    clipper2.AddPaths(output, ClipperLib::ptSubject, true);
+    ClipperLib::PolyTree polytree;
+    clipper2.Execute(ClipperLib::ctUnion, polytree, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
+    ExPolygons out;
+    PolyTreeToExPolygons(polytree, out);
+    return out;
+}
+
+static Polygons fresh_engine_offset(const Polygons &polygons, float delta)
+{
+    ClipperLib::Paths input = fresh_engine_paths(polygons);
+    scaleClipperPolygons(input);
+    ClipperLib::ClipperOffset co;
+    co.MiterLimit = 3.;
+    co.AddPaths(input, ClipperLib::jtMiter, ClipperLib::etClosedPolygon);
+    ClipperLib::Paths output;
+    co.Execute(output, delta * float(CLIPPER_OFFSET_SCALE));
+    unscaleClipperPolygons(output);
+    Polygons out;
+    for (const ClipperLib::Path &path : output) {
+        Polygon polygon;
+        for (const ClipperLib::IntPoint &pt : path)
+            polygon.points.push_back(Point(pt.X, pt.Y));
+        out.push_back(polygon);
+    }
+    return out;
+}
+
+struct Result {
+    double seconds     = 0.;
+    size_t allocations = 0;
+    size_t operations  = 0;
+};
+
+template<typename Fn> static Result run(const std::vector<Polygons> &layers, Fn fn)
+{
+    Result result;
+    Benchmark bench;
+    size_t allocations = g_num_allocations;
+    bench.start();
+    for (size_t i = 1; i < layers.size(); ++ i)
+        result.operations += fn(layers[i - 1], layers[i]);
+    bench.stop();
+    result.seconds     = bench.getElapsedSec();
+    result.allocations = g_num_allocations - allocations;
+    return result;
+}
+
+static void report(const char *name, const Result &result)
+{
+    std::cout << std::setw(24) << std::left << name << std::right
+              << " time: " << std::setw(10) << std::setprecision(4) << result.seconds << " s"
+              << ", allocations per operation: " << std::setw(10) << std::setprecision(6) << double(result.allocations) / double(std::max<size_t>(1, result.operations))
+              << std::endl;
+}
+
+int main(const int argc, const char *argv[])
+{
+    if (argc < 2) {
+        std::cout << USAGE_STR << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    const float layer_height    = argc > 2 ? float(atof(argv[2])) : 0.2f;
+    const float extrusion_width = argc > 3 ? float(atof(argv[3])) : 0.45f;
+    const float delta           = - float(scale_(0.5 * extrusion_width));
+
+    TriangleMesh model;
+    model.ReadSTLFile(argv[1]);
+    model.repair();
+    model.align_to_origin();
+
+    const BoundingBoxf3 bb = model.bounding_box();
+    std::vector<float> z;
+    for (float slice_z = 0.5f * layer_height; slice_z < bb.max.z(); slice_z += layer_height)
+        z.emplace_back(slice_z);
+
+    // The representative layers: contours of the sliced model.
+    std::vector<Polygons> layers;
+    {
+        TriangleMeshSlicer slicer(&model);
+        slicer.slice(z, &layers, [](){});
+    }
+    std::cout << "Layers: " << layers.size() << std::endl;
+
+    // Perimeter like offsets and the difference of neighbor layers as used for detecting the overhangs and top / bottom surfaces.
+    auto pooled_offset = [delta](const Polygons &, const Polygons &layer) { offset(layer, delta); return size_t(1); };
+    auto fresh_offset  = [delta](const Polygons &, const Polygons &layer) { fresh_engine_offset(layer, delta); return size_t(1); };
+    auto pooled_diff   = [](const Polygons &below, const Polygons &layer) { diff_ex(layer, below); return size_t(1); };
+    auto fresh_diff    = [](const Polygons &below, const Polygons &layer) { fresh_engine_diff_ex(layer, below); return size_t(1); };
+
+    // Run the operations twice, the first run warms up the per thread engines.
+    for (int i = 0; i < 2; ++ i) {
+        Result r_fresh_offset  = run(layers, fresh_offset);
+        Result r_pooled_offset = run(layers, pooled_offset);
+        Result r_fresh_diff    = run(layers, fresh_diff);
+        Result r_pooled_diff   = run(layers, pooled_diff);
+        if (i == 1) {
+            report("offset, fresh engine",  r_fresh_offset);
+            report("offset, thread engine", r_pooled_offset);
+            report("diff_ex, fresh engine", r_fresh_diff);
+            report("diff_ex, thread engine", r_pooled_diff);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,108 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/GCodeReader.hpp>
+#include <libnest2d/tools/benchmark.h>
+
+const std::string USAGE_STR = {
+    "Usage: gcodebench gcodefile.gcode [repeats=3]"
+};
+
+using namespace Slic3r;
+
+// Sum of the parsed values, so that the parsing is not optimized out and the results of the parsers could be compared.
+struct Checksum {
+    size_t lines = 0;
+    double sum   = 0.;
+
+    void add(const GCodeReader &reader, const GCodeReader::GCodeLine &line) {
+        ++ lines;
+        sum += line.raw().size() + reader.x() + reader.y() + reader.z() + reader.e() + reader.f();
+        if (line.has_e())
+            sum += line.e();
+    }
+    bool operator==(const Checksum &rhs) const { return lines == rhs.lines && sum == rhs.sum; }
+};
+
+template<typename Fn> static double run(size_t repeats, Fn fn)
+{
+    double best = std::numeric_limits<double>::max();
+    for (size_t i = 0; i < repeats; ++ i) {
+        Benchmark bench;
+        bench.start();
+        fn();
+        bench.stop();
+        best = std::min(best, bench.getElapsedSec());
+    }
+    return best;
+}
+
+static void report(const char *name, double seconds, size_t file_size)
+{
+    std::cout << std::setw(24) << std::left << name << std::right
+              << " time: " << std::setw(10) << std::setprecision(4) << seconds << " s"
+              << ", throughput: " << std::setw(10) << std::setprecision(4) << double(file_size) / (1024. * 1024. * seconds) << " MB/s"
+              << std::endl;
+}
+
+int main(const int argc, const char *argv[])
+{
+    if (argc < 2) {
+        std::cout << USAGE_STR << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    const std::string path    = argv[1];
+    const size_t      repeats = argc > 2 ? size_t(std::max(1, atoi(argv[2]))) : 3;
+    const size_t      size    = size_t(boost::filesystem::file_size(path));
+    std::cout << "File size: " << size << " bytes" << std::endl;
+
+    // The former GCodeReader::parse_file(): a line by line std::getline() and a GCodeLine for each line.
+    Checksum checksum_getline;
+    double   t_getline = run(repeats, [&path, &checksum_getline]() {
+        checksum_getline = Checksum();
+        GCodeReader reader;
+        std::ifstream f(path);
+        std::string line;
+        while (std::getline(f, line))
+            reader.parse_line(line, [&checksum_getline](GCodeReader &reader, const GCodeReader::GCodeLine &line) { checksum_getline.add(reader, line); });
+    });
+
+    // Memory mapped file decoded in parallel, replayed through the callback API.
+    Checksum checksum_mmap;
+    double   t_mmap = run(repeats, [&path, &checksum_mmap]() {
+        checksum_mmap = Checksum();
+        GCodeReader reader;
+        reader.parse_file(path, [&checksum_mmap](GCodeReader &reader, const GCodeReader::GCodeLine &line) { checksum_mmap.add(reader, line); });
+    });
+
+    // Decoding of an in memory buffer into the flat array of lines only.
+    std::string buffer;
+    {
+        std::ifstream f(path, std::ios::in | std::ios::binary);
+        buffer.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    }
+    size_t num_decoded = 0;
+    double t_decode = run(repeats, [&buffer, &num_decoded]() {
+        GCodeReader reader;
+        GCodeReader::DecodedLines lines;
+        reader.decode_buffer(buffer.c_str(), buffer.c_str() + buffer.size(), lines);
+        num_decoded = lines.size();
+    });
+
+    std::cout << "Lines: " << checksum_getline.lines << std::endl;
+    report("getline, parse_line", t_getline, size);
+    report("parse_file", t_mmap, size);
+    report("decode_buffer", t_decode, size);
+
+    if (! (checksum_getline == checksum_mmap) || num_decoded != checksum_getline.lines) {
+        std::cout << "The parsers do not produce the same result!" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,62 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <tbb/task_scheduler_init.h>
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/TriangleMesh.hpp>
+#include <libnest2d/tools/benchmark.h>
+
+const std::string USAGE_STR = {
+    "Usage: slicebench stlfilename.stl [layer_height=0.05] [max_threads=hardware concurrency]"
+};
+
+int main(const int argc, const char *argv[]) {
+    using namespace Slic3r;
+    using std::cout; using std::endl;
+
+    if(argc < 2) {
+        cout << USAGE_STR << endl;
+        return EXIT_SUCCESS;
+    }
+
+    const float layer_height = argc > 2 ? float(atof(argv[2])) : 0.05f;
+    const int   max_threads  = argc > 3 ? atoi(argv[3]) : tbb::task_scheduler_init::default_num_threads();
+
+    TriangleMesh model;
+    model.ReadSTLFile(argv[1]);
+    model.repair();
+    model.align_to_origin();
+
+    const BoundingBoxf3 bb = model.bounding_box();
+    std::vector<float> z;
+    for (float slice_z = 0.5f * layer_height; slice_z < bb.max.z(); slice_z += layer_height)
+        z.emplace_back(slice_z);
+
+    TriangleMeshSlicer slicer(&model);
+    const size_t num_facets = size_t(model.stl.stats.number_of_facets);
+
+    // Benchmark with 1, 2, 4 ... threads up to max_threads.
+    std::vector<int> thread_counts;
+    for (int threads = 1; threads < max_threads; threads *= 2)
+        thread_counts.emplace_back(threads);
+    thread_counts.emplace_back(std::max(1, max_threads));
+
+    cout << "Facets: " << num_facets << ", layers: " << z.size() << endl;
+    for (int threads : thread_counts) {
+        tbb::task_scheduler_init scheduler(threads);
+        std::vector<Polygons> layers;
+        Benchmark bench;
+        bench.start();
+        slicer.slice(z, &layers, [](){});
+        bench.stop();
+        cout << "Threads: " << std::setw(3) << threads
+             << ", slicing time: " << std::setprecision(6) << bench.getElapsedSec() << " s"
+             << ", facets/s: " << std::setprecision(10) << double(num_facets) / bench.getElapsedSec() << endl;
+    }
+
+    return EXIT_SUCCESS;
+}
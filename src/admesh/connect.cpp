@@ -28,6 +28,11 @@
 #include <algorithm>
 #include <vector>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
+#include <tbb/parallel_sort.h>
+
 #include <boost/detail/endian.hpp>
 
 #include "stl.h"
@@ -37,8 +42,10 @@ static void stl_match_neighbors_nearby(stl_file *stl,
                                        stl_hash_edge *edge_a, stl_hash_edge *edge_b);
 static void stl_record_neighbors(stl_file *stl,
                                  stl_hash_edge *edge_a, stl_hash_edge *edge_b);
-static void stl_initialize_facet_check_exact(stl_file *stl);
 static void stl_initialize_facet_check_nearby(stl_file *stl);
+static bool stl_edge_key_exact(uint32_t key[6], const stl_vertex *a, const stl_vertex *b);
+static void stl_link_neighbors(stl_file *stl, int facet_a, int which_edge_a, int facet_b, int which_edge_b);
+static void stl_count_connected_facets(stl_file *stl);
 static void stl_load_edge_exact(stl_file *stl, stl_hash_edge *edge,
                                 stl_vertex *a, stl_vertex *b);
 static int stl_load_edge_nearby(stl_file *stl, stl_hash_edge *edge,
@@ -61,78 +68,135 @@ extern int stl_check_normal_vector(stl_file *stl,
 static void stl_update_connects_remove_1(stl_file *stl, int facet_num);
 
 
+// Edge of a facet for the sort based matching of stl_check_facets_exact().
+struct stl_exact_edge {
+  // Sorted vertices of the edge, see stl_edge_key_exact().
+  uint32_t key[6];
+  int      facet_number;
+  // Index of this edge inside the facet, increased by 3 if the edge is stored backwards.
+  int      which_edge;
+  // Edges with equal keys are ordered the way the former hash table received them, so that they are paired
+  // identically: first with second, third with fourth and so on.
+  bool operator<(const stl_exact_edge &rhs) const {
+    int cmp = memcmp(key, rhs.key, sizeof(key));
+    return (cmp != 0) ? (cmp < 0) :
+           (facet_number != rhs.facet_number) ? (facet_number < rhs.facet_number) :
+           (which_edge % 3 < rhs.which_edge % 3);
+  }
+  bool same_key(const stl_exact_edge &rhs) const { return memcmp(key, rhs.key, sizeof(key)) == 0; }
+};
+
 void
 stl_check_facets_exact(stl_file *stl) {
   /* This function builds the neighbors list.  No modifications are made
    *  to any of the facets.  The edges are said to match only if all six
    *  floats of the first edge matches all six floats of the second edge.
+   *  Instead of inserting the edges into a chained hash table one by one,
+   *  the edges are sorted by their keys in parallel and the runs of equal keys are paired.
    */
 
-  stl_hash_edge  edge;
-  stl_facet      facet;
-  int            i;
-  int            j;
-
   if (stl->error) return;
 
   stl->stats.connected_edges = 0;
   stl->stats.connected_facets_1_edge = 0;
   stl->stats.connected_facets_2_edge = 0;
   stl->stats.connected_facets_3_edge = 0;
+  stl->stats.malloced = 0;
+  stl->stats.freed = 0;
+  stl->stats.collisions = 0;
 
-  stl_initialize_facet_check_exact(stl);
+  /* initialize neighbors list to -1 to mark unconnected edges */
+  tbb::parallel_for(tbb::blocked_range<int>(0, stl->stats.number_of_facets, 65536),
+    [stl](const tbb::blocked_range<int> &range) {
+      for (int i = range.begin(); i < range.end(); ++ i) {
+        stl->neighbors_start[i].neighbor[0] = -1;
+        stl->neighbors_start[i].neighbor[1] = -1;
+        stl->neighbors_start[i].neighbor[2] = -1;
+      }
+    });
 
-  for(i = 0; i < stl->stats.number_of_facets; i++) {
-    facet = stl->facet_start[i];
-    // If any two of the three vertices are found to be exactally the same, call them degenerate and remove the facet.
+  // If any two of the three vertices are found to be exactally the same, call them degenerate and remove the facet.
+  // Removing them before matching the edges leaves the remaining facets in the same order
+  // as removing them one by one while matching.
+  for (uint32_t i = 0; i < stl->stats.number_of_facets;) {
+    const stl_facet &facet = stl->facet_start[i];
     if (facet.vertex[0] == facet.vertex[1] ||
         facet.vertex[1] == facet.vertex[2] ||
         facet.vertex[0] == facet.vertex[2]) {
       stl->stats.degenerate_facets += 1;
+      // The last facet is moved to i, check it next.
       stl_remove_facet(stl, i);
-      -- i;
-      continue;
-    }
-    for(j = 0; j < 3; j++) {
-      edge.facet_number = i;
-      edge.which_edge = j;
-      stl_load_edge_exact(stl, &edge, &facet.vertex[j], &facet.vertex[(j + 1) % 3]);
-      insert_hash_edge(stl, edge, stl_record_neighbors);
-    }
-  }
-  stl_free_edges(stl);
+    } else
+      ++ i;
+  }
+
+  // Load the edges of all facets in parallel, reduce the shortest edge.
+  const int num_facets = stl->stats.number_of_facets;
+  std::vector<stl_exact_edge> edges(size_t(num_facets) * 3);
+  stl->stats.shortest_edge = tbb::parallel_reduce(
+    tbb::blocked_range<int>(0, num_facets, 16384), stl->stats.shortest_edge,
+    [stl, &edges](const tbb::blocked_range<int> &range, float shortest_edge) {
+      for (int i = range.begin(); i < range.end(); ++ i) {
+        const stl_facet &facet = stl->facet_start[i];
+        for (int j = 0; j < 3; ++ j) {
+          const stl_vertex &a = facet.vertex[j];
+          const stl_vertex &b = facet.vertex[(j + 1) % 3];
+          stl_vertex diff = (a - b).cwiseAbs();
+          shortest_edge = std::min(shortest_edge, std::max(diff(0), std::max(diff(1), diff(2))));
+          stl_exact_edge &edge = edges[size_t(i) * 3 + j];
+          edge.facet_number = i;
+          edge.which_edge   = stl_edge_key_exact(edge.key, &a, &b) ? j + 3 : j;
+        }
+      }
+      return shortest_edge;
+    },
+    [](float a, float b) { return std::min(a, b); });
+
+  tbb::parallel_sort(edges.begin(), edges.end());
+
+  // Pair the runs of equal keys. A run is processed by the chunk containing its first edge.
+  // Each edge of a facet belongs to exactly one run, therefore the neighbors are written without locking.
+  stl->stats.connected_edges = tbb::parallel_reduce(
+    tbb::blocked_range<size_t>(0, edges.size(), 65536), 0,
+    [stl, &edges](const tbb::blocked_range<size_t> &range, int connected_edges) {
+      size_t i = range.begin();
+      // Skip the tail of a run started by the previous chunk.
+      while (i > 0 && i < range.end() && edges[i].same_key(edges[i - 1]))
+        ++ i;
+      while (i < range.end()) {
+        size_t j = i + 1;
+        while (j < edges.size() && edges[j].same_key(edges[i]))
+          ++ j;
+        for (size_t k = i; k + 1 < j; k += 2) {
+          // Don't match edges of the same facet.
+          if (edges[k].facet_number == edges[k + 1].facet_number)
+            continue;
+          stl_link_neighbors(stl, edges[k].facet_number, edges[k].which_edge, edges[k + 1].facet_number, edges[k + 1].which_edge);
+          connected_edges += 2;
+        }
+        i = j;
+      }
+      return connected_edges;
+    },
+    [](int a, int b) { return a + b; });
 
-#if 0
-  printf("Number of faces: %d, number of manifold edges: %d, number of connected edges: %d, number of unconnected edges: %d\r\n", 
-    stl->stats.number_of_facets, stl->stats.number_of_facets * 3, 
-    stl->stats.connected_edges, stl->stats.number_of_facets * 3 - stl->stats.connected_edges);
-#endif
+  stl_count_connected_facets(stl);
 }
 
-static void
-stl_load_edge_exact(stl_file *stl, stl_hash_edge *edge,
-                    stl_vertex *a, stl_vertex *b) {
-
-  if (stl->error) return;
-
-  {
-    stl_vertex diff = (*a - *b).cwiseAbs();
-    float max_diff = std::max(diff(0), std::max(diff(1), diff(2)));
-    stl->stats.shortest_edge = std::min(max_diff, stl->stats.shortest_edge);
-  }
-
+// Fill in the key of an edge with its vertices sorted, so that equal edges have equal keys independently
+// of their direction. Returns true if the edge is stored backwards.
+static bool stl_edge_key_exact(uint32_t key[6], const stl_vertex *a, const stl_vertex *b)
+{
   // Ensure identical vertex ordering of equal edges.
   // This method is numerically robust.
-  if (stl_vertex_lower(*a, *b)) {
-  } else {
+  bool backwards = ! stl_vertex_lower(*a, *b);
+  if (backwards)
     std::swap(a, b);
-    edge->which_edge += 3; /* this edge is loaded backwards */
-  }
-  memcpy(&edge->key[0], a->data(), sizeof(stl_vertex));
-  memcpy(&edge->key[3], b->data(), sizeof(stl_vertex));
+  memcpy(&key[0], a->data(), sizeof(stl_vertex));
+  memcpy(&key[3], b->data(), sizeof(stl_vertex));
   // Switch negative zeros to positive zeros, so memcmp will consider them to be equal.
   for (size_t i = 0; i < 6; ++ i) {
-    unsigned char *p = (unsigned char*)(edge->key + i);
+    unsigned char *p = (unsigned char*)(key + i);
 #ifdef BOOST_LITTLE_ENDIAN
     if (p[0] == 0 && p[1] == 0 && p[2] == 0 && p[3] == 0x80)
       // Negative zero, switch to positive zero.
@@ -143,6 +207,23 @@ stl_load_edge_exact(stl_file *stl, stl_hash_edge *edge,
       p[0] = 0;
 #endif /* BOOST_LITTLE_ENDIAN */
   }
+  return backwards;
+}
+
+static void
+stl_load_edge_exact(stl_file *stl, stl_hash_edge *edge,
+                    stl_vertex *a, stl_vertex *b) {
+
+  if (stl->error) return;
+
+  {
+    stl_vertex diff = (*a - *b).cwiseAbs();
+    float max_diff = std::max(diff(0), std::max(diff(1), diff(2)));
+    stl->stats.shortest_edge = std::min(max_diff, stl->stats.shortest_edge);
+  }
+
+  if (stl_edge_key_exact(edge->key, a, b))
+    edge->which_edge += 3; /* this edge is loaded backwards */
 }
 
 static inline size_t hash_size_from_nr_faces(const size_t nr_faces)
@@ -155,38 +236,6 @@ static inline size_t hash_size_from_nr_faces(const size_t nr_faces)
 	return (it == primes.end()) ? primes.back() : *it;
 }
 
-static void
-stl_initialize_facet_check_exact(stl_file *stl) {
-  int i;
-
-  if (stl->error) return;
-
-  stl->stats.malloced = 0;
-  stl->stats.freed = 0;
-  stl->stats.collisions = 0;
-
-  stl->M = hash_size_from_nr_faces(stl->stats.number_of_facets);
-
-  for (i = 0; i < stl->stats.number_of_facets ; i++) {
-    /* initialize neighbors list to -1 to mark unconnected edges */
-    stl->neighbors_start[i].neighbor[0] = -1;
-    stl->neighbors_start[i].neighbor[1] = -1;
-    stl->neighbors_start[i].neighbor[2] = -1;
-  }
-
-  stl->heads = (stl_hash_edge**)calloc(stl->M, sizeof(*stl->heads));
-  if(stl->heads == NULL) perror("stl_initialize_facet_check_exact");
-
-  stl->tail = (stl_hash_edge*)malloc(sizeof(stl_hash_edge));
-  if(stl->tail == NULL) perror("stl_initialize_facet_check_exact");
-
-  stl->tail->next = stl->tail;
-
-  for(i = 0; i < stl->M; i++) {
-    stl->heads[i] = stl->tail;
-  }
-}
-
 static void insert_hash_edge(stl_file *stl, stl_hash_edge edge,
                  void (*match_neighbors)(stl_file *stl,
                      stl_hash_edge *edge_a, stl_hash_edge *edge_b))
@@ -367,40 +416,64 @@ static void stl_initialize_facet_check_nearby(stl_file *stl)
 
 
 
+// Record facet a and facet b as neighbors over their edges which_edge_a and which_edge_b.
+// Only the neighbor records of the two edges are written, the connection statistics are not updated.
 static void
-stl_record_neighbors(stl_file *stl,
-                     stl_hash_edge *edge_a, stl_hash_edge *edge_b) {
-  int i;
-  int j;
-
-  if (stl->error) return;
-
+stl_link_neighbors(stl_file *stl, int facet_a, int which_edge_a, int facet_b, int which_edge_b) {
   /* Facet a's neighbor is facet b */
-  stl->neighbors_start[edge_a->facet_number].neighbor[edge_a->which_edge % 3] =
-    edge_b->facet_number;	/* sets the .neighbor part */
+  stl->neighbors_start[facet_a].neighbor[which_edge_a % 3] =
+    facet_b;	/* sets the .neighbor part */
 
-  stl->neighbors_start[edge_a->facet_number].
-  which_vertex_not[edge_a->which_edge % 3] =
-    (edge_b->which_edge + 2) % 3; /* sets the .which_vertex_not part */
+  stl->neighbors_start[facet_a].which_vertex_not[which_edge_a % 3] =
+    (which_edge_b + 2) % 3; /* sets the .which_vertex_not part */
 
   /* Facet b's neighbor is facet a */
-  stl->neighbors_start[edge_b->facet_number].neighbor[edge_b->which_edge % 3] =
-    edge_a->facet_number;	/* sets the .neighbor part */
+  stl->neighbors_start[facet_b].neighbor[which_edge_b % 3] =
+    facet_a;	/* sets the .neighbor part */
 
-  stl->neighbors_start[edge_b->facet_number].
-  which_vertex_not[edge_b->which_edge % 3] =
-    (edge_a->which_edge + 2) % 3; /* sets the .which_vertex_not part */
+  stl->neighbors_start[facet_b].which_vertex_not[which_edge_b % 3] =
+    (which_edge_a + 2) % 3; /* sets the .which_vertex_not part */
 
-  if(   ((edge_a->which_edge < 3) && (edge_b->which_edge < 3))
-        || ((edge_a->which_edge > 2) && (edge_b->which_edge > 2))) {
+  if(   ((which_edge_a < 3) && (which_edge_b < 3))
+        || ((which_edge_a > 2) && (which_edge_b > 2))) {
     /* these facets are oriented in opposite directions.  */
     /*  their normals are probably messed up. */
-    stl->neighbors_start[edge_a->facet_number].
-    which_vertex_not[edge_a->which_edge % 3] += 3;
-    stl->neighbors_start[edge_b->facet_number].
-    which_vertex_not[edge_b->which_edge % 3] += 3;
+    stl->neighbors_start[facet_a].which_vertex_not[which_edge_a % 3] += 3;
+    stl->neighbors_start[facet_b].which_vertex_not[which_edge_b % 3] += 3;
   }
+}
+
+// Count the facets connected over at least one, two and three edges.
+static void
+stl_count_connected_facets(stl_file *stl) {
+  typedef Eigen::Matrix<int, 3, 1, Eigen::DontAlign> Vec3i;
+  Vec3i connected = tbb::parallel_reduce(
+    tbb::blocked_range<int>(0, stl->stats.number_of_facets, 65536), Vec3i(Vec3i::Zero()),
+    [stl](const tbb::blocked_range<int> &range, Vec3i connected) {
+      for (int i = range.begin(); i < range.end(); ++ i) {
+        int num_connected = (stl->neighbors_start[i].neighbor[0] != -1) +
+                            (stl->neighbors_start[i].neighbor[1] != -1) +
+                            (stl->neighbors_start[i].neighbor[2] != -1);
+        for (int j = 0; j < num_connected; ++ j)
+          ++ connected(j);
+      }
+      return connected;
+    },
+    [](const Vec3i &a, const Vec3i &b) { return Vec3i(a + b); });
+  stl->stats.connected_facets_1_edge = connected(0);
+  stl->stats.connected_facets_2_edge = connected(1);
+  stl->stats.connected_facets_3_edge = connected(2);
+}
+
+static void
+stl_record_neighbors(stl_file *stl,
+                     stl_hash_edge *edge_a, stl_hash_edge *edge_b) {
+  int i;
+  int j;
+
+  if (stl->error) return;
 
+  stl_link_neighbors(stl, edge_a->facet_number, edge_a->which_edge, edge_b->facet_number, edge_b->which_edge);
 
   /* Count successful connects */
   /* Total connects */
@@ -25,6 +25,9 @@
 #include <string.h>
 #include <math.h>
 
+#include <algorithm>
+#include <vector>
+
 #include "stl.h"
 
 static int stl_check_normal_vector(stl_file *stl, int facet_num, int normal_fix_flag);
@@ -84,45 +87,24 @@ stl_reverse_facet(stl_file *stl, int facet_num) {
 
 void
 stl_fix_normal_directions(stl_file *stl) {
-  char *norm_sw;
-  /*  int edge_num;*/
-  /*  int vnot;*/
   int checked = 0;
   int facet_num;
-  /*  int next_facet;*/
-  int i;
   int j;
-  struct stl_normal {
-    int               facet_num;
-    struct stl_normal *next;
-  };
-  struct stl_normal *head;
-  struct stl_normal *tail;
-  struct stl_normal *newn;
-  struct stl_normal *temp;
-
-  int* reversed_ids;
-  int reversed_count = 0;
   int id;
   int force_exit = 0;
 
   if (stl->error) return;
 
-  /* Initialize linked list. */
-  head = (struct stl_normal*)malloc(sizeof(struct stl_normal));
-  if(head == NULL) perror("stl_fix_normal_directions");
-  tail = (struct stl_normal*)malloc(sizeof(struct stl_normal));
-  if(tail == NULL) perror("stl_fix_normal_directions");
-  head->next = tail;
-  tail->next = tail;
+  // Stack of facets to be visited. The facets are visited depth first, in the same order
+  // as the linked list used to be traversed, so that the same facets are reversed.
+  std::vector<int> stack;
+  stack.reserve(std::min<int>(stl->stats.number_of_facets, 65536));
 
   /* Initialize list that keeps track of already fixed facets. */
-  norm_sw = (char*)calloc(stl->stats.number_of_facets, sizeof(char));
-  if(norm_sw == NULL) perror("stl_fix_normal_directions");
+  std::vector<char> norm_sw(stl->stats.number_of_facets, 0);
 
   /* Initialize list that keeps track of reversed facets. */
-  reversed_ids = (int*)calloc(stl->stats.number_of_facets, sizeof(int));
-  if (reversed_ids == NULL) perror("stl_fix_normal_directions reversed_ids");
+  std::vector<int> reversed_ids;
 
   facet_num = 0;
   /* If normal vector is not within tolerance and backwards:
@@ -130,13 +112,16 @@ stl_fix_normal_directions(stl_file *stl) {
      of it being wrong randomly are low if most of the triangles are right: */
   if (stl_check_normal_vector(stl, 0, 0) == 2) {
       stl_reverse_facet(stl, 0);
-      reversed_ids[reversed_count++] = 0;
+      reversed_ids.push_back(0);
   }
 
   /* Say that we've fixed this facet: */
   norm_sw[facet_num] = 1;
   checked++;
 
+  // All facets before first_unchecked are fixed, this is where the search for the next part starts.
+  uint32_t first_unchecked = 1;
+
   for(;;) {
     /* Add neighbors_to_list.
        Add unconnected neighbors to the list:a  */
@@ -147,14 +132,14 @@ stl_fix_normal_directions(stl_file *stl) {
         if(stl->neighbors_start[facet_num].neighbor[j] != -1) {
             if (norm_sw[stl->neighbors_start[facet_num].neighbor[j]] == 1) {
                 /* trying to modify a facet already marked as fixed, revert all changes made until now and exit (fixes: #716, #574, #413, #269, #262, #259, #230, #228, #206) */
-                for (id = reversed_count - 1; id >= 0; --id) {
+                for (id = int(reversed_ids.size()) - 1; id >= 0; --id) {
                     stl_reverse_facet(stl, reversed_ids[id]);
                 }
                 force_exit = 1;
                 break;
             } else {
                 stl_reverse_facet(stl, stl->neighbors_start[facet_num].neighbor[j]);
-                reversed_ids[reversed_count++] = stl->neighbors_start[facet_num].neighbor[j];
+                reversed_ids.push_back(stl->neighbors_start[facet_num].neighbor[j]);
             }
         }
       }
@@ -162,12 +147,8 @@ stl_fix_normal_directions(stl_file *stl) {
       if(stl->neighbors_start[facet_num].neighbor[j] != -1) {
         /* If we haven't fixed this facet yet, add it to the list: */
         if(norm_sw[stl->neighbors_start[facet_num].neighbor[j]] != 1) {
-          /* Add node to beginning of list. */
-          newn = (struct stl_normal*)malloc(sizeof(struct stl_normal));
-          if(newn == NULL) perror("stl_fix_normal_directions");
-          newn->facet_num = stl->neighbors_start[facet_num].neighbor[j];
-          newn->next = head->next;
-          head->next = newn;
+          /* Add node to the top of the stack. */
+          stack.push_back(stl->neighbors_start[facet_num].neighbor[j]);
         }
       }
     }
@@ -176,15 +157,13 @@ stl_fix_normal_directions(stl_file *stl) {
     if (force_exit) break;
 
     /* Get next facet to fix from top of list. */
-    if(head->next != tail) {
-      facet_num = head->next->facet_num;
+    if(! stack.empty()) {
+      facet_num = stack.back();
       if(norm_sw[facet_num] != 1) { /* If facet is in list mutiple times */
         norm_sw[facet_num] = 1; /* Record this one as being fixed. */
         checked++;
       }
-      temp = head->next;	/* Delete this facet from the list. */
-      head->next = head->next->next;
-      free(temp);
+      stack.pop_back();	/* Delete this facet from the list. */
     } else { /* if we ran out of facets to fix: */
       /* All of the facets in this part have been fixed. */
       stl->stats.number_of_parts += 1;
@@ -193,13 +172,13 @@ stl_fix_normal_directions(stl_file *stl) {
         break;
       } else {
         /* There is another part here.  Find it and continue. */
-        for(i = 0; i < stl->stats.number_of_facets; i++) {
-          if(norm_sw[i] == 0) {
+        for(; first_unchecked < stl->stats.number_of_facets; first_unchecked++) {
+          if(norm_sw[first_unchecked] == 0) {
             /* This is the first facet of the next part. */
-            facet_num = i;
-            if(stl_check_normal_vector(stl, i, 0) == 2) {
-                stl_reverse_facet(stl, i);
-                reversed_ids[reversed_count++] = i;
+            facet_num = first_unchecked;
+            if(stl_check_normal_vector(stl, facet_num, 0) == 2) {
+                stl_reverse_facet(stl, facet_num);
+                reversed_ids.push_back(facet_num);
             }
 
             norm_sw[facet_num] = 1;
@@ -210,10 +189,6 @@ stl_fix_normal_directions(stl_file *stl) {
       }
     }
   }
-  free(head);
-  free(tail);
-  free(reversed_ids);
-  free(norm_sw);
 }
 
 static int stl_check_normal_vector(stl_file *stl, int facet_num, int normal_fix_flag) {
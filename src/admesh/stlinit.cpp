@@ -24,10 +24,16 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <float.h>
 #include <assert.h>
 
 #include <boost/nowide/cstdio.hpp>
 #include <boost/detail/endian.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_reduce.h>
 
 #include "stl.h"
 
@@ -35,9 +41,17 @@
 #error "SEEK_SET not defined"
 #endif
 
+#ifdef BOOST_LITTLE_ENDIAN
+static bool stl_open_binary_mmap(stl_file *stl, const char *file);
+#endif /* BOOST_LITTLE_ENDIAN */
+
 void
 stl_open(stl_file *stl, const char *file) {
   stl_initialize(stl);
+#ifdef BOOST_LITTLE_ENDIAN
+  if (stl_open_binary_mmap(stl, file))
+    return;
+#endif /* BOOST_LITTLE_ENDIAN */
   stl_count_facets(stl, file);
   stl_allocate(stl);
   stl_read(stl, 0, true);
@@ -45,6 +59,89 @@ stl_open(stl_file *stl, const char *file) {
 }
 
 
+#ifdef BOOST_LITTLE_ENDIAN
+// Load a binary STL by mapping the file into memory and copying the facets in parallel chunks,
+// calculating the bounding box on the fly. The facets are stored in the file packed to SIZEOF_STL_FACET
+// bytes in the native (little endian) byte order, therefore no conversion is needed.
+// Returns false without touching stl if the file is not a binary STL or if it could not be mapped
+// (for example an UTF-8 file name on Windows), so that the stdio based loader may take over and report errors.
+static bool stl_open_binary_mmap(stl_file *stl, const char *file)
+{
+  namespace bip = boost::interprocess;
+  bip::file_mapping  mapping;
+  bip::mapped_region region;
+  try {
+    mapping = bip::file_mapping(file, bip::read_only);
+    region  = bip::mapped_region(mapping, bip::read_only);
+  } catch (...) {
+    return false;
+  }
+  const unsigned char *data      = static_cast<const unsigned char*>(region.get_address());
+  const size_t         file_size = region.get_size();
+  if (file_size < HEADER_SIZE + 128)
+    return false;
+
+  // Same binary / ASCII test as in stl_count_facets().
+  bool is_binary = false;
+  for (size_t i = HEADER_SIZE; i < HEADER_SIZE + 128 && ! is_binary; ++ i)
+    is_binary = data[i] > 127;
+  if (! is_binary)
+    return false;
+
+  if ((file_size - HEADER_SIZE) % SIZEOF_STL_FACET != 0 || file_size < STL_MIN_FILE_SIZE) {
+    fprintf(stderr, "The file %s has the wrong size.\n", file);
+    stl->error = 1;
+    return true;
+  }
+  const uint32_t num_facets = uint32_t((file_size - HEADER_SIZE) / SIZEOF_STL_FACET);
+  uint32_t header_num_facets;
+  memcpy(stl->stats.header, data, LABEL_SIZE);
+  stl->stats.header[80] = '\0';
+  memcpy(&header_num_facets, data + LABEL_SIZE, sizeof(uint32_t));
+  if (num_facets != header_num_facets)
+    fprintf(stderr, "Warning: File size doesn't match number of facets in the header\n");
+
+  stl->stats.type = binary;
+  stl->stats.number_of_facets    = num_facets;
+  stl->stats.original_num_facets = num_facets;
+  stl_allocate(stl);
+  if (stl->facet_start == NULL || stl->neighbors_start == NULL) {
+    stl->error = 1;
+    return true;
+  }
+
+  // Copy the facets, reduce the bounding box.
+  const unsigned char *facets = data + HEADER_SIZE;
+  stl_facet           *dst    = stl->facet_start;
+  std::pair<stl_vertex, stl_vertex> bbox = tbb::parallel_reduce(
+    tbb::blocked_range<size_t>(0, num_facets, 16384),
+    std::make_pair(stl_vertex(stl_vertex::Constant(FLT_MAX)), stl_vertex(stl_vertex::Constant(-FLT_MAX))),
+    [facets, dst](const tbb::blocked_range<size_t> &range, std::pair<stl_vertex, stl_vertex> bbox) {
+      for (size_t i = range.begin(); i < range.end(); ++ i) {
+        stl_facet &facet = dst[i];
+        memcpy(reinterpret_cast<char*>(&facet), facets + i * SIZEOF_STL_FACET, SIZEOF_STL_FACET);
+        for (size_t j = 0; j < 3; ++ j) {
+          bbox.first  = bbox.first .cwiseMin(facet.vertex[j]);
+          bbox.second = bbox.second.cwiseMax(facet.vertex[j]);
+        }
+      }
+      return bbox;
+    },
+    [](const std::pair<stl_vertex, stl_vertex> &a, const std::pair<stl_vertex, stl_vertex> &b) {
+      return std::make_pair(stl_vertex(a.first.cwiseMin(b.first)), stl_vertex(a.second.cwiseMax(b.second)));
+    });
+
+  stl->stats.min = bbox.first;
+  stl->stats.max = bbox.second;
+  // Initialize the shortest edge the same way stl_facet_stats() does.
+  stl_vertex diff = (dst[0].vertex[1] - dst[0].vertex[0]).cwiseAbs();
+  stl->stats.shortest_edge = std::max(diff(0), std::max(diff(1), diff(2)));
+  stl->stats.size = stl->stats.max - stl->stats.min;
+  stl->stats.bounding_diameter = stl->stats.size.norm();
+  return true;
+}
+#endif /* BOOST_LITTLE_ENDIAN */
+
 void
 stl_initialize(stl_file *stl) {
   memset(stl, 0, sizeof(stl_file));
@@ -25,6 +25,9 @@
 #include <string.h>
 #include <math.h>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_reduce.h>
+
 #include "stl.h"
 
 static void stl_rotate(float *x, float *y, const double c, const double s);
@@ -346,14 +349,20 @@ static float get_volume(stl_file *stl)
 
   // Choose a point, any point as the reference.
   stl_vertex p0 = stl->facet_start[0].vertex[0];
-  float volume = 0.f;
-  for(uint32_t i = 0; i < stl->stats.number_of_facets; ++ i) {
-    // Do dot product to get distance from point to plane.
-    float height = stl->facet_start[i].normal.dot(stl->facet_start[i].vertex[0] - p0);
-    float area   = get_area(&stl->facet_start[i]);
-    volume += (area * height) / 3.0f;
-  }
-  return volume;
+  // Sum the tetrahedra volumes in parallel chunks. The chunks are summed up in a fixed order,
+  // so that the volume does not depend on the thread scheduling.
+  return float(tbb::parallel_deterministic_reduce(
+    tbb::blocked_range<uint32_t>(0, stl->stats.number_of_facets, 16384), 0.,
+    [stl, &p0](const tbb::blocked_range<uint32_t> &range, double volume) {
+      for (uint32_t i = range.begin(); i < range.end(); ++ i) {
+        // Do dot product to get distance from point to plane.
+        float height = stl->facet_start[i].normal.dot(stl->facet_start[i].vertex[0] - p0);
+        float area   = get_area(&stl->facet_start[i]);
+        volume += (area * height) / 3.0;
+      }
+      return volume;
+    },
+    [](double a, double b) { return a + b; }));
 }
 
 void stl_calculate_volume(stl_file *stl)
@@ -6,7 +6,7 @@
 
 namespace Slic3r {
 
-template BoundingBoxBase<Point>::BoundingBoxBase(const std::vector<Point> &points);
+template BoundingBoxBase<Point>::BoundingBoxBase(const Points &points);
 template BoundingBoxBase<Vec2d>::BoundingBoxBase(const std::vector<Vec2d> &points);
 
 template BoundingBox3Base<Vec3d>::BoundingBox3Base(const std::vector<Vec3d> &points);
@@ -88,8 +88,8 @@ BoundingBoxBase<PointClass>::merge(const PointClass &point)
 template void BoundingBoxBase<Point>::merge(const Point &point);
 template void BoundingBoxBase<Vec2d>::merge(const Vec2d &point);
 
-template <class PointClass> void
-BoundingBoxBase<PointClass>::merge(const std::vector<PointClass> &points)
+template <class PointClass> template <class Alloc> void
+BoundingBoxBase<PointClass>::merge(const std::vector<PointClass, Alloc> &points)
 {
     this->merge(BoundingBoxBase(points));
 }
@@ -18,12 +18,13 @@ public:
     BoundingBoxBase() : defined(false), min(PointClass::Zero()), max(PointClass::Zero()) {}
     BoundingBoxBase(const PointClass &pmin, const PointClass &pmax) : 
         min(pmin), max(pmax), defined(pmin(0) < pmax(0) && pmin(1) < pmax(1)) {}
-    BoundingBoxBase(const std::vector<PointClass>& points) : min(PointClass::Zero()), max(PointClass::Zero())
+    template<class Alloc>
+    BoundingBoxBase(const std::vector<PointClass, Alloc>& points) : min(PointClass::Zero()), max(PointClass::Zero())
     {
         if (points.empty())
             throw std::invalid_argument("Empty point set supplied to BoundingBoxBase constructor");
 
-        typename std::vector<PointClass>::const_iterator it = points.begin();
+        typename std::vector<PointClass, Alloc>::const_iterator it = points.begin();
         this->min = *it;
         this->max = *it;
         for (++ it; it != points.end(); ++ it) {
@@ -33,7 +34,8 @@ public:
         this->defined = (this->min(0) < this->max(0)) && (this->min(1) < this->max(1));
     }
     void merge(const PointClass &point);
-    void merge(const std::vector<PointClass> &points);
+    template<class Alloc>
+    void merge(const std::vector<PointClass, Alloc> &points);
     void merge(const BoundingBoxBase<PointClass> &bb);
     void scale(double factor);
     PointClass size() const;
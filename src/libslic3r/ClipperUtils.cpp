@@ -9,10 +9,39 @@
 
 #include <Shiny/Shiny.h>
 
+#include <tbb/enumerable_thread_specific.h>
+
 #define CLIPPER_OFFSET_SHORTEST_EDGE_FACTOR (0.005f)
 
 namespace Slic3r {
 
+// The Clipper and ClipperOffset engines are retained per thread and reused, so that the buffers of the Clipper library
+// (local minima, output records, joins, intersections, offset normals) do not have to be reallocated for each operation.
+// An engine must be released (not used anymore) before the same engine is acquired again on the same thread.
+// The functions of this module do not spawn TBB tasks, therefore a task stolen while an engine is in use cannot reenter it.
+static ClipperLib::Clipper& clipper_engine()
+{
+    static tbb::enumerable_thread_specific<ClipperLib::Clipper> engines;
+    ClipperLib::Clipper &clipper = engines.local();
+    clipper.Clear();
+    clipper.PreserveCollinear(false);
+    clipper.StrictlySimple(false);
+    clipper.ReverseSolution(false);
+    return clipper;
+}
+
+static ClipperLib::ClipperOffset& clipper_offset_engine()
+{
+    static tbb::enumerable_thread_specific<ClipperLib::ClipperOffset> engines;
+    ClipperLib::ClipperOffset &co = engines.local();
+    co.Clear();
+    // Default parameters of the ClipperOffset constructor.
+    co.MiterLimit         = 2.;
+    co.ArcTolerance       = 0.25;
+    co.ShortestEdgeLength = 0.;
+    return co;
+}
+
 #ifdef CLIPPER_UTILS_DEBUG
 bool clipper_export_enabled = false;
 // For debugging the Clipper library, for providing bug reports to the Clipper author.
@@ -119,16 +148,18 @@ PolyTreeToExPolygons(ClipperLib::PolyTree& polytree)
 Slic3r::Polygon ClipperPath_to_Slic3rPolygon(const ClipperLib::Path &input)
 {
     Polygon retval;
+    retval.points.reserve(input.size());
     for (ClipperLib::Path::const_iterator pit = input.begin(); pit != input.end(); ++pit)
-        retval.points.push_back(Point( (*pit).X, (*pit).Y ));
+        retval.points.emplace_back((*pit).X, (*pit).Y);
     return retval;
 }
 
 Slic3r::Polyline ClipperPath_to_Slic3rPolyline(const ClipperLib::Path &input)
 {
     Polyline retval;
+    retval.points.reserve(input.size());
     for (ClipperLib::Path::const_iterator pit = input.begin(); pit != input.end(); ++pit)
-        retval.points.push_back(Point( (*pit).X, (*pit).Y ));
+        retval.points.emplace_back((*pit).X, (*pit).Y);
     return retval;
 }
 
@@ -137,7 +168,7 @@ Slic3r::Polygons ClipperPaths_to_Slic3rPolygons(const ClipperLib::Paths &input)
     Slic3r::Polygons retval;
     retval.reserve(input.size());
     for (ClipperLib::Paths::const_iterator it = input.begin(); it != input.end(); ++it)
-        retval.push_back(ClipperPath_to_Slic3rPolygon(*it));
+        retval.emplace_back(ClipperPath_to_Slic3rPolygon(*it));
     return retval;
 }
 
@@ -146,7 +177,7 @@ Slic3r::Polylines ClipperPaths_to_Slic3rPolylines(const ClipperLib::Paths &input
     Slic3r::Polylines retval;
     retval.reserve(input.size());
     for (ClipperLib::Paths::const_iterator it = input.begin(); it != input.end(); ++it)
-        retval.push_back(ClipperPath_to_Slic3rPolyline(*it));
+        retval.emplace_back(ClipperPath_to_Slic3rPolyline(*it));
     return retval;
 }
 
@@ -154,8 +185,7 @@ ExPolygons
 ClipperPaths_to_Slic3rExPolygons(const ClipperLib::Paths &input)
 {
     // init Clipper
-    ClipperLib::Clipper clipper;
-    clipper.Clear();
+    ClipperLib::Clipper &clipper = clipper_engine();
     
     // perform union
     clipper.AddPaths(input, ClipperLib::ptSubject, true);
@@ -170,8 +200,9 @@ ClipperLib::Path
 Slic3rMultiPoint_to_ClipperPath(const MultiPoint &input)
 {
     ClipperLib::Path retval;
+    retval.reserve(input.points.size());
     for (Points::const_iterator pit = input.points.begin(); pit != input.points.end(); ++pit)
-        retval.push_back(ClipperLib::IntPoint( (*pit)(0), (*pit)(1) ));
+        retval.emplace_back((*pit)(0), (*pit)(1));
     return retval;
 }
 
@@ -181,23 +212,25 @@ Slic3rMultiPoint_to_ClipperPath_reversed(const Slic3r::MultiPoint &input)
     ClipperLib::Path output;
     output.reserve(input.points.size());
     for (Slic3r::Points::const_reverse_iterator pit = input.points.rbegin(); pit != input.points.rend(); ++pit)
-        output.push_back(ClipperLib::IntPoint( (*pit)(0), (*pit)(1) ));
+        output.emplace_back((*pit)(0), (*pit)(1));
     return output;
 }
 
 ClipperLib::Paths Slic3rMultiPoints_to_ClipperPaths(const Polygons &input)
 {
     ClipperLib::Paths retval;
+    retval.reserve(input.size());
     for (Polygons::const_iterator it = input.begin(); it != input.end(); ++it)
-        retval.push_back(Slic3rMultiPoint_to_ClipperPath(*it));
+        retval.emplace_back(Slic3rMultiPoint_to_ClipperPath(*it));
     return retval;
 }
 
 ClipperLib::Paths Slic3rMultiPoints_to_ClipperPaths(const Polylines &input)
 {
     ClipperLib::Paths retval;
+    retval.reserve(input.size());
     for (Polylines::const_iterator it = input.begin(); it != input.end(); ++it)
-        retval.push_back(Slic3rMultiPoint_to_ClipperPath(*it));
+        retval.emplace_back(Slic3rMultiPoint_to_ClipperPath(*it));
     return retval;
 }
 
@@ -207,7 +240,7 @@ ClipperLib::Paths _offset(ClipperLib::Paths &&input, ClipperLib::EndType endType
     scaleClipperPolygons(input);
     
     // perform offset
-    ClipperLib::ClipperOffset co;
+    ClipperLib::ClipperOffset &co = clipper_offset_engine();
     if (joinType == jtRound)
         co.ArcTolerance = miterLimit;
     else
@@ -243,7 +276,7 @@ ClipperLib::Paths _offset(const Slic3r::ExPolygon &expolygon, const float delta,
     {
         ClipperLib::Path input = Slic3rMultiPoint_to_ClipperPath(expolygon.contour);
         scaleClipperPolygon(input);
-        ClipperLib::ClipperOffset co;
+        ClipperLib::ClipperOffset &co = clipper_offset_engine();
         if (joinType == jtRound)
             co.ArcTolerance = miterLimit * double(CLIPPER_OFFSET_SCALE);
         else
@@ -260,7 +293,7 @@ ClipperLib::Paths _offset(const Slic3r::ExPolygon &expolygon, const float delta,
         for (Polygons::const_iterator it_hole = expolygon.holes.begin(); it_hole != expolygon.holes.end(); ++ it_hole) {
             ClipperLib::Path input = Slic3rMultiPoint_to_ClipperPath_reversed(*it_hole);
             scaleClipperPolygon(input);
-            ClipperLib::ClipperOffset co;
+            ClipperLib::ClipperOffset &co = clipper_offset_engine();
             if (joinType == jtRound)
                 co.ArcTolerance = miterLimit * double(CLIPPER_OFFSET_SCALE);
             else
@@ -278,8 +311,7 @@ ClipperLib::Paths _offset(const Slic3r::ExPolygon &expolygon, const float delta,
     if (holes.empty()) {
         output = std::move(contours);
     } else {
-        ClipperLib::Clipper clipper;
-        clipper.Clear();
+        ClipperLib::Clipper &clipper = clipper_engine();
         clipper.AddPaths(contours, ClipperLib::ptSubject, true);
         clipper.AddPaths(holes, ClipperLib::ptClip, true);
         clipper.Execute(ClipperLib::ctDifference, output, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
@@ -309,7 +341,7 @@ ClipperLib::Paths _offset(const Slic3r::ExPolygons &expolygons, const float delt
         {
             ClipperLib::Path input = Slic3rMultiPoint_to_ClipperPath(it_expoly->contour);
             scaleClipperPolygon(input);
-            ClipperLib::ClipperOffset co;
+            ClipperLib::ClipperOffset &co = clipper_offset_engine();
             if (joinType == jtRound)
                 co.ArcTolerance = miterLimit * double(CLIPPER_OFFSET_SCALE);
             else
@@ -333,7 +365,7 @@ ClipperLib::Paths _offset(const Slic3r::ExPolygons &expolygons, const float delt
                 for (Polygons::const_iterator it_hole = it_expoly->holes.begin(); it_hole != it_expoly->holes.end(); ++ it_hole) {
                     ClipperLib::Path input = Slic3rMultiPoint_to_ClipperPath_reversed(*it_hole);
                     scaleClipperPolygon(input);
-                    ClipperLib::ClipperOffset co;
+                    ClipperLib::ClipperOffset &co = clipper_offset_engine();
                     if (joinType == jtRound)
                         co.ArcTolerance = miterLimit * double(CLIPPER_OFFSET_SCALE);
                     else
@@ -354,8 +386,7 @@ ClipperLib::Paths _offset(const Slic3r::ExPolygons &expolygons, const float delt
             } else if (delta < 0) {
                 // Negative offset. There is a chance, that the offsetted hole intersects the outer contour. 
                 // Subtract the offsetted holes from the offsetted contours.
-                ClipperLib::Clipper clipper;
-                clipper.Clear();
+                ClipperLib::Clipper &clipper = clipper_engine();
                 clipper.AddPaths(contours, ClipperLib::ptSubject, true);
                 clipper.AddPaths(holes, ClipperLib::ptClip, true);
                 ClipperLib::Paths output;
@@ -385,8 +416,7 @@ ClipperLib::Paths _offset(const Slic3r::ExPolygons &expolygons, const float delt
     ClipperLib::Paths output;
     if (expolygons_collected > 1 && delta > 0) {
         // There is a chance that the outwards offsetted expolygons may intersect. Perform a union.
-        ClipperLib::Clipper clipper;
-        clipper.Clear(); 
+        ClipperLib::Clipper &clipper = clipper_engine();
         clipper.AddPaths(contours_cummulative, ClipperLib::ptSubject, true);
         clipper.Execute(ClipperLib::ctUnion, output, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
     } else {
@@ -410,7 +440,7 @@ _offset2(const Polygons &polygons, const float delta1, const float delta2,
     scaleClipperPolygons(input);
     
     // prepare ClipperOffset object
-    ClipperLib::ClipperOffset co;
+    ClipperLib::ClipperOffset &co = clipper_offset_engine();
     if (joinType == jtRound) {
         co.ArcTolerance = miterLimit;
     } else {
@@ -490,8 +520,7 @@ _clipper_do(const ClipperLib::ClipType clipType, const Polygons &subject,
     }
     
     // init Clipper
-    ClipperLib::Clipper clipper;
-    clipper.Clear();
+    ClipperLib::Clipper &clipper = clipper_engine();
     
     // add polygons
     clipper.AddPaths(input_subject, ClipperLib::ptSubject, true);
@@ -521,7 +550,7 @@ inline ClipperLib::PolyTree _clipper_do_polytree2(const ClipperLib::ClipType cli
     if (safety_offset_)
         safety_offset((clipType == ClipperLib::ctUnion) ? &input_subject : &input_clip);
     
-    ClipperLib::Clipper clipper;
+    ClipperLib::Clipper &clipper = clipper_engine();
     clipper.AddPaths(input_subject, ClipperLib::ptSubject, true);
     clipper.AddPaths(input_clip,    ClipperLib::ptClip,    true);
     // Perform the operation with the output to input_subject.
@@ -548,8 +577,7 @@ ClipperLib::PolyTree _clipper_do_pl(const ClipperLib::ClipType clipType, const P
     if (safety_offset_) safety_offset(&input_clip);
     
     // init Clipper
-    ClipperLib::Clipper clipper;
-    clipper.Clear();
+    ClipperLib::Clipper &clipper = clipper_engine();
     
     // add polygons
     clipper.AddPaths(input_subject, ClipperLib::ptSubject, false);
@@ -696,7 +724,7 @@ Polygons simplify_polygons(const Polygons &subject, bool preserve_collinear)
     
     ClipperLib::Paths output;
     if (preserve_collinear) {
-        ClipperLib::Clipper c;
+        ClipperLib::Clipper &c = clipper_engine();
         c.PreserveCollinear(true);
         c.StrictlySimple(true);
         c.AddPaths(input_subject, ClipperLib::ptSubject, true);
@@ -719,7 +747,7 @@ ExPolygons simplify_polygons_ex(const Polygons &subject, bool preserve_collinear
     
     ClipperLib::PolyTree polytree;
     
-    ClipperLib::Clipper c;
+    ClipperLib::Clipper &c = clipper_engine();
     c.PreserveCollinear(true);
     c.StrictlySimple(true);
     c.AddPaths(input_subject, ClipperLib::ptSubject, true);
@@ -737,7 +765,7 @@ void safety_offset(ClipperLib::Paths* paths)
     scaleClipperPolygons(*paths);
     
     // perform offset (delta = scale 1e-05)
-    ClipperLib::ClipperOffset co;
+    ClipperLib::ClipperOffset &co = clipper_offset_engine();
 #ifdef CLIPPER_UTILS_DEBUG
     if (clipper_export_enabled) {
         static int iRun = 0;
@@ -760,7 +788,7 @@ void safety_offset(ClipperLib::Paths* paths)
             PROFILE_BLOCK(safety_offset_Execute);
             // offset outside by 10um
             ClipperLib::Paths out_this;
-            co.Execute(out_this, ccw ? 10.f * float(CLIPPER_OFFSET_SCALE) : -10.f * float(CLIPPER_OFFSET_SCALE));
+            co.Execute(out_this, ccw ? CLIPPER_SAFETY_OFFSET * float(CLIPPER_OFFSET_SCALE) : - CLIPPER_SAFETY_OFFSET * float(CLIPPER_OFFSET_SCALE));
             if (! ccw) {
                 // Reverse the resulting contours once again.
                 for (ClipperLib::Paths::iterator it = out_this.begin(); it != out_this.end(); ++ it)
@@ -781,8 +809,7 @@ void safety_offset(ClipperLib::Paths* paths)
 Polygons top_level_islands(const Slic3r::Polygons &polygons)
 {
     // init Clipper
-    ClipperLib::Clipper clipper;
-    clipper.Clear();
+    ClipperLib::Clipper &clipper = clipper_engine();
     // perform union
     clipper.AddPaths(Slic3rMultiPoints_to_ClipperPaths(polygons), ClipperLib::ptSubject, true);
     ClipperLib::PolyTree polytree;
@@ -23,6 +23,9 @@ using ClipperLib::jtSquare;
 #define CLIPPER_OFFSET_SCALE (1 << CLIPPER_OFFSET_POWER_OF_2)
 #define CLIPPER_OFFSET_SCALE_ROUNDING_DELTA ((1 << (CLIPPER_OFFSET_POWER_OF_2 - 1)) - 1)
 #define CLIPPER_MAX_COORD_UNSCALED (ClipperLib::hiRange / CLIPPER_OFFSET_SCALE)
+// Distance in scaled coordinates, by which safety_offset() grows the input of the Boolean operations,
+// joining the vertices with jtMiter and a miter limit of 2.
+#define CLIPPER_SAFETY_OFFSET 10.f
 
 namespace Slic3r {
 
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <math.h>
+#include <algorithm>
 
 #include "Point.hpp"
 #include "BoundingBox.hpp"
@@ -65,6 +66,57 @@ public:
 	std::vector<std::pair<ContourEdge, ContourEdge>> intersecting_edges() const;
 	bool 											 has_intersecting_edges() const;
 
+	// Visit the cells of the rows spanned by the line segment p1, p2, which may intersect the line segment.
+	// The traversal is conservative, one cell around the segment is visited as well.
+	// The visitor is called with the row and column of a cell, it returns false to stop the traversal.
+	template<typename VISITOR> void visit_cells_intersecting_line(Slic3r::Point p1, Slic3r::Point p2, VISITOR &visitor) const
+	{
+		if (m_rows == 0 || m_cols == 0)
+			return;
+		// End points relative to the grid origin, the lower end point first.
+		if (p1(1) > p2(1))
+			std::swap(p1, p2);
+		const double x1 = double(p1(0)) - double(m_bbox.min(0));
+		const double y1 = double(p1(1)) - double(m_bbox.min(1));
+		const double x2 = double(p2(0)) - double(m_bbox.min(0));
+		const double y2 = double(p2(1)) - double(m_bbox.min(1));
+		const double res = double(m_resolution);
+		const double dxdy = (y2 > y1) ? (x2 - x1) / (y2 - y1) : 0.;
+		// Cell index of a coordinate, clamped to just outside the grid to avoid integer overflow.
+		auto cell_idx = [res](double v, size_t n) { return int(std::max(-1., std::min(double(n), floor(v / res)))); };
+		const int row_begin = std::max<int>(0, cell_idx(y1, m_rows) - 1);
+		const int row_end   = std::min<int>(int(m_rows) - 1, cell_idx(y2, m_rows) + 1);
+		for (int r = row_begin; r <= row_end; ++ r) {
+			// Span of the segment over the row.
+			double xa = x1;
+			double xb = x2;
+			if (y2 > y1) {
+				xa = x1 + (std::min(y2, std::max(y1, r * res)) - y1) * dxdy;
+				xb = x1 + (std::min(y2, std::max(y1, (r + 1) * res)) - y1) * dxdy;
+			}
+			const int col_begin = std::max<int>(0, cell_idx(std::min(xa, xb), m_cols) - 1);
+			const int col_end   = std::min<int>(int(m_cols) - 1, cell_idx(std::max(xa, xb), m_cols) + 1);
+			for (int c = col_begin; c <= col_end; ++ c)
+				if (! visitor(r, c))
+					return;
+		}
+	}
+
+	// Edges referenced by a cell, as pairs of the contour index and the index of the first point of the edge.
+	std::pair<std::vector<std::pair<size_t, size_t>>::const_iterator, std::vector<std::pair<size_t, size_t>>::const_iterator> cell_data_range(int row, int col) const
+	{
+		const Cell &cell = m_cells[row * m_cols + col];
+		return std::make_pair(m_cell_data.begin() + cell.begin, m_cell_data.begin() + cell.end);
+	}
+
+	// Edge of a contour, referenced by the pair of the contour index and the index of the first point of the edge.
+	Line line(const std::pair<size_t, size_t> &contour_and_point) const
+	{
+		const Slic3r::Points &pts = *m_contours[contour_and_point.first];
+		size_t ipt = contour_and_point.second;
+		return Line(pts[ipt], pts[(ipt + 1 == pts.size()) ? 0 : ipt + 1]);
+	}
+
 protected:
 	struct Cell {
 		Cell() : begin(0), end(0) {}
@@ -1494,7 +1494,7 @@ namespace Slic3r {
             // splits volume out of imported geometry
             unsigned int triangles_count = volume_data.last_triangle_id - volume_data.first_triangle_id + 1;
             ModelVolume* volume = object.add_volume(TriangleMesh());
-            stl_file& stl = volume->mesh.stl;
+            stl_file& stl = volume->mesh_mutable().stl;
             stl.stats.type = inmemory;
             stl.stats.number_of_facets = (uint32_t)triangles_count;
             stl.stats.original_num_facets = (int)stl.stats.number_of_facets;
@@ -1513,7 +1513,7 @@ namespace Slic3r {
             }
 
             stl_get_size(&stl);
-            volume->mesh.repair();
+            volume->mesh_mutable().repair();
             volume->calculate_convex_hull();
 
             // apply volume's name and config data
@@ -1852,20 +1852,22 @@ namespace Slic3r {
         stream << "   <" << MESH_TAG << ">\n";
         stream << "    <" << VERTICES_TAG << ">\n";
 
+        // The shared vertices are generated without modifying the meshes, which may be shared with other volumes.
+        std::vector<std::unique_ptr<TriangleMeshSharedVertices>> shared_vertices(object.volumes.size());
         unsigned int vertices_count = 0;
-        for (ModelVolume* volume : object.volumes)
+        for (size_t i_volume = 0; i_volume < object.volumes.size(); ++i_volume)
         {
+            ModelVolume* volume = object.volumes[i_volume];
             if (volume == nullptr)
                 continue;
 
             volumes_offsets.insert(VolumeToOffsetsMap::value_type(volume, Offsets(vertices_count))).first;
 
-            if (!volume->mesh.repaired)
-                volume->mesh.repair();
+            if (!volume->mesh().repaired)
+                volume->mesh_mutable().repair();
 
-            stl_file& stl = volume->mesh.stl;
-            if (stl.v_shared == nullptr)
-                stl_generate_shared_vertices(&stl);
+            shared_vertices[i_volume].reset(new TriangleMeshSharedVertices(volume->mesh()));
+            const stl_file& stl = shared_vertices[i_volume]->stl();
 
             if (stl.stats.shared_vertices == 0)
             {
@@ -1899,15 +1901,16 @@ namespace Slic3r {
         stream << "    <" << TRIANGLES_TAG << ">\n";
 
         unsigned int triangles_count = 0;
-        for (ModelVolume* volume : object.volumes)
+        for (size_t i_volume = 0; i_volume < object.volumes.size(); ++i_volume)
         {
+            ModelVolume* volume = object.volumes[i_volume];
             if (volume == nullptr)
                 continue;
 
             VolumeToOffsetsMap::iterator volume_it = volumes_offsets.find(volume);
             assert(volume_it != volumes_offsets.end());
 
-            stl_file& stl = volume->mesh.stl;
+            const stl_file& stl = shared_vertices[i_volume]->stl();
 
             // updates triangle offsets
             volume_it->second.first_triangle_id = triangles_count;
@@ -4,6 +4,7 @@
 #include "Geometry.hpp"
 #include "GCode/PrintExtents.hpp"
 #include "GCode/WipeTowerPrusaMM.hpp"
+#include "ShortestPath.hpp"
 #include "Utils.hpp"
 
 #include <algorithm>
@@ -20,6 +21,10 @@
 #include <boost/nowide/cstdio.hpp>
 #include <boost/nowide/cstdlib.hpp>
 
+#include <tbb/parallel_for.h>
+#include <tbb/task_group.h>
+#include <tbb/task_scheduler_init.h>
+
 #include "SVG.hpp"
 
 #include <Shiny/Shiny.h>
@@ -42,6 +47,30 @@ static inline void check_add_eol(std::string &gcode)
         gcode += '\n';    
 }
     
+static inline bool expolygons_equal(const ExPolygons &expolys1, const ExPolygons &expolys2)
+{
+    if (expolys1.size() != expolys2.size())
+        return false;
+    for (size_t i = 0; i < expolys1.size(); ++ i) {
+        const ExPolygon &expoly1 = expolys1[i];
+        const ExPolygon &expoly2 = expolys2[i];
+        if (expoly1.contour.points != expoly2.contour.points || expoly1.holes.size() != expoly2.holes.size())
+            return false;
+        for (size_t j = 0; j < expoly1.holes.size(); ++ j)
+            if (expoly1.holes[j].points != expoly2.holes[j].points)
+                return false;
+    }
+    return true;
+}
+
+void AvoidCrossingPerimeters::init_layer_mp(const ExPolygons &islands)
+{
+    if (m_layer_mp && expolygons_equal(islands, m_layer_mp_islands))
+        return;
+    m_layer_mp         = Slic3r::make_unique<MotionPlanner>(islands);
+    m_layer_mp_islands = islands;
+}
+
 // Plan a travel move while minimizing the number of perimeter crossings.
 // point is in unscaled coordinates, in the coordinate system of the current active object
 // (set by gcodegen.set_origin()).
@@ -454,12 +483,12 @@ void GCode::do_export(Print *print, const char *path, GCodePreviewData *preview_
     fclose(file);
 
     if (print->config().remaining_times.value) {
-        BOOST_LOG_TRIVIAL(debug) << "Processing remaining times for normal mode";
-        m_normal_time_estimator.post_process_remaining_times(path_tmp, 60.0f);
-        if (m_silent_time_estimator_enabled) {
-            BOOST_LOG_TRIVIAL(debug) << "Processing remaining times for silent mode";
-            m_silent_time_estimator.post_process_remaining_times(path_tmp, 60.0f);
-        }
+        // Insert the remaining times of both the normal and the silent mode in a single pass over the file.
+        BOOST_LOG_TRIVIAL(debug) << "Processing remaining times";
+        std::vector<GCodeTimeEstimator*> estimators(1, &m_normal_time_estimator);
+        if (m_silent_time_estimator_enabled)
+            estimators.emplace_back(&m_silent_time_estimator);
+        GCodeTimeEstimator::post_process_remaining_times(path_tmp, 60.0f, estimators);
     }
 
     if (! m_placeholder_parser_failed_templates.empty()) {
@@ -891,13 +920,10 @@ void GCode::_do_export(Print &print, FILE *file, GCodePreviewData *preview_data)
                 m_cooling_buffer->reset();
                 m_cooling_buffer->set_current_extruder(initial_extruder_id);
                 // Pair the object layers with the support layers by z, extrude them.
-                std::vector<LayerToPrint> layers_to_print = collect_layers_to_print(object);
-                for (const LayerToPrint &ltp : layers_to_print) {
-                    std::vector<LayerToPrint> lrs;
-                    lrs.emplace_back(std::move(ltp));
-                    this->process_layer(file, print, lrs, tool_ordering.tools_for_layer(ltp.print_z()), &copy - object.copies().data());
-                    print.throw_if_canceled();
-                }
+                std::vector<std::pair<coordf_t, std::vector<LayerToPrint>>> layers_to_print;
+                for (const LayerToPrint &ltp : collect_layers_to_print(object))
+                    layers_to_print.emplace_back(ltp.print_z(), std::vector<LayerToPrint>(1, ltp));
+                this->process_layers(file, print, tool_ordering, layers_to_print, &copy - object.copies().data());
                 if (m_pressure_equalizer)
                     _write(file, m_pressure_equalizer->process("", true));
                 ++ finished_objects;
@@ -947,13 +973,7 @@ void GCode::_do_export(Print &print, FILE *file, GCodePreviewData *preview_data)
             print.throw_if_canceled();
         }
         // Extrude the layers.
-        for (auto &layer : layers_to_print) {
-            const LayerTools &layer_tools = tool_ordering.tools_for_layer(layer.first);
-            if (m_wipe_tower && layer_tools.has_wipe_tower)
-                m_wipe_tower->next_layer();
-            this->process_layer(file, print, layer.second, layer_tools, size_t(-1));
-            print.throw_if_canceled();
-        }
+        this->process_layers(file, print, tool_ordering, layers_to_print, size_t(-1));
         if (m_pressure_equalizer)
             _write(file, m_pressure_equalizer->process("", true));
         if (m_wipe_tower)
@@ -1220,18 +1240,106 @@ inline std::vector<GCode::ObjectByExtruder::Island>& object_islands_by_extruder(
     return islands;
 }
 
+// Create the distance field for a layer below, to be used for the seam placement.
+static std::unique_ptr<EdgeGrid::Grid> make_lower_layer_edge_grid(const Layer &lower_layer)
+{
+    const coord_t distance_field_resolution = coord_t(scale_(1.) + 0.5);
+    std::unique_ptr<EdgeGrid::Grid> grid = make_unique<EdgeGrid::Grid>();
+    grid->create(lower_layer.slices, distance_field_resolution);
+    grid->calculate_sdf();
+    return grid;
+}
+
+void GCode::process_layers(
+    FILE                            *file,
+    const Print                     &print,
+    const ToolOrdering              &tool_ordering,
+    const std::vector<std::pair<coordf_t, std::vector<LayerToPrint>>> &layers,
+    const size_t                     single_object_idx)
+{
+    // The layers are exported in windows of a couple of layers to bound the memory consumption.
+    // 1) Data not depending on the G-code generator state (distance fields of the lower layers)
+    //    are calculated for all layers of a window in parallel.
+    // 2) The G-code of the layers of a window is generated sequentially, as the G-code writer (position, retraction),
+    //    the spiral vase, the cooling buffer and the pressure equalizer are stateful.
+    // 3) The G-code of a window is passed through the analyzer and the time estimators and written into the file
+    //    by a background task, while the G-code of the next window is being generated. The analyzer and the time
+    //    estimators are only accessed by _write().
+    const size_t             window = std::max<size_t>(4, 2 * size_t(tbb::task_scheduler_init::default_num_threads()));
+    std::vector<std::string> gcode_generated;
+    std::vector<std::string> gcode_to_write;
+    tbb::task_group          writer;
+    try {
+        for (size_t window_begin = 0; window_begin < layers.size(); window_begin += window) {
+            const size_t window_end = std::min(layers.size(), window_begin + window);
+            std::vector<std::vector<std::unique_ptr<EdgeGrid::Grid>>> lower_layer_edge_grids(window_end - window_begin);
+            tbb::parallel_for(
+                tbb::blocked_range<size_t>(window_begin, window_end),
+                [&print, &layers, &lower_layer_edge_grids, window_begin](const tbb::blocked_range<size_t>& range) {
+                    for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
+                        print.throw_if_canceled();
+                        lower_layer_edge_grids[layer_idx - window_begin] = make_lower_layer_edge_grids(layers[layer_idx].second);
+                    }
+                });
+            gcode_generated.clear();
+            gcode_generated.reserve(window_end - window_begin);
+            for (size_t layer_idx = window_begin; layer_idx < window_end; ++ layer_idx) {
+                const LayerTools &layer_tools = tool_ordering.tools_for_layer(layers[layer_idx].first);
+                if (single_object_idx == size_t(-1) && m_wipe_tower && layer_tools.has_wipe_tower)
+                    m_wipe_tower->next_layer();
+                gcode_generated.emplace_back(this->process_layer(print, layers[layer_idx].second, layer_tools, lower_layer_edge_grids[layer_idx - window_begin], single_object_idx));
+                print.throw_if_canceled();
+            }
+            // Wait until the previous window is written, then pass this window to the writer.
+            writer.wait();
+            gcode_to_write.swap(gcode_generated);
+            writer.run([this, file, &gcode_to_write]() {
+                for (std::string &gcode : gcode_to_write) {
+                    _write(file, gcode);
+                    // Release the memory early.
+                    std::string().swap(gcode);
+                }
+            });
+        }
+        writer.wait();
+    } catch (...) {
+        // Don't let the writer task outlive the G-code buffers.
+        writer.wait();
+        throw;
+    }
+}
+
+std::vector<std::unique_ptr<EdgeGrid::Grid>> GCode::make_lower_layer_edge_grids(const std::vector<LayerToPrint> &layers)
+{
+    std::vector<std::unique_ptr<EdgeGrid::Grid>> grids(layers.size());
+    for (size_t i = 0; i < layers.size(); ++ i) {
+        const Layer *layer = layers[i].object_layer;
+        if (layer == nullptr || layer->lower_layer == nullptr)
+            continue;
+        bool has_perimeters = false;
+        for (const LayerRegion *layerm : layer->regions())
+            if (! layerm->perimeters.entities.empty()) {
+                has_perimeters = true;
+                break;
+            }
+        if (has_perimeters)
+            grids[i] = make_lower_layer_edge_grid(*layer->lower_layer);
+    }
+    return grids;
+}
+
 // In sequential mode, process_layer is called once per each object and its copy, 
 // therefore layers will contain a single entry and single_object_idx will point to the copy of the object.
 // In non-sequential mode, process_layer is called per each print_z height with all object and support layers accumulated.
 // For multi-material prints, this routine minimizes extruder switches by gathering extruder specific extrusion paths
 // and performing the extruder specific extrusions together.
-void GCode::process_layer(
-    // Write into the output file.
-    FILE                            *file,
+std::string GCode::process_layer(
     const Print                     &print,
     // Set of object & print layers of the same PrintObject and with the same print_z.
     const std::vector<LayerToPrint> &layers,
     const LayerTools  &layer_tools,
+    // Distance fields of the layers below the layers, one per LayerToPrint.
+    std::vector<std::unique_ptr<EdgeGrid::Grid>> &lower_layer_edge_grids,
     // If set to size_t(-1), then print all copies of all objects.
     // Otherwise print a single copy of a single object.
     const size_t                     single_object_idx)
@@ -1240,10 +1348,11 @@ void GCode::process_layer(
 //    assert(! layer_tools.extruders.empty());
     // Either printing all copies of all objects, or just a single copy of a single object.
     assert(single_object_idx == size_t(-1) || layers.size() == 1);
+    assert(lower_layer_edge_grids.size() == layers.size());
 
     if (layer_tools.extruders.empty())
         // Nothing to extrude.
-        return;
+        return std::string();
 
     // Extract 1st object_layer and support_layer of this set of layers with an equal print_z.
     const Layer         *object_layer  = nullptr;
@@ -1517,7 +1626,6 @@ void GCode::process_layer(
 
 
     // Extrude the skirt, brim, support, perimeters, infill ordered by the extruders.
-    std::vector<std::unique_ptr<EdgeGrid::Grid>> lower_layer_edge_grids(layers.size());
     for (unsigned int extruder_id : layer_tools.extruders)
     {
         gcode += (layer_tools.has_wipe_tower && m_wipe_tower) ?
@@ -1603,9 +1711,8 @@ void GCode::process_layer(
                     this->set_origin(unscale(copy));
                     if (object_by_extruder.support != nullptr && !print_wipe_extrusions) {
                         m_layer = layers[layer_id].support_layer;
-                        gcode += this->extrude_support(
-                            // support_extrusion_role is erSupportMaterial, erSupportMaterialInterface or erMixed for all extrusion paths.
-                            object_by_extruder.support->chained_path_from(m_last_pos, false, object_by_extruder.support_extrusion_role));
+                        // support_extrusion_role is erSupportMaterial, erSupportMaterialInterface or erMixed for all extrusion paths.
+                        gcode += this->extrude_support(*object_by_extruder.support, object_by_extruder.support_extrusion_role);
                         m_layer = layers[layer_id].layer();
                     }
                     for (ObjectByExtruder::Island &island : object_by_extruder.islands) {
@@ -1643,7 +1750,7 @@ void GCode::process_layer(
         gcode = m_pressure_equalizer->process(gcode.c_str(), false);
     // printf("G-code after filter:\n%s\n", out.c_str());
     
-    _write(file, gcode);
+    return gcode;
 }
 
 void GCode::apply_print_config(const PrintConfig &print_config)
@@ -1940,10 +2047,7 @@ std::string GCode::extrude_loop(ExtrusionLoop loop, std::string description, dou
     if (m_layer->lower_layer != nullptr && lower_layer_edge_grid != nullptr) {
         if (! *lower_layer_edge_grid) {
             // Create the distance field for a layer below.
-            const coord_t distance_field_resolution = coord_t(scale_(1.) + 0.5);
-            *lower_layer_edge_grid = make_unique<EdgeGrid::Grid>();
-            (*lower_layer_edge_grid)->create(m_layer->lower_layer->slices, distance_field_resolution);
-            (*lower_layer_edge_grid)->calculate_sdf();
+            *lower_layer_edge_grid = make_lower_layer_edge_grid(*m_layer->lower_layer);
             #if 0
             {
                 static int iRun = 0;
@@ -2248,24 +2352,43 @@ std::string GCode::extrude_perimeters(const Print &print, const std::vector<Obje
     std::string gcode;
     for (const ObjectByExtruder::Island::Region &region : by_region) {
         m_config.apply(print.regions()[&region - &by_region.front()]->config());
-        for (ExtrusionEntity *ee : region.perimeters.entities)
+        for (const ExtrusionEntity *ee : region.perimeters)
             gcode += this->extrude_entity(*ee, "perimeter", -1., &lower_layer_edge_grid);
     }
     return gcode;
 }
 
+// Order the extrusion entities by a greedy algorithm to minimize a travel distance, see ExtrusionEntityCollection::chained_path_from().
+// The entities are referenced, only the entities to be extruded from their last point are copied and reversed into reversed.
+static std::vector<const ExtrusionEntity*> chained_extrusion_entities(
+    const std::vector<const ExtrusionEntity*> &entities, const Point &start_near, std::vector<std::unique_ptr<ExtrusionEntity>> &reversed)
+{
+    std::vector<const ExtrusionEntity*> out;
+    out.reserve(entities.size());
+    for (const std::pair<size_t, bool> &chained : chain_extrusion_entities(entities, start_near)) {
+        const ExtrusionEntity *entity = entities[chained.first];
+        if (chained.second) {
+            reversed.emplace_back(entity->clone());
+            reversed.back()->reverse();
+            entity = reversed.back().get();
+        }
+        out.emplace_back(entity);
+    }
+    return out;
+}
+
 // Chain the paths hierarchically by a greedy algorithm to minimize a travel distance.
 std::string GCode::extrude_infill(const Print &print, const std::vector<ObjectByExtruder::Island::Region> &by_region)
 {
     std::string gcode;
     for (const ObjectByExtruder::Island::Region &region : by_region) {
         m_config.apply(print.regions()[&region - &by_region.front()]->config());
-		ExtrusionEntityCollection chained = region.infills.chained_path_from(m_last_pos, false);
-        for (ExtrusionEntity *fill : chained.entities) {
-            auto *eec = dynamic_cast<ExtrusionEntityCollection*>(fill);
+        std::vector<std::unique_ptr<ExtrusionEntity>> reversed;
+        for (const ExtrusionEntity *fill : chained_extrusion_entities(region.infills, m_last_pos, reversed)) {
+            auto *eec = dynamic_cast<const ExtrusionEntityCollection*>(fill);
             if (eec) {
-				ExtrusionEntityCollection chained2 = eec->chained_path_from(m_last_pos, false);
-				for (ExtrusionEntity *ee : chained2.entities)
+                std::vector<const ExtrusionEntity*> entities(eec->entities.begin(), eec->entities.end());
+                for (const ExtrusionEntity *ee : eec->no_sort ? entities : chained_extrusion_entities(entities, m_last_pos, reversed))
                     gcode += this->extrude_entity(*ee, "infill");
             } else
                 gcode += this->extrude_entity(*fill, "infill");
@@ -2274,7 +2397,8 @@ std::string GCode::extrude_infill(const Print &print, const std::vector<ObjectBy
     return gcode;
 }
 
-std::string GCode::extrude_support(const ExtrusionEntityCollection &support_fills)
+// Extrude the support extrusions of the extrusion_role (erMixed for all of them) ordered to minimize a travel distance.
+std::string GCode::extrude_support(const ExtrusionEntityCollection &support_fills, ExtrusionRole extrusion_role)
 {
     std::string gcode;
     if (! support_fills.entities.empty()) {
@@ -2282,7 +2406,15 @@ std::string GCode::extrude_support(const ExtrusionEntityCollection &support_fill
         const char   *support_interface_label  = "support material interface";
         const double  support_speed            = m_config.support_material_speed.value;
         const double  support_interface_speed  = m_config.support_material_interface_speed.get_abs_value(support_speed);
-        for (const ExtrusionEntity *ee : support_fills.entities) {
+        std::vector<const ExtrusionEntity*> entities;
+        entities.reserve(support_fills.entities.size());
+        for (const ExtrusionEntity *ee : support_fills.entities)
+            if (support_fills.no_sort || extrusion_role == erMixed || ee->role() == extrusion_role)
+                entities.emplace_back(ee);
+        std::vector<std::unique_ptr<ExtrusionEntity>> reversed;
+        if (! support_fills.no_sort)
+            entities = chained_extrusion_entities(entities, m_last_pos, reversed);
+        for (const ExtrusionEntity *ee : entities) {
             ExtrusionRole role = ee->role();
             assert(role == erSupportMaterial || role == erSupportMaterialInterface);
             const char  *label = (role == erSupportMaterial) ? support_label : support_interface_label;
@@ -2304,15 +2436,29 @@ std::string GCode::extrude_support(const ExtrusionEntityCollection &support_fill
 void GCode::_write(FILE* file, const char *what)
 {
     if (what != nullptr) {
-        // apply analyzer, if enabled
-        const char* gcode = m_enable_analyzer ? m_analyzer.process_gcode(what).c_str() : what;
+        // Parse the G-code just once, pass the parsed lines to the analyzer (if enabled) and to the time estimators.
+        // The analyzer removes its workcodes from the G-code.
+        m_write_buffer.clear();
+        auto action = [this](GCodeReader &, const GCodeReader::GCodeLine &line) {
+            if (m_enable_analyzer) {
+                if (! m_analyzer.process_gcode_line(line))
+                    return;
+                m_write_buffer += line.raw();
+                m_write_buffer += '\n';
+            }
+            m_normal_time_estimator.add_gcode_line(line);
+            if (m_silent_time_estimator_enabled)
+                m_silent_time_estimator.add_gcode_line(line);
+        };
+        GCodeReader::GCodeLine gline;
+        for (const char *ptr = what; *ptr != 0;) {
+            gline.reset();
+            ptr = m_write_parser.parse_line(ptr, gline, action);
+        }
 
         // writes string to file
+        const char *gcode = m_enable_analyzer ? m_write_buffer.c_str() : what;
         fwrite(gcode, 1, ::strlen(gcode), file);
-        // updates time estimator and gcode lines vector
-        m_normal_time_estimator.add_gcode_block(gcode);
-        if (m_silent_time_estimator_enabled)
-            m_silent_time_estimator.add_gcode_block(gcode);
     }
 }
 
@@ -2702,8 +2848,8 @@ const std::vector<GCode::ObjectByExtruder::Island::Region>& GCode::ObjectByExtru
         // Now we are going to iterate through perimeters and infills and pick ones that are supposed to be printed
         // References are used so that we don't have to repeat the same code
         for (int iter = 0; iter < 2; ++iter) {
-            const ExtrusionEntitiesPtr&         entities     = (iter ? reg.infills.entities : reg.perimeters.entities);
-            ExtrusionEntityCollection&          target_eec   = (iter ? by_region_per_copy_cache.back().infills : by_region_per_copy_cache.back().perimeters);
+            const std::vector<const ExtrusionEntity*>& entities     = (iter ? reg.infills : reg.perimeters);
+            std::vector<const ExtrusionEntity*>&       target_eec   = (iter ? by_region_per_copy_cache.back().infills : by_region_per_copy_cache.back().perimeters);
             const std::vector<const ExtruderPerCopy*>& overrides   = (iter ? reg.infills_overrides : reg.perimeters_overrides);
 
             // Now the most important thing - which extrusion should we print.
@@ -2712,7 +2858,7 @@ const std::vector<GCode::ObjectByExtruder::Island::Region>& GCode::ObjectByExtru
 
             for (unsigned int i=0;i<entities.size();++i)
                 if (overrides[i]->at(copy) == this_extruder_mark)   // this copy should be printed with this extruder
-                    target_eec.append((*entities[i]));
+                    target_eec.emplace_back(entities[i]);
         }
     }
     return by_region_per_copy_cache;
@@ -2725,7 +2871,7 @@ const std::vector<GCode::ObjectByExtruder::Island::Region>& GCode::ObjectByExtru
 void GCode::ObjectByExtruder::Island::Region::append(const std::string& type, const ExtrusionEntityCollection* eec, const ExtruderPerCopy* copies_extruder, unsigned int object_copies_num)
 {
     // We are going to manipulate either perimeters or infills, exactly in the same way. Let's create pointers to the proper structure to not repeat ourselves:
-    ExtrusionEntityCollection* perimeters_or_infills = &infills;
+    std::vector<const ExtrusionEntity*>* perimeters_or_infills = &infills;
     std::vector<const ExtruderPerCopy*>* perimeters_or_infills_overrides = &infills_overrides;
 
     if (type == "perimeters") {
@@ -2740,7 +2886,7 @@ void GCode::ObjectByExtruder::Island::Region::append(const std::string& type, co
 
 
     // First we append the entities, there are eec->entities.size() of them:
-    perimeters_or_infills->append(eec->entities);
+    perimeters_or_infills->insert(perimeters_or_infills->end(), eec->entities.begin(), eec->entities.end());
 
     for (unsigned int i=0;i<eec->entities.size();++i)
         perimeters_or_infills_overrides->push_back(copies_extruder);
@@ -43,13 +43,17 @@ public:
     ~AvoidCrossingPerimeters() {}
 
     void init_external_mp(const ExPolygons &islands) { m_external_mp = Slic3r::make_unique<MotionPlanner>(islands); }
-    void init_layer_mp(const ExPolygons &islands) { m_layer_mp = Slic3r::make_unique<MotionPlanner>(islands); }
+    // Keeps the current layer motion planner together with its lazily built graphs if the islands did not change,
+    // which is the case for consecutive layers of prismatic objects and for identical objects printed at the same height.
+    void init_layer_mp(const ExPolygons &islands);
 
     Polyline travel_to(const GCode &gcodegen, const Point &point);
 
 private:
     std::unique_ptr<MotionPlanner> m_external_mp;
     std::unique_ptr<MotionPlanner> m_layer_mp;
+    // Islands m_layer_mp was created for.
+    ExPolygons                     m_layer_mp_islands;
 };
 
 class OozePrevention {
@@ -194,16 +198,32 @@ protected:
     };
     static std::vector<GCode::LayerToPrint>                            collect_layers_to_print(const PrintObject &object);
     static std::vector<std::pair<coordf_t, std::vector<LayerToPrint>>> collect_layers_to_print(const Print &print);
-    void            process_layer(
+    // Generate and write the G-code of a sequence of layers. The layer data not depending on the G-code generator state
+    // is prepared in parallel, the G-code is generated sequentially and written out by a background task.
+    void            process_layers(
         // Write into the output file.
         FILE                            *file,
+        const Print                     &print,
+        const ToolOrdering              &tool_ordering,
+        // Sets of object & print layers with the same print_z, sorted by print_z.
+        const std::vector<std::pair<coordf_t, std::vector<LayerToPrint>>> &layers,
+        // If set to size_t(-1), then print all copies of all objects.
+        // Otherwise print a single copy of a single object.
+        const size_t                     single_object_idx = size_t(-1));
+    // Returns the G-code of a single layer.
+    std::string     process_layer(
         const Print                     &print,
         // Set of object & print layers of the same PrintObject and with the same print_z.
         const std::vector<LayerToPrint> &layers,
         const LayerTools  &layer_tools,
+        // Distance fields of the layers below the layers, one per LayerToPrint, see make_lower_layer_edge_grids().
+        std::vector<std::unique_ptr<EdgeGrid::Grid>> &lower_layer_edge_grids,
         // If set to size_t(-1), then print all copies of all objects.
         // Otherwise print a single copy of a single object.
         const size_t                     single_object_idx = size_t(-1));
+    // Distance fields of the layers below the object layers, used for the seam placement by extrude_loop().
+    // Only calculated for the object layers with perimeters, empty otherwise. Thread safe.
+    static std::vector<std::unique_ptr<EdgeGrid::Grid>> make_lower_layer_edge_grids(const std::vector<LayerToPrint> &layers);
 
     void            set_last_pos(const Point &pos) { m_last_pos = pos; m_last_pos_defined = true; }
     bool            last_pos_defined() const { return m_last_pos_defined; }
@@ -229,8 +249,10 @@ protected:
         struct Island
         {
             struct Region {
-                ExtrusionEntityCollection perimeters;
-                ExtrusionEntityCollection infills;
+                // Non-owned references to the entities of LayerRegion::perimeters and LayerRegion::fills,
+                // the extrusions are not copied for the G-code export.
+                std::vector<const ExtrusionEntity*> perimeters;
+                std::vector<const ExtrusionEntity*> infills;
 
                 std::vector<const ExtruderPerCopy*> infills_overrides;
                 std::vector<const ExtruderPerCopy*> perimeters_overrides;
@@ -251,7 +273,7 @@ protected:
 
     std::string     extrude_perimeters(const Print &print, const std::vector<ObjectByExtruder::Island::Region> &by_region, std::unique_ptr<EdgeGrid::Grid> &lower_layer_edge_grid);
     std::string     extrude_infill(const Print &print, const std::vector<ObjectByExtruder::Island::Region> &by_region);
-    std::string     extrude_support(const ExtrusionEntityCollection &support_fills);
+    std::string     extrude_support(const ExtrusionEntityCollection &support_fills, ExtrusionRole extrusion_role);
 
     std::string     travel_to(const Point &point, ExtrusionRole role, std::string comment);
     bool            needs_retraction(const Polyline &travel, ExtrusionRole role = erNone);
@@ -329,6 +351,11 @@ protected:
     // Analyzer
     GCodeAnalyzer m_analyzer;
 
+    // Parser of the G-code passed to _write(), shared by the analyzer and the time estimators.
+    GCodeReader m_write_parser;
+    // Output of the analyzer, reused by _write() to avoid reallocations.
+    std::string m_write_buffer;
+
     // Write a string into a file.
     void _write(FILE* file, const std::string& what) { this->_write(file, what.c_str()); }
     void _write(FILE* file, const char *what);
@@ -1,6 +1,9 @@
 #include <memory.h>
 #include <string.h>
 #include <float.h>
+#include <map>
+
+#include <tbb/parallel_for.h>
 
 #include "../libslic3r.h"
 #include "../PrintConfig.hpp"
@@ -77,22 +80,37 @@ bool GCodeAnalyzer::Metadata::operator != (const GCodeAnalyzer::Metadata& other)
     return false;
 }
 
-GCodeAnalyzer::GCodeMove::GCodeMove(GCodeMove::EType type, ExtrusionRole extrusion_role, unsigned int extruder_id, double mm3_per_mm, float width, float height, float feedrate, const Vec3d& start_position, const Vec3d& end_position, float delta_extruder, unsigned int cp_color_id/* = 0*/)
-    : type(type)
-    , data(extrusion_role, extruder_id, mm3_per_mm, width, height, feedrate, cp_color_id)
-    , start_position(start_position)
-    , end_position(end_position)
-    , delta_extruder(delta_extruder)
+void GCodeAnalyzer::GCodeMovesList::clear()
+{
+    start_position.clear();
+    end_position.clear();
+    delta_extruder.clear();
+    width.clear();
+    height.clear();
+    feedrate.clear();
+    mm3_per_mm.clear();
+    extrusion_role.clear();
+    extruder_id.clear();
+    cp_color_id.clear();
+}
+
+void GCodeAnalyzer::GCodeMovesList::append(const GCodeAnalyzer::Metadata& data, const Vec3f& start_position, const Vec3f& end_position, float delta_extruder)
 {
+    this->start_position.emplace_back(start_position);
+    this->end_position.emplace_back(end_position);
+    this->delta_extruder.emplace_back(delta_extruder);
+    this->width.emplace_back(data.width);
+    this->height.emplace_back(data.height);
+    this->feedrate.emplace_back(data.feedrate);
+    this->mm3_per_mm.emplace_back(data.mm3_per_mm);
+    this->extrusion_role.emplace_back((unsigned char)data.extrusion_role);
+    this->extruder_id.emplace_back(data.extruder_id);
+    this->cp_color_id.emplace_back(data.cp_color_id);
 }
 
-GCodeAnalyzer::GCodeMove::GCodeMove(GCodeMove::EType type, const GCodeAnalyzer::Metadata& data, const Vec3d& start_position, const Vec3d& end_position, float delta_extruder)
-    : type(type)
-    , data(data)
-    , start_position(start_position)
-    , end_position(end_position)
-    , delta_extruder(delta_extruder)
+GCodeAnalyzer::Metadata GCodeAnalyzer::GCodeMovesList::metadata(size_t idx) const
 {
+    return Metadata((ExtrusionRole)extrusion_role[idx], extruder_id[idx], mm3_per_mm[idx], width[idx], height[idx], feedrate[idx], cp_color_id[idx]);
 }
 
 GCodeAnalyzer::GCodeAnalyzer()
@@ -116,7 +134,8 @@ void GCodeAnalyzer::reset()
     _set_start_extrusion(DEFAULT_START_EXTRUSION);
     _reset_axes_position();
 
-    m_moves_map.clear();
+    for (GCodeMovesList& moves : m_moves)
+        moves.clear();
 }
 
 const std::string& GCodeAnalyzer::process_gcode(const std::string& gcode)
@@ -154,15 +173,22 @@ bool GCodeAnalyzer::is_valid_extrusion_role(ExtrusionRole role)
 }
 
 void GCodeAnalyzer::_process_gcode_line(GCodeReader&, const GCodeReader::GCodeLine& line)
+{
+    if (this->process_gcode_line(line))
+        // puts the line back into the gcode
+        m_process_output += line.raw() + "\n";
+}
+
+bool GCodeAnalyzer::process_gcode_line(const GCodeReader::GCodeLine& line)
 {
     // processes 'special' comments contained in line
     if (_process_tags(line))
     {
 #if 0
         // DEBUG ONLY: puts the line back into the gcode
-        m_process_output += line.raw() + "\n";
+        return true;
 #endif
-        return;
+        return false;
     }
 
     // sets new start position/extrusion
@@ -254,8 +280,7 @@ void GCodeAnalyzer::_process_gcode_line(GCodeReader&, const GCodeReader::GCodeLi
         }
     }
 
-    // puts the line back into the gcode
-    m_process_output += line.raw() + "\n";
+    return true;
 }
 
 // Returns the new absolute position on the given axis in dependence of the given parameters
@@ -647,13 +672,7 @@ Vec3d GCodeAnalyzer::_get_end_position() const
 
 void GCodeAnalyzer::_store_move(GCodeAnalyzer::GCodeMove::EType type)
 {
-    // if type non mapped yet, map it
-    TypeToMovesMap::iterator it = m_moves_map.find(type);
-    if (it == m_moves_map.end())
-        it = m_moves_map.insert(TypeToMovesMap::value_type(type, GCodeMovesList())).first;
-
-    // store move
-    it->second.emplace_back(type, _get_extrusion_role(), _get_extruder_id(), _get_mm3_per_mm(), _get_width(), _get_height(), _get_feedrate(), _get_start_position(), _get_end_position(), _get_delta_extrusion(), _get_cp_color_id());
+    m_moves[type].append(m_state.data, _get_start_position().cast<float>(), _get_end_position().cast<float>(), _get_delta_extrusion());
 }
 
 bool GCodeAnalyzer::_is_valid_extrusion_role(int value) const
@@ -663,88 +682,70 @@ bool GCodeAnalyzer::_is_valid_extrusion_role(int value) const
 
 void GCodeAnalyzer::_calc_gcode_preview_extrusion_layers(GCodePreviewData& preview_data)
 {
-    struct Helper
-    {
-        static GCodePreviewData::Extrusion::Layer& get_layer_at_z(GCodePreviewData::Extrusion::LayersList& layers, float z)
-        {
-            for (GCodePreviewData::Extrusion::Layer& layer : layers)
-            {
-                // if layer found, return it
-                if (layer.z == z)
-                    return layer;
-            }
-
-            // if layer not found, create and return it
-            layers.emplace_back(z, ExtrusionPaths());
-            return layers.back();
-        }
-
-        static void store_polyline(const Polyline& polyline, const Metadata& data, float z, GCodePreviewData& preview_data)
-        {
-            // if the polyline is valid, create the extrusion path from it and store it
-            if (polyline.is_valid())
-            {
-                ExtrusionPath path(data.extrusion_role, data.mm3_per_mm, data.width, data.height);
-                path.polyline = polyline;
-                path.feedrate = data.feedrate;
-                path.extruder_id = data.extruder_id;
-                path.cp_color_id = data.cp_color_id;
-
-                get_layer_at_z(preview_data.extrusion.layers, z).paths.push_back(path);
-            }
-        }
-    };
-
-    TypeToMovesMap::iterator extrude_moves = m_moves_map.find(GCodeMove::Extrude);
-    if (extrude_moves == m_moves_map.end())
+    const GCodeMovesList& moves = m_moves[GCodeMove::Extrude];
+    if (moves.empty())
         return;
 
-    Metadata data;
-    float z = FLT_MAX;
-    Polyline polyline;
-    Vec3d position(FLT_MAX, FLT_MAX, FLT_MAX);
-    float volumetric_rate = FLT_MAX;
+    // Detects the first move of each polyline. A polyline is continued by the next move
+    // if the move starts where the previous one ended and its metadata do not change.
+    std::vector<size_t> polyline_starts;
     GCodePreviewData::Range height_range;
     GCodePreviewData::Range width_range;
     GCodePreviewData::Range feedrate_range;
     GCodePreviewData::Range volumetric_rate_range;
-
-    // constructs the polylines while traversing the moves
-    for (const GCodeMove& move : extrude_moves->second)
+    for (size_t i = 0; i < moves.size(); ++i)
     {
-        if ((data != move.data) || (z != move.start_position.z()) || (position != move.start_position) || (volumetric_rate != move.data.feedrate * (float)move.data.mm3_per_mm))
+        if ((i == 0) || (moves.metadata(i - 1) != moves.metadata(i)) || (moves.start_position[i - 1].z() != moves.start_position[i].z()) || 
+            (moves.end_position[i - 1] != moves.start_position[i]) || (moves.volumetric_rate(i - 1) != moves.volumetric_rate(i)))
         {
-            // store current polyline
-            polyline.remove_duplicate_points();
-            Helper::store_polyline(polyline, data, z, preview_data);
-
-            // reset current polyline
-            polyline = Polyline();
-
-            // add both vertices of the move
-            polyline.append(Point(scale_(move.start_position.x()), scale_(move.start_position.y())));
-            polyline.append(Point(scale_(move.end_position.x()), scale_(move.end_position.y())));
-
-            // update current values
-            data = move.data;
-            z = (float)move.start_position.z();
-            volumetric_rate = move.data.feedrate * (float)move.data.mm3_per_mm;
-            height_range.update_from(move.data.height);
-            width_range.update_from(move.data.width);
-            feedrate_range.update_from(move.data.feedrate);
-            volumetric_rate_range.update_from(volumetric_rate);
+            polyline_starts.emplace_back(i);
+            height_range.update_from(moves.height[i]);
+            width_range.update_from(moves.width[i]);
+            feedrate_range.update_from(moves.feedrate[i]);
+            volumetric_rate_range.update_from(moves.volumetric_rate(i));
         }
-        else
-            // append end vertex of the move to current polyline
-            polyline.append(Point(scale_(move.end_position.x()), scale_(move.end_position.y())));
-
-        // update current values
-        position = move.end_position;
     }
+    polyline_starts.emplace_back(moves.size());
 
-    // store last polyline
-    polyline.remove_duplicate_points();
-    Helper::store_polyline(polyline, data, z, preview_data);
+    // Constructs the extrusion paths in parallel.
+    ExtrusionPaths paths(polyline_starts.size() - 1, ExtrusionPath(erNone));
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, paths.size()),
+        [&moves, &polyline_starts, &paths](const tbb::blocked_range<size_t>& range) {
+        for (size_t idx_path = range.begin(); idx_path < range.end(); ++idx_path)
+        {
+            size_t begin = polyline_starts[idx_path];
+            size_t end = polyline_starts[idx_path + 1];
+            ExtrusionPath& path = paths[idx_path];
+            path = ExtrusionPath((ExtrusionRole)moves.extrusion_role[begin], moves.mm3_per_mm[begin], moves.width[begin], moves.height[begin]);
+            path.feedrate = moves.feedrate[begin];
+            path.extruder_id = moves.extruder_id[begin];
+            path.cp_color_id = moves.cp_color_id[begin];
+            Points& points = path.polyline.points;
+            points.reserve(end - begin + 1);
+            points.emplace_back(scale_(moves.start_position[begin].x()), scale_(moves.start_position[begin].y()));
+            for (size_t i = begin; i < end; ++i)
+                points.emplace_back(scale_(moves.end_position[i].x()), scale_(moves.end_position[i].y()));
+            path.polyline.remove_duplicate_points();
+        }
+    });
+
+    // Distributes the valid paths into the layers, the layers are ordered by their first path.
+    std::map<float, size_t> layer_at_z;
+    for (size_t idx_path = 0; idx_path < paths.size(); ++idx_path)
+    {
+        ExtrusionPath& path = paths[idx_path];
+        if (!path.polyline.is_valid())
+            continue;
+
+        float z = moves.start_position[polyline_starts[idx_path]].z();
+        auto it = layer_at_z.find(z);
+        if (it == layer_at_z.end())
+        {
+            it = layer_at_z.emplace(z, preview_data.extrusion.layers.size()).first;
+            preview_data.extrusion.layers.emplace_back(z, ExtrusionPaths());
+        }
+        preview_data.extrusion.layers[it->second].paths.emplace_back(std::move(path));
+    }
 
     // updates preview ranges data
     preview_data.ranges.height.update_from(height_range);
@@ -755,69 +756,61 @@ void GCodeAnalyzer::_calc_gcode_preview_extrusion_layers(GCodePreviewData& previ
 
 void GCodeAnalyzer::_calc_gcode_preview_travel(GCodePreviewData& preview_data)
 {
-    struct Helper
-    {
-        static void store_polyline(const Polyline3& polyline, GCodePreviewData::Travel::EType type, GCodePreviewData::Travel::Polyline::EDirection direction, 
-            float feedrate, unsigned int extruder_id, GCodePreviewData& preview_data)
-        {
-            // if the polyline is valid, store it
-            if (polyline.is_valid())
-                preview_data.travel.polylines.emplace_back(type, direction, feedrate, extruder_id, polyline);
-        }
-    };
-
-    TypeToMovesMap::iterator travel_moves = m_moves_map.find(GCodeMove::Move);
-    if (travel_moves == m_moves_map.end())
+    const GCodeMovesList& moves = m_moves[GCodeMove::Move];
+    if (moves.empty())
         return;
 
-    Polyline3 polyline;
-    Vec3d position(FLT_MAX, FLT_MAX, FLT_MAX);
-    GCodePreviewData::Travel::EType type = GCodePreviewData::Travel::Num_Types;
-    GCodePreviewData::Travel::Polyline::EDirection direction = GCodePreviewData::Travel::Polyline::Num_Directions;
-    float feedrate = FLT_MAX;
-    unsigned int extruder_id = -1;
+    auto move_type = [&moves](size_t i) {
+        return (moves.delta_extruder[i] < 0.0f) ? GCodePreviewData::Travel::Retract : ((moves.delta_extruder[i] > 0.0f) ? GCodePreviewData::Travel::Extrude : GCodePreviewData::Travel::Move);
+    };
 
+    // Detects the first move of each polyline.
+    // The direction of the polylines is not tracked, therefore each move starts a new polyline, as it always did.
+    std::vector<size_t> polyline_starts;
     GCodePreviewData::Range height_range;
     GCodePreviewData::Range width_range;
     GCodePreviewData::Range feedrate_range;
-
-    // constructs the polylines while traversing the moves
-    for (const GCodeMove& move : travel_moves->second)
+    GCodePreviewData::Travel::Polyline::EDirection direction = GCodePreviewData::Travel::Polyline::Num_Directions;
+    for (size_t i = 0; i < moves.size(); ++i)
     {
-        GCodePreviewData::Travel::EType move_type = (move.delta_extruder < 0.0f) ? GCodePreviewData::Travel::Retract : ((move.delta_extruder > 0.0f) ? GCodePreviewData::Travel::Extrude : GCodePreviewData::Travel::Move);
-        GCodePreviewData::Travel::Polyline::EDirection move_direction = ((move.start_position.x() != move.end_position.x()) || (move.start_position.y() != move.end_position.y())) ? GCodePreviewData::Travel::Polyline::Generic : GCodePreviewData::Travel::Polyline::Vertical;
+        GCodePreviewData::Travel::Polyline::EDirection move_direction = ((moves.start_position[i].x() != moves.end_position[i].x()) || (moves.start_position[i].y() != moves.end_position[i].y())) ? GCodePreviewData::Travel::Polyline::Generic : GCodePreviewData::Travel::Polyline::Vertical;
+        if ((i == 0) || (move_type(i - 1) != move_type(i)) || (direction != move_direction) || (moves.feedrate[i - 1] != moves.feedrate[i]) || 
+            (moves.end_position[i - 1] != moves.start_position[i]) || (moves.extruder_id[i - 1] != moves.extruder_id[i]))
+            polyline_starts.emplace_back(i);
+
+        height_range.update_from(moves.height[i]);
+        width_range.update_from(moves.width[i]);
+        feedrate_range.update_from(moves.feedrate[i]);
+    }
+    polyline_starts.emplace_back(moves.size());
 
-        if ((type != move_type) || (direction != move_direction) || (feedrate != move.data.feedrate) || (position != move.start_position) || (extruder_id != move.data.extruder_id))
+    // Constructs the polylines in parallel.
+    std::vector<Polyline3> polylines(polyline_starts.size() - 1);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, polylines.size()),
+        [&moves, &polyline_starts, &polylines](const tbb::blocked_range<size_t>& range) {
+        for (size_t idx_polyline = range.begin(); idx_polyline < range.end(); ++idx_polyline)
         {
-            // store current polyline
-            polyline.remove_duplicate_points();
-            Helper::store_polyline(polyline, type, direction, feedrate, extruder_id, preview_data);
-
-            // reset current polyline
-            polyline = Polyline3();
+            size_t begin = polyline_starts[idx_polyline];
+            size_t end = polyline_starts[idx_polyline + 1];
+            Points3& points = polylines[idx_polyline].points;
+            points.reserve(end - begin + 1);
+            points.emplace_back(scale_(moves.start_position[begin].x()), scale_(moves.start_position[begin].y()), scale_(moves.start_position[begin].z()));
+            for (size_t i = begin; i < end; ++i)
+                points.emplace_back(scale_(moves.end_position[i].x()), scale_(moves.end_position[i].y()), scale_(moves.end_position[i].z()));
+            polylines[idx_polyline].remove_duplicate_points();
+        }
+    });
 
-            // add both vertices of the move
-            polyline.append(Vec3crd(scale_(move.start_position.x()), scale_(move.start_position.y()), scale_(move.start_position.z())));
-            polyline.append(Vec3crd(scale_(move.end_position.x()), scale_(move.end_position.y()), scale_(move.end_position.z())));
+    // stores the valid polylines
+    for (size_t idx_polyline = 0; idx_polyline < polylines.size(); ++idx_polyline)
+    {
+        if (polylines[idx_polyline].is_valid())
+        {
+            size_t i = polyline_starts[idx_polyline];
+            preview_data.travel.polylines.emplace_back(move_type(i), direction, moves.feedrate[i], moves.extruder_id[i], std::move(polylines[idx_polyline]));
         }
-        else
-            // append end vertex of the move to current polyline
-            polyline.append(Vec3crd(scale_(move.end_position.x()), scale_(move.end_position.y()), scale_(move.end_position.z())));
-
-        // update current values
-        position = move.end_position;
-        type = move_type;
-        feedrate = move.data.feedrate;
-        extruder_id = move.data.extruder_id;
-        height_range.update_from(move.data.height);
-        width_range.update_from(move.data.width);
-        feedrate_range.update_from(move.data.feedrate);
     }
 
-    // store last polyline
-    polyline.remove_duplicate_points();
-    Helper::store_polyline(polyline, type, direction, feedrate, extruder_id, preview_data);
-
     // updates preview ranges data
     preview_data.ranges.height.update_from(height_range);
     preview_data.ranges.width.update_from(width_range);
@@ -826,29 +819,23 @@ void GCodeAnalyzer::_calc_gcode_preview_travel(GCodePreviewData& preview_data)
 
 void GCodeAnalyzer::_calc_gcode_preview_retractions(GCodePreviewData& preview_data)
 {
-    TypeToMovesMap::iterator retraction_moves = m_moves_map.find(GCodeMove::Retract);
-    if (retraction_moves == m_moves_map.end())
-        return;
-
-    for (const GCodeMove& move : retraction_moves->second)
+    const GCodeMovesList& moves = m_moves[GCodeMove::Retract];
+    for (size_t i = 0; i < moves.size(); ++i)
     {
         // store position
-        Vec3crd position(scale_(move.start_position.x()), scale_(move.start_position.y()), scale_(move.start_position.z()));
-        preview_data.retraction.positions.emplace_back(position, move.data.width, move.data.height);
+        Vec3crd position(scale_(moves.start_position[i].x()), scale_(moves.start_position[i].y()), scale_(moves.start_position[i].z()));
+        preview_data.retraction.positions.emplace_back(position, moves.width[i], moves.height[i]);
     }
 }
 
 void GCodeAnalyzer::_calc_gcode_preview_unretractions(GCodePreviewData& preview_data)
 {
-    TypeToMovesMap::iterator unretraction_moves = m_moves_map.find(GCodeMove::Unretract);
-    if (unretraction_moves == m_moves_map.end())
-        return;
-
-    for (const GCodeMove& move : unretraction_moves->second)
+    const GCodeMovesList& moves = m_moves[GCodeMove::Unretract];
+    for (size_t i = 0; i < moves.size(); ++i)
     {
         // store position
-        Vec3crd position(scale_(move.start_position.x()), scale_(move.start_position.y()), scale_(move.start_position.z()));
-        preview_data.unretraction.positions.emplace_back(position, move.data.width, move.data.height);
+        Vec3crd position(scale_(moves.start_position[i].x()), scale_(moves.start_position[i].y()), scale_(moves.start_position[i].z()));
+        preview_data.unretraction.positions.emplace_back(position, moves.width[i], moves.height[i]);
     }
 }
 
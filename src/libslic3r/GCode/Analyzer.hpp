@@ -73,19 +73,31 @@ public:
             Extrude,
             Num_Types
         };
-
-        EType type;
-        Metadata data;
-        Vec3d start_position;
-        Vec3d end_position;
-        float delta_extruder;
-
-        GCodeMove(EType type, ExtrusionRole extrusion_role, unsigned int extruder_id, double mm3_per_mm, float width, float height, float feedrate, const Vec3d& start_position, const Vec3d& end_position, float delta_extruder, unsigned int cp_color_id = 0);
-        GCodeMove(EType type, const Metadata& data, const Vec3d& start_position, const Vec3d& end_position, float delta_extruder);
     };
 
-    typedef std::vector<GCodeMove> GCodeMovesList;
-    typedef std::map<GCodeMove::EType, GCodeMovesList> TypeToMovesMap;
+    // Moves of a single type stored as a structure of arrays. A large G-code produces millions of moves,
+    // the flat arrays keep the memory footprint low and they are cheap to grow.
+    // The positions are stored as floats, the analyzer tracks the axes positions as floats anyway.
+    struct GCodeMovesList
+    {
+        std::vector<Vec3f>          start_position;
+        std::vector<Vec3f>          end_position;
+        std::vector<float>          delta_extruder;
+        std::vector<float>          width;      // mm
+        std::vector<float>          height;     // mm
+        std::vector<float>          feedrate;   // mm/s
+        std::vector<double>         mm3_per_mm;
+        std::vector<unsigned char>  extrusion_role;
+        std::vector<unsigned int>   extruder_id;
+        std::vector<unsigned int>   cp_color_id;
+
+        size_t   size() const { return start_position.size(); }
+        bool     empty() const { return start_position.empty(); }
+        void     clear();
+        void     append(const Metadata& data, const Vec3f& start_position, const Vec3f& end_position, float delta_extruder);
+        Metadata metadata(size_t idx) const;
+        float    volumetric_rate(size_t idx) const { return feedrate[idx] * (float)mm3_per_mm[idx]; }
+    };
 
 private:
     struct State
@@ -103,7 +115,7 @@ private:
 private:
     State m_state;
     GCodeReader m_parser;
-    TypeToMovesMap m_moves_map;
+    GCodeMovesList m_moves[GCodeMove::Num_Types];
 
     // The output of process_layer()
     std::string m_process_output;
@@ -117,6 +129,10 @@ public:
     // Adds the gcode contained in the given string to the analysis and returns it after removing the workcodes
     const std::string& process_gcode(const std::string& gcode);
 
+    // Adds the given gcode line, already parsed by the caller, to the analysis.
+    // Returns false if the line is a workcode, which shall be removed from the gcode.
+    bool process_gcode_line(const GCodeReader::GCodeLine& line);
+
     // Calculates all data needed for gcode visualization
     void calc_gcode_preview_data(GCodePreviewData& preview_data);
 
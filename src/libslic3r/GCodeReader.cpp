@@ -1,8 +1,14 @@
 #include "GCodeReader.hpp"
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/split.hpp>
-#include <fstream>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/nowide/fstream.hpp>
+#include <cstring>
 #include <iostream>
+#include <iterator>
+
+#include <tbb/parallel_for.h>
 
 #include <Shiny/Shiny.h>
 
@@ -20,18 +26,63 @@ void GCodeReader::apply_config(const DynamicPrintConfig &config)
     m_extrusion_axis = m_config.get_extrusion_axis()[0];
 }
 
-const char* GCodeReader::parse_line_internal(const char *ptr, GCodeLine &gline, std::pair<const char*, const char*> &command)
+// Parses a decimal number at c, returning the same value as strtod(). G-code numbers rarely have more than
+// 15 significant digits and an exponent: the mantissa is then exactly representable by a double, therefore
+// a single division by an exact power of ten produces the correctly rounded result. Exponents, long mantissas,
+// hexadecimal numbers, infinities and NaNs are left to strtod(). As with strtod(), leading spaces and tabs
+// are skipped, but not the end of line, so that a value is never read from the next line. The decimal point
+// does not depend on the locale. If there is no number at c and the word ends at c, zero is returned
+// and *pend is set to c, so that a bare axis letter as in "G92 E" reads zero as the firmware reads it.
+// Otherwise if there is no number at c, *pend is set to nullptr.
+double GCodeReader::parse_float(const char *c, const char **pend)
 {
-    PROFILE_FUNC();
-    
+    static const double pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15 };
+    const char *word_end = is_end_of_word(*c) ? c : nullptr;
+    c = skip_whitespaces(c);
+    const char *begin    = c;
+    bool        negative = *c == '-';
+    if (*c == '-' || *c == '+')
+        ++ c;
+    uint64_t    mantissa     = 0;
+    int         num_digits   = 0;
+    int         num_decimals = 0;
+    for (; *c >= '0' && *c <= '9'; ++ c, ++ num_digits)
+        mantissa = mantissa * 10 + uint64_t(*c - '0');
+    if (*c == '.')
+        for (++ c; *c >= '0' && *c <= '9'; ++ c, ++ num_digits, ++ num_decimals)
+            mantissa = mantissa * 10 + uint64_t(*c - '0');
+    if (num_digits > 0 && num_digits <= 15 && is_end_of_word(*c)) {
+        *pend = c;
+        double v = double(mantissa) / pow10[num_decimals];
+        return negative ? - v : v;
+    }
+    if (! is_end_of_word(*begin)) {
+        char   *end = nullptr;
+        double  v   = strtod(begin, &end);
+        if (end != begin) {
+            *pend = end;
+            return v;
+        }
+    }
+    // No number.
+    *pend = word_end;
+    return 0.;
+}
+
+const char* GCodeReader::decode_line(const char *ptr, DecodedLine &line) const
+{
+    memset(line.axis, 0, sizeof(line.axis));
+    line.mask  = 0;
+    line.begin = ptr;
+
     // command and args
     const char *c = ptr;
     {
         PROFILE_BLOCK(command_and_args);
         // Skip the whitespaces.
-        command.first = skip_whitespaces(c);
+        line.cmd_begin = skip_whitespaces(c);
         // Skip the command.
-        c = command.second = skip_word(command.first);
+        c = line.cmd_end = skip_word(line.cmd_begin);
         // Up to the end of line or comment.
 		while (! is_end_of_gcode_line(*c)) {
             // Skip whitespaces.
@@ -52,12 +103,12 @@ const char* GCodeReader::parse_line_internal(const char *ptr, GCodeLine &gline,
             }
             if (axis != NUM_AXES) {
                 // Try to parse the numeric value.
-                char   *pend = nullptr;
-                double  v = strtod(++ c, &pend);
+                const char *pend = nullptr;
+                double      v    = parse_float(++ c, &pend);
                 if (pend != nullptr && is_end_of_word(*pend)) {
                     // The axis value has been parsed correctly.
-                    gline.m_axis[int(axis)] = float(v);
-                    gline.m_mask |= 1 << int(axis);
+                    line.axis[int(axis)] = float(v);
+                    line.mask |= 1 << int(axis);
                     c = pend;
                 } else
                     // Skip the rest of the word.
@@ -67,29 +118,42 @@ const char* GCodeReader::parse_line_internal(const char *ptr, GCodeLine &gline,
                 c = skip_word(c);
         }
     }
-    
-    if (gline.has(E) && m_config.use_relative_e_distances)
-        m_position[E] = 0;
 
     // Skip the rest of the line.
     for (; ! is_end_of_line(*c); ++ c);
-
-    // Copy the raw string including the comment, without the trailing newlines.
-    if (c > ptr) {
-        PROFILE_BLOCK(copy_raw_string);
-        gline.m_raw.assign(ptr, c);
-    }
+    line.end = c;
 
     // Skip the trailing newlines.
 	if (*c == '\r')
 		++ c;
 	if (*c == '\n')
 		++ c;
+    return c;
+}
+
+void GCodeReader::apply_decoded(const DecodedLine &line, GCodeLine &gline)
+{
+    memcpy(gline.m_axis, line.axis, sizeof(gline.m_axis));
+    gline.m_mask = line.mask;
+    // Copy the raw string including the comment, without the trailing newlines.
+    gline.m_raw.assign(line.begin, line.end);
+
+    if (gline.has(E) && m_config.use_relative_e_distances)
+        m_position[E] = 0;
 
     if (m_verbose)
         std::cout << gline.m_raw << std::endl;
+}
 
-    return c;
+const char* GCodeReader::parse_line_internal(const char *ptr, GCodeLine &gline, std::pair<const char*, const char*> &command)
+{
+    PROFILE_FUNC();
+    DecodedLine line;
+    const char *next = this->decode_line(ptr, line);
+    command.first  = line.cmd_begin;
+    command.second = line.cmd_end;
+    this->apply_decoded(line, gline);
+    return next;
 }
 
 void GCodeReader::update_coordinates(GCodeLine &gline, std::pair<const char*, const char*> &command)
@@ -106,12 +170,93 @@ void GCodeReader::update_coordinates(GCodeLine &gline, std::pair<const char*, co
     }
 }
 
+void GCodeReader::decode_buffer(const char *begin, const char *end, DecodedLines &lines) const
+{
+    lines.clear();
+    if (begin == end)
+        return;
+
+    // Split the buffer into chunks at line boundaries. memchr() is vectorized by the C runtime.
+    static const size_t chunk_size = 1024 * 1024;
+    std::vector<const char*> chunks(1, begin);
+    for (const char *ptr = begin; size_t(end - ptr) > chunk_size;) {
+        const char *nl = (const char*)memchr(ptr + chunk_size, '\n', end - ptr - chunk_size);
+        if (nl == nullptr)
+            break;
+        ptr = nl + 1;
+        if (ptr < end)
+            chunks.emplace_back(ptr);
+    }
+    chunks.emplace_back(end);
+
+    std::vector<DecodedLines> chunk_lines(chunks.size() - 1);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, chunk_lines.size(), 1),
+        [this, &chunks, &chunk_lines](const tbb::blocked_range<size_t> &range) {
+            for (size_t i = range.begin(); i < range.end(); ++ i) {
+                DecodedLines &out = chunk_lines[i];
+                const char   *ptr = chunks[i];
+                const char   *end = chunks[i + 1];
+                // A G-code line is usually longer than 16 characters.
+                out.reserve((end - ptr) / 16);
+                while (ptr < end) {
+                    out.emplace_back();
+                    ptr = this->decode_line(ptr, out.back());
+                    if (ptr < end && *ptr == 0) {
+                        // Skip the rest of a line containing a zero character.
+                        const char *nl = (const char*)memchr(ptr, '\n', end - ptr);
+                        ptr = (nl == nullptr) ? end : nl + 1;
+                    }
+                }
+            }
+        });
+
+    size_t num_lines = 0;
+    for (const DecodedLines &out : chunk_lines)
+        num_lines += out.size();
+    lines.reserve(num_lines);
+    for (const DecodedLines &out : chunk_lines)
+        lines.insert(lines.end(), out.begin(), out.end());
+}
+
 void GCodeReader::parse_file(const std::string &file, callback_t callback)
 {
-    std::ifstream f(file);
-    std::string line;
-    while (std::getline(f, line))
-        this->parse_line(line, callback);
+    namespace bip = boost::interprocess;
+    bip::file_mapping  mapping;
+    bip::mapped_region region;
+    std::string        buffer;
+    const char        *begin = nullptr;
+    const char        *end   = nullptr;
+    try {
+        mapping = bip::file_mapping(file.c_str(), bip::read_only);
+        region  = bip::mapped_region(mapping, bip::read_only);
+        begin   = static_cast<const char*>(region.get_address());
+        end     = begin + region.get_size();
+    } catch (...) {
+        // The file could not be mapped (it is empty or it has an UTF-8 file name on Windows), read it instead.
+        boost::nowide::ifstream f(file.c_str(), std::ios::in | std::ios::binary);
+        buffer.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+        begin = buffer.data();
+        end   = begin + buffer.size();
+    }
+
+    // The last line may not be terminated by a newline, while the line decoder expects a newline or a zero.
+    const char *last_line = end;
+    while (last_line > begin && last_line[-1] != '\n')
+        -- last_line;
+
+    // Decode blocks of lines in parallel, limiting the memory consumed by the decoded lines.
+    static const size_t block_size = 16 * 1024 * 1024;
+    DecodedLines lines;
+    for (const char *ptr = begin; ptr < last_line;) {
+        const char *block_end = last_line;
+        if (size_t(last_line - ptr) > block_size)
+            block_end = (const char*)memchr(ptr + block_size - 1, '\n', last_line - ptr - block_size + 1) + 1;
+        this->decode_buffer(ptr, block_end, lines);
+        this->parse_decoded(lines, callback);
+        ptr = block_end;
+    }
+    if (last_line < end)
+        this->parse_line(std::string(last_line, end), callback);
 }
 
 bool GCodeReader::GCodeLine::has(char axis) const
@@ -152,8 +297,8 @@ bool GCodeReader::GCodeLine::has_value(char axis, float &value) const
         // Check the name of the axis.
         if (*c == axis) {
             // Try to parse the numeric value.
-            char   *pend = nullptr;
-            double  v = strtod(++ c, &pend);
+            const char *pend = nullptr;
+            double      v    = parse_float(++ c, &pend);
             if (pend != nullptr && is_end_of_word(*pend)) {
                 // The axis value has been parsed correctly.
                 value = float(v);
@@ -6,6 +6,7 @@
 #include <cstdlib>
 #include <functional>
 #include <string>
+#include <vector>
 #include "PrintConfig.hpp"
 
 namespace Slic3r {
@@ -69,6 +70,22 @@ public:
         friend class GCodeReader;
     };
 
+    // Line decoded by decode_buffer(). Contrary to GCodeLine, it does not own a copy of the line text,
+    // it points into the decoded buffer, which has to outlive it.
+    struct DecodedLine {
+        // Line including the comment, without the trailing newlines.
+        const char      *begin;
+        const char      *end;
+        // Command, for example "G1".
+        const char      *cmd_begin;
+        const char      *cmd_end;
+        float            axis[NUM_AXES];
+        uint32_t         mask;
+
+        bool  has(Axis axis) const { return (mask & (1 << int(axis))) != 0; }
+    };
+    typedef std::vector<DecodedLine> DecodedLines;
+
     typedef std::function<void(GCodeReader&, const GCodeLine&)> callback_t;
     
     GCodeReader() : m_verbose(false), m_extrusion_axis('E') { memset(m_position, 0, sizeof(m_position)); }
@@ -103,6 +120,26 @@ public:
     void parse_line(const std::string &line, Callback callback)
         { GCodeLine gline; this->parse_line(line.c_str(), gline, callback); }
 
+    // Decodes the lines of [begin, end) in parallel into a flat array, without copying the line texts
+    // and without touching the state of the reader. The last line has to be terminated by a newline
+    // unless the buffer is zero terminated.
+    void decode_buffer(const char *begin, const char *end, DecodedLines &lines) const;
+
+    // Feeds the lines produced by decode_buffer() to the callback, updating the state of the reader
+    // the same way parse_buffer() does.
+    template<typename Callback>
+    void parse_decoded(const DecodedLines &lines, Callback callback)
+    {
+        GCodeLine gline;
+        for (const DecodedLine &line : lines) {
+            this->apply_decoded(line, gline);
+            callback(*this, gline);
+            std::pair<const char*, const char*> cmd(line.cmd_begin, line.cmd_end);
+            update_coordinates(gline, cmd);
+        }
+    }
+
+    // Maps the file into memory and parses it in blocks of lines decoded in parallel.
     void parse_file(const std::string &file, callback_t callback);
 
     float& x()       { return m_position[X]; }
@@ -120,6 +157,9 @@ public:
 
 private:
     const char* parse_line_internal(const char *ptr, GCodeLine &gline, std::pair<const char*, const char*> &command);
+    // Decodes a single line terminated by a newline or by a zero, returns the start of the next line.
+    const char* decode_line(const char *ptr, DecodedLine &line) const;
+    void        apply_decoded(const DecodedLine &line, GCodeLine &gline);
     void        update_coordinates(GCodeLine &gline, std::pair<const char*, const char*> &command);
 
     static bool         is_whitespace(char c)           { return c == ' ' || c == '\t'; }
@@ -136,6 +176,7 @@ private:
             ; // silence -Wempty-body
         return c;
     }
+    static double       parse_float(const char *c, const char **pend);
 
     GCodeConfig m_config;
     char        m_extrusion_axis;
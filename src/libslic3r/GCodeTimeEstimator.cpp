@@ -9,6 +9,8 @@
 #include <boost/nowide/cstdio.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 
+#include <tbb/parallel_for.h>
+
 static const float MMMIN_TO_MMSEC = 1.0f / 60.0f;
 static const float MILLISEC_TO_SEC = 0.001f;
 static const float INCHES_TO_MM = 25.4f;
@@ -25,6 +27,11 @@ static const float DEFAULT_EXTRUDE_FACTOR_OVERRIDE_PERCENTAGE = 1.0f; // 100 per
 
 static const float PREVIOUS_FEEDRATE_THRESHOLD = 0.0001f;
 
+// Minimum number of blocks planned by a single thread.
+static const size_t PLANNER_CHUNK_SIZE = 4096;
+// Number of blocks, which are kept unplanned before being planned and stored in the compact form.
+static const size_t PLANNER_WINDOW_SIZE = 65536;
+
 #if ENABLE_MOVE_STATS
 static const std::string MOVE_TYPE_STR[Slic3r::GCodeTimeEstimator::Block::Num_Types] =
 {
@@ -257,6 +264,11 @@ namespace Slic3r {
     }
 
     bool GCodeTimeEstimator::post_process_remaining_times(const std::string& filename, float interval)
+    {
+        return post_process_remaining_times(filename, interval, std::vector<GCodeTimeEstimator*>(1, this));
+    }
+
+    bool GCodeTimeEstimator::post_process_remaining_times(const std::string& filename, float interval, const std::vector<GCodeTimeEstimator*>& estimators)
     {
         boost::nowide::ifstream in(filename);
         if (!in.good())
@@ -268,24 +280,45 @@ namespace Slic3r {
         if (out == nullptr)
             throw std::runtime_error(std::string("Remaining times export failed.\nCannot open file for writing.\n"));
 
-        std::string time_mask;
-        switch (_mode)
-        {
-        default:
-        case Normal:
+        // Output state of a single estimator.
+        struct EstimatorOutput
         {
-            time_mask = "M73 P%s R%s\n";
-            break;
-        }
-        case Silent:
+            GCodeTimeEstimator *estimator;
+            const char         *time_mask;
+            const std::string  *placeholder_tag;
+            float               last_recorded_time;
+            // Index of the first block, whose G1 line has not been reached yet.
+            size_t              next_block_id;
+        };
+        std::vector<EstimatorOutput> outputs;
+        for (GCodeTimeEstimator *estimator : estimators)
         {
-            time_mask = "M73 Q%s S%s\n";
-            break;
-        }
+            EstimatorOutput output;
+            output.estimator = estimator;
+            output.last_recorded_time = 0.0f;
+            output.next_block_id = 0;
+            switch (estimator->_mode)
+            {
+            default:
+            case Normal:
+            {
+                output.time_mask = "M73 P%s R%s\n";
+                output.placeholder_tag = &Normal_First_M73_Output_Placeholder_Tag;
+                break;
+            }
+            case Silent:
+            {
+                output.time_mask = "M73 Q%s S%s\n";
+                output.placeholder_tag = &Silent_First_M73_Output_Placeholder_Tag;
+                break;
+            }
+            }
+            outputs.emplace_back(output);
         }
 
+        // The G-code is parsed just once for all the estimators.
+        GCodeReader parser;
         unsigned int g1_lines_count = 0;
-        float last_recorded_time = 0.0f;
         std::string gcode_line;
         // buffer line to export only when greater than 64K to reduce writing calls
         std::string export_line;
@@ -299,18 +332,23 @@ namespace Slic3r {
             }
 
             // replaces placeholders for initial line M73 with the real lines
-            if (((_mode == Normal) && (gcode_line == Normal_First_M73_Output_Placeholder_Tag)) ||
-                ((_mode == Silent) && (gcode_line == Silent_First_M73_Output_Placeholder_Tag)))
-            {
-                sprintf(time_line, time_mask.c_str(), "0", _get_time_minutes(_time).c_str());
-                gcode_line = time_line;
-            }
-            else
-               gcode_line += "\n";
+            bool placeholder = false;
+            for (const EstimatorOutput &output : outputs)
+                if (gcode_line == *output.placeholder_tag)
+                {
+                    sprintf(time_line, output.time_mask, "0", _get_time_minutes(output.estimator->_time).c_str());
+                    gcode_line = time_line;
+                    placeholder = true;
+                    break;
+                }
+            if (!placeholder)
+                gcode_line += "\n";
 
             // add remaining time lines where needed
-            _parser.parse_line(gcode_line,
-                [this, &g1_lines_count, &last_recorded_time, &time_line, &gcode_line, time_mask, interval](GCodeReader& reader, const GCodeReader::GCodeLine& line)
+            // The lines are collected separately, as the parser keeps pointing into gcode_line until the callback returns.
+            std::string time_lines;
+            parser.parse_line(gcode_line,
+                [&outputs, &g1_lines_count, &time_line, &time_lines, interval](GCodeReader& reader, const GCodeReader::GCodeLine& line)
             {
                 if (line.cmd_is("G1"))
                 {
@@ -319,19 +357,27 @@ namespace Slic3r {
                     if (!line.has_e())
                         return;
 
-                    G1LineIdToBlockIdMap::const_iterator it = _g1_line_ids.find(g1_lines_count);
-                    if ((it != _g1_line_ids.end()) && (it->second < (unsigned int)_blocks.size()))
+                    for (EstimatorOutput &output : outputs)
                     {
-                        const Block& block = _blocks[it->second];
-                        if (block.elapsed_time != -1.0f)
+                        const GCodeTimeEstimator &estimator = *output.estimator;
+                        // The G1 lines are visited in an increasing order, so are the blocks.
+                        size_t &block_id = output.next_block_id;
+                        while (block_id < estimator._g1_line_ids.size() && estimator._g1_line_ids[block_id] < g1_lines_count)
+                            ++ block_id;
+                        if (block_id < estimator._g1_line_ids.size() && estimator._g1_line_ids[block_id] == g1_lines_count &&
+                            block_id < estimator._block_times.size())
                         {
-                            float block_remaining_time = _time - block.elapsed_time;
-                            if (std::abs(last_recorded_time - block_remaining_time) > interval)
+                            const BlockTimes& block = estimator._block_times[block_id];
+                            if (block.elapsed_time != -1.0f)
                             {
-                                sprintf(time_line, time_mask.c_str(), std::to_string((int)(100.0f * block.elapsed_time / _time)).c_str(), _get_time_minutes(block_remaining_time).c_str());
-                                gcode_line += time_line;
-
-                                last_recorded_time = block_remaining_time;
+                                float block_remaining_time = estimator._time - block.elapsed_time;
+                                if (std::abs(output.last_recorded_time - block_remaining_time) > interval)
+                                {
+                                    sprintf(time_line, output.time_mask, std::to_string((int)(100.0f * block.elapsed_time / estimator._time)).c_str(), _get_time_minutes(block_remaining_time).c_str());
+                                    time_lines += time_line;
+
+                                    output.last_recorded_time = block_remaining_time;
+                                }
                             }
                         }
                     }
@@ -339,6 +385,7 @@ namespace Slic3r {
             });
 
             export_line += gcode_line;
+            export_line += time_lines;
             if (export_line.length() > 65535)
             {
                 fwrite((const void*)export_line.c_str(), 1, export_line.length(), out);
@@ -693,27 +740,28 @@ namespace Slic3r {
     void GCodeTimeEstimator::_reset_blocks()
     {
         _blocks.clear();
+        _block_times.clear();
+        _blocks_planner_break = 0;
     }
 
 
     void GCodeTimeEstimator::_calculate_time()
     {
         PROFILE_FUNC();
-        _forward_pass();
-        _reverse_pass();
-        _recalculate_trapezoids();
+        _plan_blocks(_blocks.size(), true);
+        _blocks_planner_break = 0;
 
         _time += get_additional_time();
 
-        for (int i = _last_st_synchronized_block_id + 1; i < (int)_blocks.size(); ++i)
+        for (int i = _last_st_synchronized_block_id + 1; i < (int)_block_times.size(); ++i)
         {
-            Block& block = _blocks[i];
+            BlockTimes& block = _block_times[i];
 
 #if ENABLE_MOVE_STATS
             float block_time = 0.0f;
-            block_time += block.acceleration_time();
-            block_time += block.cruise_time();
-            block_time += block.deceleration_time();
+            block_time += block.acceleration_time;
+            block_time += block.cruise_time;
+            block_time += block.deceleration_time;
             _time += block_time;
             block.elapsed_time = _time;
 
@@ -724,14 +772,14 @@ namespace Slic3r {
             it->second.count += 1;
             it->second.time += block_time;
 #else
-            _time += block.acceleration_time();
-            _time += block.cruise_time();
-            _time += block.deceleration_time();
+            _time += block.acceleration_time;
+            _time += block.cruise_time;
+            _time += block.deceleration_time;
             block.elapsed_time = _time;
 #endif // ENABLE_MOVE_STATS
         }
 
-        _last_st_synchronized_block_id = (int)_blocks.size() - 1;
+        _last_st_synchronized_block_id = (int)_block_times.size() - 1;
         // The additional time has been consumed (added to the total time), reset it to zero.
         set_additional_time(0.);
     }
@@ -968,7 +1016,7 @@ namespace Slic3r {
 
         // calculates block entry feedrate
         float vmax_junction = _curr.safe_feedrate;
-        if (!_blocks.empty() && (_prev.feedrate > PREVIOUS_FEEDRATE_THRESHOLD))
+        if ((!_blocks.empty() || !_block_times.empty()) && (_prev.feedrate > PREVIOUS_FEEDRATE_THRESHOLD))
         {
             bool prev_speed_larger = _prev.feedrate > block.feedrate.cruise;
             float smaller_speed_factor = prev_speed_larger ? (block.feedrate.cruise / _prev.feedrate) : (_prev.feedrate / block.feedrate.cruise);
@@ -1072,7 +1120,17 @@ namespace Slic3r {
 
         // adds block to blocks list
         _blocks.emplace_back(block);
-        _g1_line_ids.insert(G1LineIdToBlockIdMap::value_type(get_g1_line_id(), (unsigned int)_blocks.size() - 1));
+        _g1_line_ids.emplace_back(get_g1_line_id());
+
+        if (_blocks.size() > 1 && _blocks[_blocks.size() - 2].flags.nominal_length)
+            _blocks_planner_break = _blocks.size() - 1;
+        if (_blocks_planner_break >= PLANNER_WINDOW_SIZE)
+        {
+            // Plan the blocks preceding the block of nominal length. The block of nominal length is kept,
+            // as its trapezoid depends on the blocks following it.
+            _plan_blocks(_blocks_planner_break - 1, false);
+            _blocks_planner_break = 0;
+        }
     }
 
     void GCodeTimeEstimator::_processG4(const GCodeReader::GCodeLine& line)
@@ -1352,27 +1410,60 @@ namespace Slic3r {
         _calculate_time();
     }
 
-    void GCodeTimeEstimator::_forward_pass()
+    void GCodeTimeEstimator::_plan_blocks(size_t num_blocks, bool last_block_exit)
     {
         PROFILE_FUNC();
-        if (_blocks.size() > 1)
+        if (num_blocks == 0)
+            return;
+
+        // If the last block does not exit at its safe feedrate, the passes shall run over the following block as well,
+        // as its entry feedrate is needed to calculate the trapezoid of the last block.
+        size_t num_planned = last_block_exit ? num_blocks : num_blocks + 1;
+
+        // Split the blocks into chunks after the blocks of nominal length. The forward pass does not change the entry feedrate
+        // of a block following a block of nominal length, and the reverse pass sets a block of nominal length to its maximum entry
+        // feedrate independently of the following block. Therefore planning the chunks independently gives the same result
+        // as planning all the blocks at once.
+        std::vector<size_t> chunks(1, 0);
+        for (size_t i = PLANNER_CHUNK_SIZE; i < num_planned; ++i)
         {
-            for (int i = _last_st_synchronized_block_id + 1; i < (int)_blocks.size() - 1; ++i)
+            if (_blocks[i - 1].flags.nominal_length && (i >= chunks.back() + PLANNER_CHUNK_SIZE))
+                chunks.emplace_back(i);
+        }
+        chunks.emplace_back(num_planned);
+
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, chunks.size() - 1, 1),
+            [this, &chunks](const tbb::blocked_range<size_t>& range) {
+            for (size_t i = range.begin(); i < range.end(); ++i)
             {
-                _planner_forward_pass_kernel(_blocks[i], _blocks[i + 1]);
+                _forward_pass(chunks[i], chunks[i + 1]);
+                _reverse_pass(chunks[i], chunks[i + 1]);
             }
+        });
+
+        size_t times_begin = _block_times.size();
+        _block_times.resize(times_begin + num_blocks);
+        _recalculate_trapezoids(0, num_blocks, last_block_exit, times_begin);
+        _blocks.erase(_blocks.begin(), _blocks.begin() + num_blocks);
+    }
+
+    void GCodeTimeEstimator::_forward_pass(size_t begin, size_t end)
+    {
+        PROFILE_FUNC();
+        for (size_t i = begin; i + 1 < end; ++i)
+        {
+            _planner_forward_pass_kernel(_blocks[i], _blocks[i + 1]);
         }
     }
 
-    void GCodeTimeEstimator::_reverse_pass()
+    void GCodeTimeEstimator::_reverse_pass(size_t begin, size_t end)
     {
         PROFILE_FUNC();
-        if (_blocks.size() > 1)
+        // The last block of a chunk is followed by the first block of the next chunk. The last block is of nominal length,
+        // therefore the kernel does not access the following block, which is being planned by another thread.
+        for (size_t i = std::min(end, _blocks.size() - 1); i > begin; --i)
         {
-            for (int i = (int)_blocks.size() - 1; i >= _last_st_synchronized_block_id + 2; --i)
-            {
-                _planner_reverse_pass_kernel(_blocks[i - 1], _blocks[i]);
-            }
+            _planner_reverse_pass_kernel(_blocks[i - 1], _blocks[i]);
         }
     }
 
@@ -1417,43 +1508,29 @@ namespace Slic3r {
         }
     }
 
-    void GCodeTimeEstimator::_recalculate_trapezoids()
+    void GCodeTimeEstimator::_recalculate_trapezoids(size_t begin, size_t end, bool last_block_exit, size_t times_begin)
     {
         PROFILE_FUNC();
-        Block* curr = nullptr;
-        Block* next = nullptr;
-
-        for (int i = _last_st_synchronized_block_id + 1; i < (int)_blocks.size(); ++i)
-        {
-            Block& b = _blocks[i];
-
-            curr = next;
-            next = &b;
-
-            if (curr != nullptr)
+        tbb::parallel_for(tbb::blocked_range<size_t>(begin, end, PLANNER_CHUNK_SIZE),
+            [this, begin, end, last_block_exit, times_begin](const tbb::blocked_range<size_t>& range) {
+            for (size_t i = range.begin(); i < range.end(); ++i)
             {
-                // Recalculate if current block entry or exit junction speed has changed.
-                if (curr->flags.recalculate || next->flags.recalculate)
-                {
-                    // NOTE: Entry and exit factors always > 0 by all previous logic operations.
-                    Block block = *curr;
-                    block.feedrate.exit = next->feedrate.entry;
-                    block.calculate_trapezoid();
-                    curr->trapezoid = block.trapezoid;
-                    curr->flags.recalculate = false; // Reset current only to ensure next trapezoid is computed
-                }
-            }
-        }
+                // NOTE: Entry and exit factors always > 0 by all previous logic operations.
+                Block block = _blocks[i];
+                // Last/newest block before st_synchronize() exits at its safe feedrate.
+                block.feedrate.exit = (last_block_exit && i + 1 == end) ? block.safe_feedrate : _blocks[i + 1].feedrate.entry;
+                block.calculate_trapezoid();
 
-        // Last/newest block in buffer. Always recalculated.
-        if (next != nullptr)
-        {
-            Block block = *next;
-            block.feedrate.exit = next->safe_feedrate;
-            block.calculate_trapezoid();
-            next->trapezoid = block.trapezoid;
-            next->flags.recalculate = false;
-        }
+                BlockTimes& times = _block_times[times_begin + i - begin];
+#if ENABLE_MOVE_STATS
+                times.move_type = block.move_type;
+#endif // ENABLE_MOVE_STATS
+                times.acceleration_time = block.acceleration_time();
+                times.cruise_time = block.cruise_time();
+                times.deceleration_time = block.deceleration_time();
+                times.elapsed_time = -1.0f;
+            }
+        });
     }
 
     std::string GCodeTimeEstimator::_get_time_dhms(float time_in_secs)
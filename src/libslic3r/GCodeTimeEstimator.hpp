@@ -153,7 +153,6 @@ namespace Slic3r {
 
             FeedrateProfile feedrate;
             Trapezoid trapezoid;
-            float elapsed_time;
 
             Block();
 
@@ -197,6 +196,20 @@ namespace Slic3r {
 
         typedef std::vector<Block> BlocksList;
 
+        // Compact representation of a block, which has already been planned.
+        struct BlockTimes
+        {
+#if ENABLE_MOVE_STATS
+            Block::EMoveType move_type;
+#endif // ENABLE_MOVE_STATS
+            float acceleration_time; // s
+            float cruise_time;       // s
+            float deceleration_time; // s
+            float elapsed_time;      // s, -1 until the next st_synchronize()
+        };
+
+        typedef std::vector<BlockTimes> BlockTimesList;
+
 #if ENABLE_MOVE_STATS
         struct MoveStats
         {
@@ -209,18 +222,22 @@ namespace Slic3r {
         typedef std::map<Block::EMoveType, MoveStats> MovesStatsMap;
 #endif // ENABLE_MOVE_STATS
 
-        typedef std::map<unsigned int, unsigned int> G1LineIdToBlockIdMap;
-
     private:
         EMode _mode;
         GCodeReader _parser;
         State _state;
         Feedrates _curr;
         Feedrates _prev;
+        // Blocks not planned yet. Only the times of the planned blocks are kept in _block_times,
+        // so that the memory stays bounded for G-codes with millions of moves.
         BlocksList _blocks;
-        // Map between g1 line id and blocks id, used to speed up export of remaining times
-        G1LineIdToBlockIdMap _g1_line_ids;
-        // Index of the last block already st_synchronized
+        BlockTimesList _block_times;
+        // Index into _blocks of the last block following a block of nominal length, 0 if there is none.
+        // The blocks before it may be planned without waiting for the blocks following it.
+        size_t _blocks_planner_break;
+        // G1 line id of each block in _block_times followed by _blocks, used to speed up export of remaining times
+        std::vector<unsigned int> _g1_line_ids;
+        // Index into _block_times of the last block already st_synchronized
         int _last_st_synchronized_block_id;
         float _time; // s
 
@@ -233,6 +250,9 @@ namespace Slic3r {
 
         // Adds the given gcode line
         void add_gcode_line(const std::string& gcode_line);
+        // Adds the given gcode line, already parsed by the caller.
+        // This allows to share a single parsing pass among multiple estimators (normal and silent mode) and the GCodeAnalyzer.
+        void add_gcode_line(const GCodeReader::GCodeLine& line) { this->_process_gcode_line(_parser, line); }
 
         void add_gcode_block(const char *ptr);
         void add_gcode_block(const std::string &str) { this->add_gcode_block(str.c_str()); }
@@ -259,6 +279,10 @@ namespace Slic3r {
         // contained in the given file before to call this method
         bool post_process_remaining_times(const std::string& filename, float interval_sec);
 
+        // Same as above, but placing the M73 lines of multiple estimators (normal and silent mode) in a single pass
+        // over the file. The M73 lines are emitted in the order of the estimators.
+        static bool post_process_remaining_times(const std::string& filename, float interval_sec, const std::vector<GCodeTimeEstimator*>& estimators);
+
         // Set current position on the given axis with the given value
         void set_axis_position(EAxis axis, float position);
 
@@ -412,13 +436,20 @@ namespace Slic3r {
         // Simulates firmware st_synchronize() call
         void _simulate_st_synchronize();
 
-        void _forward_pass();
-        void _reverse_pass();
+        // Plans the first num_blocks of _blocks and moves their times to _block_times.
+        // If last_block_exit is set, the last of them exits at its safe feedrate (st_synchronize()),
+        // otherwise it is followed by a block of nominal length, which stays in _blocks.
+        void _plan_blocks(size_t num_blocks, bool last_block_exit);
+
+        // Runs the forward and reverse planner passes over _blocks[begin, end).
+        void _forward_pass(size_t begin, size_t end);
+        void _reverse_pass(size_t begin, size_t end);
 
         void _planner_forward_pass_kernel(Block& prev, Block& curr);
         void _planner_reverse_pass_kernel(Block& curr, Block& next);
 
-        void _recalculate_trapezoids();
+        // Calculates the trapezoids of _blocks[begin, end) and stores their times into _block_times starting at times_begin.
+        void _recalculate_trapezoids(size_t begin, size_t end, bool last_block_exit, size_t times_begin);
 
         // Returns the given time is seconds in format DDd HHh MMm SSs
         static std::string _get_time_dhms(float time_in_secs);
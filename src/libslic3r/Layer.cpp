@@ -74,7 +74,9 @@ void Layer::merge_slices()
     } else {
         for (LayerRegion *layerm : m_regions)
             // without safety offset, artifacts are generated (GH #2494)
-            layerm->slices.set(union_ex(to_polygons(std::move(layerm->slices.surfaces)), true), stInternal);
+            // The union grows the slices by the safety offset. Shrink them back the same way, otherwise the slices
+            // would grow each time the perimeters are regenerated from the typed slices.
+            layerm->slices.set(offset_ex(union_ex(to_polygons(std::move(layerm->slices.surfaces)), true), - CLIPPER_SAFETY_OFFSET, ClipperLib::jtMiter, 2.), stInternal);
     }
 }
 
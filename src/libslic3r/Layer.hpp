@@ -57,6 +57,9 @@ public:
     // ordered collection of extrusion paths to fill surfaces
     // (this collection contains only ExtrusionEntityCollection objects)
     ExtrusionEntityCollection   fills;
+    // Hash of the fill_surfaces the fills were generated from. PrintObject::infill() regenerates the fills
+    // of a layer outside of an invalidated layer range only if its fill_surfaces changed.
+    size_t                      fill_surfaces_hash = 0;
     
     Flow    flow(FlowRole role, bool bridge = false, double width = -1) const;
     void    slices_to_fill_surfaces_clipped();
@@ -19,9 +19,8 @@
 
 namespace Slic3r {
 
-unsigned int Model::s_auto_extruder_id = 1;
 
-size_t ModelBase::s_last_id = 0;
+std::atomic<size_t> ModelBase::s_last_id(0);
 
 Model& Model::assign_copy(const Model &rhs)
 {
@@ -458,7 +457,7 @@ bool Model::looks_like_multipart_object() const
         if (obj->volumes.size() > 1 || obj->config.keys().size() > 1)
             return false;
         for (const ModelVolume *vol : obj->volumes) {
-            double zmin_this = vol->mesh.bounding_box().min(2);
+            double zmin_this = vol->mesh().bounding_box().min(2);
             if (zmin == std::numeric_limits<double>::max())
                 zmin = zmin_this;
             else if (std::abs(zmin - zmin_this) > EPSILON)
@@ -479,7 +478,7 @@ void Model::convert_multipart_object(unsigned int max_extruders)
     object->name = this->objects.front()->name;
     //FIXME copy the config etc?
 
-    reset_auto_extruder_id();
+    unsigned int extruder_counter = 1;
 
     for (const ModelObject* o : this->objects)
         for (const ModelVolume* v : o->volumes)
@@ -488,7 +487,7 @@ void Model::convert_multipart_object(unsigned int max_extruders)
             if (new_v != nullptr)
             {
                 new_v->name = o->name;
-                new_v->config.set_deserialize("extruder", get_auto_extruder_id_as_string(max_extruders));
+                new_v->config.set_deserialize("extruder", get_auto_extruder_id_as_string(max_extruders, extruder_counter));
             }
         }
 
@@ -518,32 +517,27 @@ void Model::adjust_min_z()
     }
 }
 
-unsigned int Model::get_auto_extruder_id(unsigned int max_extruders)
+unsigned int Model::get_auto_extruder_id(unsigned int max_extruders, unsigned int &counter)
 {
-    unsigned int id = s_auto_extruder_id;
+    unsigned int id = counter;
     if (id > max_extruders) {
         // The current counter is invalid, likely due to switching the printer profiles
         // to a profile with a lower number of extruders.
-        reset_auto_extruder_id();
-        id = s_auto_extruder_id;
-    } else if (++ s_auto_extruder_id > max_extruders) {
-        reset_auto_extruder_id();
+        counter = 1;
+        id = counter;
+    } else if (++ counter > max_extruders) {
+        counter = 1;
     }
     return id;
 }
 
-std::string Model::get_auto_extruder_id_as_string(unsigned int max_extruders)
+std::string Model::get_auto_extruder_id_as_string(unsigned int max_extruders, unsigned int &counter)
 {
     char str_extruder[64];
-    sprintf(str_extruder, "%ud", get_auto_extruder_id(max_extruders));
+    sprintf(str_extruder, "%ud", get_auto_extruder_id(max_extruders, counter));
     return str_extruder;
 }
 
-void Model::reset_auto_extruder_id()
-{
-    s_auto_extruder_id = 1;
-}
-
 std::string Model::propose_export_file_name() const
 {
     for (const ModelObject *model_object : this->objects)
@@ -758,14 +752,10 @@ const BoundingBoxf3& ModelObject::bounding_box() const
         for (const ModelVolume *v : this->volumes)
             if (v->is_model_part())
 #if ENABLE_MODELVOLUME_TRANSFORM
-            {
-                TriangleMesh m = v->mesh;
-                m.transform(v->get_matrix());
-                raw_bbox.merge(m.bounding_box());
-            }
+                raw_bbox.merge(v->mesh().transformed_bounding_box(v->get_matrix()));
 #else
                 // mesh.bounding_box() returns a cached value.
-                raw_bbox.merge(v->mesh.bounding_box());
+                raw_bbox.merge(v->mesh().bounding_box());
 #endif // ENABLE_MODELVOLUME_TRANSFORM
         BoundingBoxf3 bb;
         for (const ModelInstance *i : this->instances)
@@ -799,12 +789,12 @@ TriangleMesh ModelObject::raw_mesh() const
         if (v->is_model_part())
 #if ENABLE_MODELVOLUME_TRANSFORM
         {
-            TriangleMesh vol_mesh(v->mesh);
+            TriangleMesh vol_mesh(v->mesh());
             vol_mesh.transform(v->get_matrix());
             mesh.merge(vol_mesh);
         }
 #else
-        mesh.merge(v->mesh);
+        mesh.merge(v->mesh());
 #endif // ENABLE_MODELVOLUME_TRANSFORM
     return mesh;
 }
@@ -820,11 +810,11 @@ BoundingBoxf3 ModelObject::raw_bounding_box() const
                 throw std::invalid_argument("Can't call raw_bounding_box() with no instances");
 
 #if ENABLE_MODELVOLUME_TRANSFORM
-            TriangleMesh vol_mesh(v->mesh);
+            TriangleMesh vol_mesh(v->mesh());
             vol_mesh.transform(v->get_matrix());
             bb.merge(this->instances.front()->transform_mesh_bounding_box(vol_mesh, true));
 #else
-            bb.merge(this->instances.front()->transform_mesh_bounding_box(v->mesh, true));
+            bb.merge(this->instances.front()->transform_mesh_bounding_box(v->mesh(), true));
 #endif // ENABLE_MODELVOLUME_TRANSFORM
         }
     return bb;
@@ -839,7 +829,7 @@ BoundingBoxf3 ModelObject::instance_bounding_box(size_t instance_idx, bool dont_
     {
         if (v->is_model_part())
         {
-            TriangleMesh mesh(v->mesh);
+            TriangleMesh mesh(v->mesh());
             mesh.transform(v->get_matrix());
             bb.merge(this->instances[instance_idx]->transform_mesh_bounding_box(mesh, dont_translate));
         }
@@ -847,7 +837,7 @@ BoundingBoxf3 ModelObject::instance_bounding_box(size_t instance_idx, bool dont_
 #else
     for (ModelVolume *v : this->volumes)
         if (v->is_model_part())
-            bb.merge(this->instances[instance_idx]->transform_mesh_bounding_box(&v->mesh, dont_translate));
+            bb.merge(this->instances[instance_idx]->transform_mesh_bounding_box(v->mesh(), dont_translate));
 #endif // ENABLE_MODELVOLUME_TRANSFORM
     return bb;
 }
@@ -859,7 +849,7 @@ void ModelObject::center_around_origin()
 	BoundingBoxf3 bb;
 	for (ModelVolume *v : this->volumes)
         if (v->is_model_part())
-			bb.merge(v->mesh.bounding_box());
+			bb.merge(v->mesh().bounding_box());
     
     // Shift is the vector from the center of the bounding box to the origin
     Vec3d shift = -bb.center();
@@ -977,14 +967,14 @@ size_t ModelObject::facets_count() const
     size_t num = 0;
     for (const ModelVolume *v : this->volumes)
         if (v->is_model_part())
-            num += v->mesh.stl.stats.number_of_facets;
+            num += v->mesh().stl.stats.number_of_facets;
     return num;
 }
 
 bool ModelObject::needed_repair() const
 {
     for (const ModelVolume *v : this->volumes)
-        if (v->is_model_part() && v->mesh.needed_repair())
+        if (v->is_model_part() && v->mesh().needed_repair())
             return true;
     return false;
 }
@@ -1044,10 +1034,10 @@ ModelObjectPtrs ModelObject::cut(size_t instance, coordf_t z, bool keep_upper, b
             TriangleMesh upper_mesh, lower_mesh;
 
             // Transform the mesh by the combined transformation matrix
-            volume->mesh.transform(instance_matrix * volume_matrix);
+            volume->mesh_mutable().transform(instance_matrix * volume_matrix);
 
             // Perform cut
-            TriangleMeshSlicer tms(&volume->mesh);
+            TriangleMeshSlicer tms(&volume->mesh_mutable());
             tms.cut(z, &upper_mesh, &lower_mesh);
 
             // Reset volume transformation except for offset
@@ -1139,7 +1129,7 @@ void ModelObject::split(ModelObjectPtrs* new_objects)
     }
     
     ModelVolume* volume = this->volumes.front();
-    TriangleMeshPtrs meshptrs = volume->mesh.split();
+    TriangleMeshPtrs meshptrs = volume->mesh().split();
     for (TriangleMesh *mesh : meshptrs) {
         mesh->repair();
         
@@ -1174,7 +1164,7 @@ void ModelObject::split(ModelObjectPtrs* new_objects)
 void ModelObject::repair()
 {
     for (ModelVolume *v : this->volumes)
-        v->mesh.repair();
+        v->mesh_mutable().repair();
 }
 
 double ModelObject::get_min_z() const
@@ -1215,9 +1205,9 @@ double ModelObject::get_instance_min_z(size_t instance_idx) const
             min_z = std::min(min_z, Vec3d::UnitZ().dot(mv * facet->vertex[2].cast<double>()));
         }
 #else
-        for (uint32_t f = 0; f < v->mesh.stl.stats.number_of_facets; ++f)
+        for (uint32_t f = 0; f < v->mesh().stl.stats.number_of_facets; ++f)
         {
-            const stl_facet* facet = v->mesh.stl.facet_start + f;
+            const stl_facet* facet = v->mesh().stl.facet_start + f;
             min_z = std::min(min_z, Vec3d::UnitZ().dot(mi * facet->vertex[0].cast<double>()));
             min_z = std::min(min_z, Vec3d::UnitZ().dot(mi * facet->vertex[1].cast<double>()));
             min_z = std::min(min_z, Vec3d::UnitZ().dot(mi * facet->vertex[2].cast<double>()));
@@ -1338,21 +1328,37 @@ int ModelVolume::extruder_id() const
 #if ENABLE_MODELVOLUME_TRANSFORM
 void ModelVolume::center_geometry()
 {
-    Vec3d shift = -mesh.bounding_box().center();
-    mesh.translate((float)shift(0), (float)shift(1), (float)shift(2));
-    m_convex_hull.translate((float)shift(0), (float)shift(1), (float)shift(2));
+    Vec3d shift = -this->mesh().bounding_box().center();
+    this->mesh_mutable().translate((float)shift(0), (float)shift(1), (float)shift(2));
+    this->convex_hull_mutable().translate((float)shift(0), (float)shift(1), (float)shift(2));
     translate(-shift);
 }
 #endif // ENABLE_MODELVOLUME_TRANSFORM
 
+TriangleMesh& ModelVolume::mesh_mutable()
+{
+    // Copy on write. The mesh may be shared with a copy of this volume, for example with the one owned by the Print,
+    // which may be reading it from the background processing thread.
+    if (m_mesh.use_count() > 1)
+        m_mesh = std::make_shared<TriangleMesh>(*m_mesh);
+    return *m_mesh;
+}
+
+TriangleMesh& ModelVolume::convex_hull_mutable()
+{
+    if (m_convex_hull.use_count() > 1)
+        m_convex_hull = std::make_shared<TriangleMesh>(*m_convex_hull);
+    return *m_convex_hull;
+}
+
 void ModelVolume::calculate_convex_hull()
 {
-    m_convex_hull = mesh.convex_hull_3d();
+    m_convex_hull = std::make_shared<TriangleMesh>(this->mesh().convex_hull_3d());
 }
 
 const TriangleMesh& ModelVolume::get_convex_hull() const
 {
-    return m_convex_hull;
+    return *m_convex_hull;
 }
 
 ModelVolume::Type ModelVolume::type_from_string(const std::string &s)
@@ -1392,7 +1398,7 @@ std::string ModelVolume::type_to_string(const Type t)
 // This is useful to assign different materials to different volumes of an object.
 size_t ModelVolume::split(unsigned int max_extruders)
 {
-    TriangleMeshPtrs meshptrs = this->mesh.split();
+    TriangleMeshPtrs meshptrs = this->mesh().split();
     if (meshptrs.size() <= 1) {
         delete meshptrs.front();
         return 1;
@@ -1402,7 +1408,7 @@ size_t ModelVolume::split(unsigned int max_extruders)
     size_t ivolume = std::find(this->object->volumes.begin(), this->object->volumes.end(), this) - this->object->volumes.begin();
     std::string name = this->name;
 
-    Model::reset_auto_extruder_id();
+    unsigned int extruder_counter = 1;
 #if ENABLE_MODELVOLUME_TRANSFORM
     Vec3d offset = this->get_offset();
 #endif // ENABLE_MODELVOLUME_TRANSFORM
@@ -1411,7 +1417,7 @@ size_t ModelVolume::split(unsigned int max_extruders)
         mesh->repair();
         if (idx == 0)
         {
-            this->mesh = std::move(*mesh);
+            this->set_mesh(std::move(*mesh));
             this->calculate_convex_hull();
             // Assign a new unique ID, so that a new GLVolume will be generated.
             this->set_new_unique_id();
@@ -1425,7 +1431,7 @@ size_t ModelVolume::split(unsigned int max_extruders)
         this->object->volumes[ivolume]->translate(offset);
 #endif // ENABLE_MODELVOLUME_TRANSFORM
         this->object->volumes[ivolume]->name = name + "_" + std::to_string(idx + 1);
-        this->object->volumes[ivolume]->config.set_deserialize("extruder", Model::get_auto_extruder_id_as_string(max_extruders));
+        this->object->volumes[ivolume]->config.set_deserialize("extruder", Model::get_auto_extruder_id_as_string(max_extruders, extruder_counter));
         delete mesh;
         ++ idx;
     }
@@ -1438,8 +1444,8 @@ void ModelVolume::translate(const Vec3d& displacement)
 #if ENABLE_MODELVOLUME_TRANSFORM
     set_offset(get_offset() + displacement);
 #else
-    mesh.translate((float)displacement(0), (float)displacement(1), (float)displacement(2));
-    m_convex_hull.translate((float)displacement(0), (float)displacement(1), (float)displacement(2));
+    this->mesh_mutable().translate((float)displacement(0), (float)displacement(1), (float)displacement(2));
+    this->convex_hull_mutable().translate((float)displacement(0), (float)displacement(1), (float)displacement(2));
 #endif // ENABLE_MODELVOLUME_TRANSFORM
 }
 
@@ -1448,8 +1454,8 @@ void ModelVolume::scale(const Vec3d& scaling_factors)
 #if ENABLE_MODELVOLUME_TRANSFORM
     set_scaling_factor(get_scaling_factor().cwiseProduct(scaling_factors));
 #else
-    mesh.scale(scaling_factors);
-    m_convex_hull.scale(scaling_factors);
+    this->mesh_mutable().scale(scaling_factors);
+    this->convex_hull_mutable().scale(scaling_factors);
 #endif // ENABLE_MODELVOLUME_TRANSFORM
 }
 
@@ -1463,8 +1469,8 @@ void ModelVolume::rotate(double angle, Axis axis)
     case Z: { rotate(angle, Vec3d::UnitZ()); break; }
     }
 #else
-    mesh.rotate(angle, axis);
-    m_convex_hull.rotate(angle, axis);
+    this->mesh_mutable().rotate(angle, axis);
+    this->convex_hull_mutable().rotate(angle, axis);
 #endif // ENABLE_MODELVOLUME_TRANSFORM
 }
 
@@ -1473,8 +1479,8 @@ void ModelVolume::rotate(double angle, const Vec3d& axis)
 #if ENABLE_MODELVOLUME_TRANSFORM
     set_rotation(get_rotation() + Geometry::extract_euler_angles(Eigen::Quaterniond(Eigen::AngleAxisd(angle, axis)).toRotationMatrix()));
 #else
-    mesh.rotate(angle, axis);
-    m_convex_hull.rotate(angle, axis);
+    this->mesh_mutable().rotate(angle, axis);
+    this->convex_hull_mutable().rotate(angle, axis);
 #endif // ENABLE_MODELVOLUME_TRANSFORM
 }
 
@@ -1490,8 +1496,8 @@ void ModelVolume::mirror(Axis axis)
     }
     set_mirror(mirror);
 #else
-    mesh.mirror(axis);
-    m_convex_hull.mirror(axis);
+    this->mesh_mutable().mirror(axis);
+    this->convex_hull_mutable().mirror(axis);
 #endif // ENABLE_MODELVOLUME_TRANSFORM
 }
 
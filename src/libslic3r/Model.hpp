@@ -7,7 +7,9 @@
 #include "Point.hpp"
 #include "TriangleMesh.hpp"
 #include "Slicing.hpp"
+#include <atomic>
 #include <map>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -55,8 +57,8 @@ struct ModelID
 
 // Base for Model, ModelObject, ModelVolume, ModelInstance or ModelMaterial to provide a unique ID
 // to synchronize the front end (UI) with the back end (BackgroundSlicingProcess / Print / PrintObject).
-// Achtung! The s_last_id counter is not thread safe, so it is expected, that the ModelBase derived instances
-// are only instantiated from the main thread.
+// The s_last_id counter is atomic, so that the command line batch mode may load the models of its jobs
+// from multiple threads.
 class ModelBase
 {
 public:
@@ -83,7 +85,7 @@ private:
     ModelID                 m_id;
 
 	static inline ModelID   generate_new_id() { return ModelID(++ s_last_id); }
-    static size_t           s_last_id;
+    static std::atomic<size_t> s_last_id;
 };
 
 #define MODELBASE_DERIVED_COPY_MOVE_CLONE(TYPE) \
@@ -285,8 +287,15 @@ class ModelVolume : public ModelBase
 {
 public:
     std::string         name;
-    // The triangular model.
-    TriangleMesh        mesh;
+    // The triangular model. The mesh is shared by the copies of this volume (Print's copy of the Model,
+    // clones of the ModelObject), it is only copied when modified through mesh_mutable().
+    const TriangleMesh& mesh() const { return *m_mesh.get(); }
+    // Shared pointer to the mesh, to keep track of the mesh identity.
+    std::shared_ptr<const TriangleMesh> mesh_ptr() const { return m_mesh; }
+    // Access the mesh for modification. Makes a private copy first if the mesh is shared with another volume.
+    TriangleMesh&       mesh_mutable();
+    void                set_mesh(const TriangleMesh &mesh) { m_mesh = std::make_shared<TriangleMesh>(mesh); }
+    void                set_mesh(TriangleMesh &&mesh) { m_mesh = std::make_shared<TriangleMesh>(std::move(mesh)); }
     // Configuration parameters specific to an object model geometry or a modifier volume, 
     // overriding the global Slic3r settings and the ModelObject settings.
     DynamicPrintConfig  config;
@@ -386,56 +395,64 @@ private:
     // Is it an object to be printed, or a modifier volume?
     Type                    m_type;
     t_model_material_id     m_material_id;
-    // The convex hull of this model's mesh.
-    TriangleMesh             m_convex_hull;
+    // The triangular model, shared with the copies of this volume.
+    std::shared_ptr<TriangleMesh> m_mesh;
+    // The convex hull of this model's mesh, shared with the copies of this volume.
+    std::shared_ptr<TriangleMesh> m_convex_hull;
 #if ENABLE_MODELVOLUME_TRANSFORM
     Geometry::Transformation m_transformation;
 #endif // ENABLE_MODELVOLUME_TRANSFORM
 
-    ModelVolume(ModelObject *object, const TriangleMesh &mesh) : mesh(mesh), m_type(MODEL_PART), object(object)
+    ModelVolume(ModelObject *object, const TriangleMesh &mesh) :
+        object(object), m_type(MODEL_PART), m_mesh(std::make_shared<TriangleMesh>(mesh)), m_convex_hull(std::make_shared<TriangleMesh>())
     {
         if (mesh.stl.stats.number_of_facets > 1)
             calculate_convex_hull();
     }
     ModelVolume(ModelObject *object, TriangleMesh &&mesh, TriangleMesh &&convex_hull) :
-        mesh(std::move(mesh)), m_convex_hull(std::move(convex_hull)), m_type(MODEL_PART), object(object) {}
+        object(object), m_type(MODEL_PART), m_mesh(std::make_shared<TriangleMesh>(std::move(mesh))), m_convex_hull(std::make_shared<TriangleMesh>(std::move(convex_hull))) {}
 
 #if ENABLE_MODELVOLUME_TRANSFORM
     // Copying an existing volume, therefore this volume will get a copy of the ID assigned.
     ModelVolume(ModelObject *object, const ModelVolume &other) :
         ModelBase(other), // copy the ID
-        name(other.name), mesh(other.mesh), m_convex_hull(other.m_convex_hull), config(other.config), m_type(other.m_type), object(object), m_transformation(other.m_transformation)
+        name(other.name), config(other.config), object(object), m_type(other.m_type), m_mesh(other.m_mesh), m_convex_hull(other.m_convex_hull), m_transformation(other.m_transformation)
     {
         this->set_material_id(other.material_id());
     }
     // Providing a new mesh, therefore this volume will get a new unique ID assigned.
-    ModelVolume(ModelObject *object, const ModelVolume &other, const TriangleMesh &&mesh) :
-        name(other.name), mesh(std::move(mesh)), config(other.config), m_type(other.m_type), object(object), m_transformation(other.m_transformation)
+    ModelVolume(ModelObject *object, const ModelVolume &other, TriangleMesh &&mesh) :
+        name(other.name), config(other.config), object(object), m_type(other.m_type),
+        m_mesh(std::make_shared<TriangleMesh>(std::move(mesh))), m_convex_hull(std::make_shared<TriangleMesh>()), m_transformation(other.m_transformation)
     {
         this->set_material_id(other.material_id());
-        if (mesh.stl.stats.number_of_facets > 1)
+        if (m_mesh->stl.stats.number_of_facets > 1)
             calculate_convex_hull();
     }
 #else
     // Copying an existing volume, therefore this volume will get a copy of the ID assigned.
     ModelVolume(ModelObject *object, const ModelVolume &other) :
         ModelBase(other), // copy the ID
-        name(other.name), mesh(other.mesh), m_convex_hull(other.m_convex_hull), config(other.config), m_type(other.m_type), object(object)
+        name(other.name), config(other.config), object(object), m_type(other.m_type), m_mesh(other.m_mesh), m_convex_hull(other.m_convex_hull)
     {
 		if (! other.material_id().empty())
 			this->set_material_id(other.material_id());
     }
     // Providing a new mesh, therefore this volume will get a new unique ID assigned.
     ModelVolume(ModelObject *object, const ModelVolume &other, TriangleMesh &&mesh) :
-        name(other.name), mesh(std::move(mesh)), config(other.config), m_type(other.m_type), object(object)
+        name(other.name), config(other.config), object(object), m_type(other.m_type),
+        m_mesh(std::make_shared<TriangleMesh>(std::move(mesh))), m_convex_hull(std::make_shared<TriangleMesh>())
     {
 		if (! other.material_id().empty())
 			this->set_material_id(other.material_id());
-        if (mesh.stl.stats.number_of_facets > 1)
+        if (m_mesh->stl.stats.number_of_facets > 1)
             calculate_convex_hull();
     }
 #endif // ENABLE_MODELVOLUME_TRANSFORM
 
+    // Access the convex hull for modification, copy on write as mesh_mutable().
+    TriangleMesh& convex_hull_mutable();
+
     ModelVolume& operator=(ModelVolume &rhs) = delete;
 };
 
@@ -577,8 +594,6 @@ private:
 // all objects may share mutliple materials.
 class Model : public ModelBase
 {
-    static unsigned int s_auto_extruder_id;
-
 public:
     // Materials are owned by a model and referenced by objects through t_model_material_id.
     // Single material may be shared by multiple models.
@@ -649,9 +664,10 @@ public:
 
     void print_info() const { for (const ModelObject *o : this->objects) o->print_info(); }
 
-    static unsigned int get_auto_extruder_id(unsigned int max_extruders);
-    static std::string get_auto_extruder_id_as_string(unsigned int max_extruders);
-    static void reset_auto_extruder_id();
+    // Round robin over the extruders, the counter starts at 1 and is advanced by each call.
+    // The counter is owned by the caller, so that models may be processed by multiple threads at once.
+    static unsigned int get_auto_extruder_id(unsigned int max_extruders, unsigned int &counter);
+    static std::string get_auto_extruder_id_as_string(unsigned int max_extruders, unsigned int &counter);
 
     // Propose an output file name based on the first printable object's name.
     std::string         propose_export_file_name() const;
@@ -3,6 +3,7 @@
 #include "MutablePriorityQueue.hpp"
 #include "Utils.hpp"
 
+#include <algorithm>
 #include <limits> // for numeric_limits
 #include <assert.h>
 
@@ -50,6 +51,13 @@ void MotionPlanner::initialize()
     // from Clipper data structure into the Slic3r expolygons inside diff_ex().
     m_outer = MotionPlannerEnv(outer.front());
     m_outer.m_env = ExPolygonCollection(diff_ex(contour, offset(outer_holes, +MP_OUTER_MARGIN)));
+    {
+        // Resolution of the edge grid of about a millimeter, coarser for huge beds to limit the number of cells.
+        BoundingBox bbox = get_extents(m_outer.m_island);
+        coord_t resolution = std::max<coord_t>(coord_t(scale_(1.)), std::max(bbox.size()(0), bbox.size()(1)) / 1024);
+        m_outer.m_island_grid = make_unique<EdgeGrid::Grid>();
+        m_outer.m_island_grid->create(m_outer.m_island, resolution);
+    }
     m_graphs.resize(m_islands.size() + 1);
     m_initialized = true;
 }
@@ -121,9 +129,9 @@ Polyline MotionPlanner::shortest_path(const Point &from, const Point &to)
     polyline.points.emplace_back(to);
     
     {
-        // grow our environment slightly in order for simplify_by_visibility()
+        // our environment grown slightly in order for simplify_by_visibility()
         // to work best by considering moves on boundaries valid as well
-        ExPolygonCollection grown_env(offset_ex(env.m_env.expolygons, float(+SCALED_EPSILON)));
+        const ExPolygonCollection &grown_env = env.m_env_grown;
         
         if (island_idx == -1) {
             /*  If 'from' or 'to' are not inside our env, they were connected using the 
@@ -195,7 +203,8 @@ const MotionPlannerGraph& MotionPlanner::init_graph(int island_idx)
         // Mapping between Voronoi vertices and graph nodes.
         std::map<const VD::vertex_type*, size_t> vd_vertices;
         // get boundaries as lines
-        const MotionPlannerEnv &env = this->get_env(island_idx);
+        MotionPlannerEnv &env = this->get_env(island_idx);
+        env.m_env_grown = ExPolygonCollection(offset_ex(env.m_env.expolygons, float(+SCALED_EPSILON)));
         Lines lines = env.m_env.lines();
         boost::polygon::construct_voronoi(lines.begin(), lines.end(), &vd);
         // traverse the Voronoi diagram and generate graph nodes and edges
@@ -232,21 +241,33 @@ const MotionPlannerGraph& MotionPlanner::init_graph(int island_idx)
     return *graph;
 }
 
-// Find a middle point on the path from start_point to end_point with the shortest path.
-static inline size_t nearest_waypoint_index(const Point &start_point, const Points &middle_points, const Point &end_point)
+// Number of crossings of the line segment with the contours stored in the edge grid.
+// An end point of a contour edge lying on the line segment counts as lying on the left of the segment,
+// so that passing through a contour vertex counts as a single crossing and touching a contour vertex as none or two.
+static size_t num_crossings(const EdgeGrid::Grid &grid, const Line &line)
 {
-    size_t idx = size_t(-1);
-    double dmin = std::numeric_limits<double>::infinity();
-    for (const Point &p : middle_points) {
-        double d = (p - start_point).cast<double>().norm() + (end_point - p).cast<double>().norm();
-        if (d < dmin) {
-            idx  = &p - middle_points.data();
-            dmin = d;
-            if (dmin < EPSILON)
-                break;
-        }
+    std::vector<std::pair<size_t, size_t>> edges;
+    auto visitor = [&grid, &edges](int row, int col) {
+        auto range = grid.cell_data_range(row, col);
+        edges.insert(edges.end(), range.first, range.second);
+        return true;
+    };
+    grid.visit_cells_intersecting_line(line.a, line.b, visitor);
+    // An edge is referenced by all the cells it passes through.
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    auto left_of = [](const Point &a, const Point &b, const Point &pt) {
+        return (double(b(0)) - double(a(0))) * (double(pt(1)) - double(a(1))) - (double(b(1)) - double(a(1))) * (double(pt(0)) - double(a(0))) >= 0.;
+    };
+    size_t crossings = 0;
+    for (const std::pair<size_t, size_t> &edge_id : edges) {
+        Line edge = grid.line(edge_id);
+        if (left_of(line.a, line.b, edge.a) != left_of(line.a, line.b, edge.b) &&
+            left_of(edge.a, edge.b, line.a) != left_of(edge.a, edge.b, line.b))
+            ++ crossings;
     }
-    return idx;
+    return crossings;
 }
 
 Point MotionPlannerEnv::nearest_env_point(const Point &from, const Point &to) const
@@ -273,22 +294,29 @@ Point MotionPlannerEnv::nearest_env_point(const Point &from, const Point &to) co
         for (const ExPolygon &ex : m_env.expolygons)
             append(pp, ex.contour.points);
     
+    // Order the candidates by the length of the path from 'from' to 'to' through the candidate.
+    std::vector<std::pair<double, size_t>> candidates;
+    candidates.reserve(pp.size());
+    for (const Point &p : pp)
+        candidates.emplace_back((p - from).cast<double>().norm() + (to - p).cast<double>().norm(), &p - pp.data());
+    std::sort(candidates.begin(), candidates.end());
+
     // Find the candidate result and check that it doesn't cross too many boundaries.
-    while (pp.size() > 1) {
-        // find the point in pp that is closest to both 'from' and 'to'
-        size_t result = nearest_waypoint_index(from, pp, to);
+    for (size_t i = 0; i + 1 < candidates.size(); ++ i) {
+        const Point &p = pp[candidates[i].second];
         // as we assume 'from' is outside env, any node will require at least one crossing
-        if (intersection_ln(Line(from, pp[result]), m_island).size() > 1) {
-            // discard result
-            pp.erase(pp.begin() + result);
-        } else
-            return pp[result];
+        size_t num_segments = m_island_grid ?
+            // The line segment enters m_island at every other crossing.
+            (num_crossings(*m_island_grid, Line(from, p)) + 1) / 2 :
+            intersection_ln(Line(from, p), m_island).size();
+        if (num_segments <= 1)
+            return p;
     }
     
     // if we're here, return last point if any (better than nothing)
     // if we have no points at all, then we have an empty environment and we
     // make this method behave as a no-op (we shouldn't get here by the way)
-    return pp.empty() ? from : pp.front();
+    return pp.empty() ? from : pp[candidates.back().second];
 }
 
 // Add a new directed edge to the adjacency graph.
@@ -304,7 +332,10 @@ void MotionPlannerGraph::add_edge(size_t from, size_t to, double weight)
     m_adjacency_list[from].emplace_back(Neighbor(node_t(to), weight));
 }
 
-// Dijkstra's shortest path in a weighted graph from node_start to node_end.
+// A* search of the shortest path in a weighted graph from node_start to node_end.
+// The search is guided by the Euclidean distance to node_end, which never overestimates the remaining path length,
+// as the edge weights are the Euclidean lengths of the edges. The nodes enter the queue once they are reached,
+// so the search visits just the nodes around the shortest path instead of all the nodes of the graph.
 // The returned path contains the end points.
 // If no path exists from node_start to node_end, a straight segment is returned.
 Polyline MotionPlannerGraph::shortest_path(size_t node_start, size_t node_end) const
@@ -313,45 +344,60 @@ Polyline MotionPlannerGraph::shortest_path(size_t node_start, size_t node_end) c
     if (this->empty())
         return Polyline();
 
-    // Dijkstra algorithm, previous node of the current node 'u' in the shortest path towards node_start.
-    std::vector<node_t>   previous(m_adjacency_list.size(), -1);
-    std::vector<weight_t> distance(m_adjacency_list.size(), std::numeric_limits<weight_t>::infinity());
-    std::vector<size_t>   map_node_to_queue_id(m_adjacency_list.size(), size_t(-1));
-    distance[node_start] = 0.;
+    // Queue id of a node not reached yet and of a node, for which the shortest path was already found.
+    static const size_t NOT_REACHED = size_t(-1);
+    static const size_t CLOSED      = size_t(-2);
+
+    // Previous node of the current node 'u' in the shortest path towards node_start.
+    std::vector<node_t>   previous(m_nodes.size(), -1);
+    // Length of the shortest path from node_start found so far.
+    std::vector<weight_t> distance(m_nodes.size(), std::numeric_limits<weight_t>::infinity());
+    // Lower bound of the length of the path from node_start to node_end through the node.
+    std::vector<weight_t> estimate(m_nodes.size(), std::numeric_limits<weight_t>::infinity());
+    std::vector<size_t>   map_node_to_queue_id(m_nodes.size(), NOT_REACHED);
+    const Point          &pt_end    = m_nodes[node_end];
+    auto                  heuristic = [this, &pt_end](const node_t node) { return (pt_end - m_nodes[node]).cast<double>().norm(); };
 
     auto queue = make_mutable_priority_queue<node_t>(
         [&map_node_to_queue_id](const node_t node, size_t idx) { map_node_to_queue_id[node] = idx; },
-        [&distance](const node_t node1, const node_t node2) { return distance[node1] < distance[node2]; });
-    queue.reserve(m_adjacency_list.size());
-    for (size_t i = 0; i < m_adjacency_list.size(); ++ i)
-        queue.push(node_t(i));
+        [&estimate](const node_t node1, const node_t node2) { return estimate[node1] < estimate[node2]; });
+    distance[node_start] = 0.;
+    estimate[node_start] = heuristic(node_t(node_start));
+    queue.push(node_t(node_start));
 
     while (! queue.empty()) {
-        // Get the next node with the lowest distance to node_start.
+        // Get the next node with the lowest estimate of the path length through it.
         node_t u = node_t(queue.top());
         queue.pop();
-        map_node_to_queue_id[u] = size_t(-1);
+        map_node_to_queue_id[u] = CLOSED;
         // Stop searching if we reached our destination.
         if (u == node_end)
             break;
+        if (size_t(u) >= m_adjacency_list.size())
+            continue;
         // Visit each edge starting at node u.
-        for (const Neighbor& neighbor : m_adjacency_list[u])
-            if (map_node_to_queue_id[neighbor.target] != size_t(-1)) {
-                weight_t alt = distance[u] + neighbor.weight;
-                // If total distance through u is shorter than the previous
-                // distance (if any) between node_start and neighbor.target, replace it.
-                if (alt < distance[neighbor.target]) {
-                    distance[neighbor.target] = alt;
-                    previous[neighbor.target] = u;
-                    queue.update(map_node_to_queue_id[neighbor.target]);
-                }
+        for (const Neighbor& neighbor : m_adjacency_list[u]) {
+            size_t queue_id = map_node_to_queue_id[neighbor.target];
+            if (queue_id == CLOSED)
+                continue;
+            weight_t alt = distance[u] + neighbor.weight;
+            // If total distance through u is shorter than the previous
+            // distance (if any) between node_start and neighbor.target, replace it.
+            if (alt < distance[neighbor.target]) {
+                distance[neighbor.target] = alt;
+                estimate[neighbor.target] = alt + heuristic(neighbor.target);
+                previous[neighbor.target] = u;
+                if (queue_id == NOT_REACHED)
+                    queue.push(neighbor.target);
+                else
+                    queue.update(queue_id);
             }
+        }
     }
 
     // In case the end point was not reached, previous[node_end] contains -1
     // and a straight line from node_start to node_end is returned.
     Polyline polyline;
-    polyline.points.reserve(m_adjacency_list.size());
     for (node_t vertex = node_t(node_end); vertex != -1; vertex = previous[vertex])
         polyline.points.emplace_back(m_nodes[vertex]);
     polyline.points.emplace_back(m_nodes[node_start]);
@@ -4,6 +4,7 @@
 #include "libslic3r.h"
 #include "BoundingBox.hpp"
 #include "ClipperUtils.hpp"
+#include "EdgeGrid.hpp"
 #include "ExPolygonCollection.hpp"
 #include "Polyline.hpp"
 #include <map>
@@ -36,9 +37,14 @@ private:
     BoundingBox         m_island_bbox;
     // Region, where the travel is allowed.
     ExPolygonCollection m_env;
+    // m_env grown by SCALED_EPSILON, created together with the graph of this environment.
+    ExPolygonCollection m_env_grown;
+    // Edge grid over m_island for the visibility tests of nearest_env_point(). It references the contours of m_island,
+    // therefore it is created once the environment is stored at its final place and the environment is not moved afterwards.
+    std::unique_ptr<EdgeGrid::Grid> m_island_grid;
 };
 
-// A 2D directed graph for searching a shortest path using the famous Dijkstra algorithm.
+// A 2D directed graph for searching a shortest path using the A* algorithm.
 class MotionPlannerGraph
 {    
 public:
@@ -84,6 +90,8 @@ private:
     const MotionPlannerGraph& init_graph(int island_idx);
     const MotionPlannerEnv&   get_env(int island_idx) const
         { return (island_idx == -1) ? m_outer : m_islands[island_idx]; }
+    MotionPlannerEnv&         get_env(int island_idx)
+        { return (island_idx == -1) ? m_outer : m_islands[island_idx]; }
 };
 
 }
@@ -162,9 +162,9 @@ bool MultiPoint::first_intersection(const Line& line, Point* intersection) const
     return found;
 }
 
-std::vector<Point> MultiPoint::_douglas_peucker(const std::vector<Point>& pts, const double tolerance)
+Points MultiPoint::_douglas_peucker(const Points& pts, const double tolerance)
 {
-    std::vector<Point> result_pts;
+    Points result_pts;
     if (! pts.empty()) {
         const Point  *anchor      = &pts.front();
         size_t        anchor_idx  = 0;
@@ -11,6 +11,10 @@
 
 #include <Eigen/Geometry> 
 
+#ifdef SLIC3R_SCALABLE_ALLOCATOR
+#include <tbb/scalable_allocator.h>
+#endif
+
 namespace Slic3r {
 
 class Line;
@@ -32,7 +36,15 @@ typedef Eigen::Matrix<float,    3, 1, Eigen::DontAlign> Vec3f;
 typedef Eigen::Matrix<double,   2, 1, Eigen::DontAlign> Vec2d;
 typedef Eigen::Matrix<double,   3, 1, Eigen::DontAlign> Vec3d;
 
-typedef std::vector<Point>                              Points;
+// Allocator of the points of polygons and polylines. The TBB scalable allocator keeps a pool of memory blocks per thread,
+// so that the short lived polygons of the layers processed in parallel do not contend for the locks of the system allocator.
+#ifdef SLIC3R_SCALABLE_ALLOCATOR
+template<typename T> using PointsAllocator = tbb::scalable_allocator<T>;
+#else
+template<typename T> using PointsAllocator = std::allocator<T>;
+#endif
+
+typedef std::vector<Point, PointsAllocator<Point>>      Points;
 typedef std::vector<Point*>                             PointPtrs;
 typedef std::vector<const Point*>                       PointConstPtrs;
 typedef std::vector<Vec3crd>                            Points3;
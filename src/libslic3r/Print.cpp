@@ -12,6 +12,8 @@
 #include <unordered_set>
 #include <boost/log/trivial.hpp>
 
+#include <tbb/parallel_for.h>
+
 #include "PrintExport.hpp"
 
 #include <boost/filesystem/path.hpp>
@@ -37,6 +39,7 @@ void Print::clear()
         delete region;
     m_regions.clear();
     m_model.clear_objects();
+    m_volume_slices_cache.clear();
 }
 
 // Only used by the Perl test cases.
@@ -395,6 +398,28 @@ static PrintRegionConfig region_config_from_model_volume(const PrintRegionConfig
     return config;
 }
 
+// If a region of a PrintObject is made of modifier volumes only, its slices are limited to the Z span of these modifiers.
+// Returns the Z span in the slicing coordinates of the PrintObject (see Layer::slice_z), or false for a region
+// containing a model part, which spans the whole object.
+static bool region_modifiers_z_range(const PrintObject &print_object, size_t region_id, t_layer_height_range &z_range)
+{
+    BoundingBoxf3 bbox;
+    for (int volume_id : print_object.region_volumes[region_id]) {
+        const ModelVolume &volume = *print_object.model_object()->volumes[volume_id];
+        if (! volume.is_modifier())
+            return false;
+#if ENABLE_MODELVOLUME_TRANSFORM
+        bbox.merge(volume.mesh().transformed_bounding_box(print_object.trafo() * volume.get_matrix()));
+#else
+        bbox.merge(volume.mesh().transformed_bounding_box(print_object.trafo()));
+#endif // ENABLE_MODELVOLUME_TRANSFORM
+    }
+    if (! bbox.defined)
+        return false;
+    z_range = t_layer_height_range(bbox.min(2), bbox.max(2));
+    return true;
+}
+
 // Caller is responsible for supplying models whose objects don't collide
 // and have explicit instance positions.
 void Print::add_model_object(ModelObject* model_object, int idx)
@@ -1077,8 +1102,13 @@ Print::ApplyStatus Print::apply(const Model &model, const DynamicPrintConfig &co
             if (! diff.empty()) {
                 region.config_apply_only(this_region_config, diff, false);
                 for (PrintObject *print_object : m_objects)
-                    if (region_id < print_object->region_volumes.size() && ! print_object->region_volumes[region_id].empty())
-                        update_apply_status(print_object->invalidate_state_by_config_options(diff));
+                    if (region_id < print_object->region_volumes.size() && ! print_object->region_volumes[region_id].empty()) {
+                        // Changing the config of a modifier only influences the layers the modifier intersects.
+                        t_layer_height_range z_range;
+                        update_apply_status(region_modifiers_z_range(*print_object, region_id, z_range) ?
+                            print_object->invalidate_state_by_config_options(diff, z_range.first, z_range.second) :
+                            print_object->invalidate_state_by_config_options(diff));
+                    }
             }
         }
     }
@@ -1140,6 +1170,9 @@ Print::ApplyStatus Print::apply(const Model &model, const DynamicPrintConfig &co
             // update_apply_status(object->invalidate_step(posSlice));
             object->update_layer_height_profile();
 
+    // Release the cached slices of the deleted or transformed ModelVolumes.
+    m_volume_slices_cache.retain(m_objects);
+
     //FIXME there may be a race condition with the G-code export running at the background thread.
     this->update_object_placeholders();
 
@@ -1179,7 +1212,7 @@ std::string Print::validate() const
                     Polygons mesh_convex_hulls;
                     for (const std::vector<int> &volumes : object->region_volumes)
                         for (int volume_id : volumes)
-                            mesh_convex_hulls.emplace_back(object->model_object()->volumes[volume_id]->mesh.convex_hull());
+                            mesh_convex_hulls.emplace_back(object->model_object()->volumes[volume_id]->mesh().convex_hull());
                     // make a single convex hull for all of them
                     convex_hull = Slic3r::Geometry::convex_hull(mesh_convex_hulls);
                 }
@@ -1471,13 +1504,28 @@ void Print::auto_assign_extruders(ModelObject* model_object) const
 void Print::process()
 {
     BOOST_LOG_TRIVIAL(info) << "Staring the slicing process.";
-    for (PrintObject *obj : m_objects)
-        obj->make_perimeters();
-    this->set_status(70, "Infilling layers");
-    for (PrintObject *obj : m_objects)
-        obj->infill();
-    for (PrintObject *obj : m_objects)
-        obj->generate_support_material();
+    // The PrintObjects are independent of each other up to the skirt / brim / wipe tower generation,
+    // therefore each PrintObject is pushed through its steps by its own task, so that small objects
+    // of a large plate keep all the cores busy. The steps of a single PrintObject depend on each other
+    // (posSupportMaterial reads the infill to detect bridging), they are executed sequentially inside the task
+    // and they parallelize over layers internally.
+    // The step state machine is guarded by the Print state mutex. If the background processing is canceled,
+    // the first task to notice throws CanceledException, the remaining tasks are canceled by TBB
+    // and the exception is re-thrown by tbb::parallel_for.
+    BOOST_LOG_TRIVIAL(debug) << "Processing objects in parallel - start";
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, m_objects.size(), 1),
+        [this](const tbb::blocked_range<size_t>& range) {
+            for (size_t idx_object = range.begin(); idx_object < range.end(); ++ idx_object) {
+                PrintObject *obj = m_objects[idx_object];
+                obj->make_perimeters();
+                obj->infill();
+                obj->generate_support_material();
+            }
+        }
+    );
+    this->throw_if_canceled();
+    BOOST_LOG_TRIVIAL(debug) << "Processing objects in parallel - end";
     if (this->set_started(psSkirt)) {
         m_skirt.clear();
         if (this->has_skirt()) {
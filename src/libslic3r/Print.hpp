@@ -8,6 +8,7 @@
 #include "Point.hpp"
 #include "Layer.hpp"
 #include "Model.hpp"
+#include "SliceCache.hpp"
 #include "Slicing.hpp"
 #include "GCode/ToolOrdering.hpp"
 #include "GCode/WipeTower.hpp"
@@ -70,6 +71,43 @@ typedef std::vector<Layer*> LayerPtrs;
 typedef std::vector<SupportLayer*> SupportLayerPtrs;
 class BoundingBoxf3;        // TODO: for temporary constructor parameter
 
+// Slices of the individual ModelVolumes, shared by all PrintObjects of a Print.
+// Print::apply() deletes and recreates the PrintObjects of a ModelObject whenever one of its part or modifier
+// volumes is added, removed or transformed, while the slices of the untouched volumes remain valid.
+// An entry is identified by the mesh of the volume, by the complete transformation the volume was sliced with
+// and by the slicing Z heights. The mesh is shared by the copies of a ModelVolume and replaced by set_mesh(),
+// or copied by mesh_mutable() before being modified, therefore the mesh identity changes with the mesh geometry,
+// while the ModelVolume ID does not. The entries only hold weak references, so that a released mesh
+// is never matched by a new mesh allocated at the same address.
+// Thread safe, the PrintObjects are sliced in parallel.
+class VolumeSlicesCache
+{
+public:
+    typedef std::shared_ptr<const std::vector<ExPolygons>> SlicesConstPtr;
+
+    // Returns nullptr if the volume has not been sliced with this transformation at these Z heights yet.
+    SlicesConstPtr  find(const ModelVolume &volume, const Transform3d &trafo, const std::vector<float> &z) const;
+    void            insert(const ModelVolume &volume, const Transform3d &trafo, const std::vector<float> &z, SlicesConstPtr slices);
+    // Remove slices of meshes no longer referenced by the print objects. For each mesh, keep at most as many
+    // of the most recently used entries, as there are volumes of the PrintObjects (instance transformations) referencing it.
+    void            retain(const std::vector<PrintObject*> &print_objects);
+    void            clear();
+
+private:
+    struct Entry {
+        Entry() : last_used(0) {}
+        std::weak_ptr<const TriangleMesh> mesh;
+        Transform3d         trafo;
+        std::vector<float>  z;
+        SlicesConstPtr      slices;
+        size_t              last_used;
+    };
+    mutable tbb::mutex      m_mutex;
+    // Just a couple of entries per mesh, a linear search is good enough.
+    mutable std::vector<Entry> m_entries;
+    mutable size_t          m_timestamp = 0;
+};
+
 class PrintObject : public PrintObjectBaseWithState<Print, PrintObjectStep, posCount>
 {
 private: // Prevents erroneous use by other classes.
@@ -171,6 +209,13 @@ protected:
     bool                    invalidate_all_steps();
     // Invalidate steps based on a set of parameters changed.
     bool                    invalidate_state_by_config_options(const std::vector<t_config_option_key> &opt_keys);
+    // Invalidates the step and its depending steps like invalidate_step(), but only for the layers overlapping
+    // the <min_z, max_z> range of the slicing Z coordinate (see Layer::slice_z). The posPerimeters and posInfill steps
+    // will then recompute just these layers and their neighbors, keeping the results of the other layers.
+    // Other steps, or steps already invalidated for the whole object, are invalidated for all the layers.
+    bool                    invalidate_layer_range(PrintObjectStep step, coordf_t min_z, coordf_t max_z);
+    // Invalidate steps based on a set of parameters changed, which influence the <min_z, max_z> range only.
+    bool                    invalidate_state_by_config_options(const std::vector<t_config_option_key> &opt_keys, coordf_t min_z, coordf_t max_z);
 
 private:
     void make_perimeters();
@@ -178,6 +223,12 @@ private:
     void infill();
     void generate_support_material();
 
+    bool invalidate_state_by_config_options(const std::vector<t_config_option_key> &opt_keys, const t_layer_height_range *z_range);
+    // Indices of the layers to be recomputed by a step including "margin" neighbor layers, all layers if the step
+    // has not been invalidated by invalidate_layer_range().
+    std::vector<size_t> invalid_layers(PrintObjectStep step, size_t margin) const;
+    void clear_invalid_layer_ranges(PrintObjectStep step);
+
     void _slice();
     std::string _fix_slicing_errors();
     void _simplify_slices(double distance);
@@ -205,8 +256,15 @@ private:
     LayerPtrs                               m_layers;
     SupportLayerPtrs                        m_support_layers;
 
+    // Ranges of slicing Z coordinates passed to invalidate_layer_range() since the step was last finished.
+    // Empty if the step is valid or if it is to be recomputed for all the layers.
+    // Modified by the UI thread with the Print state mutex locked, cleared by the worker thread when the step finishes.
+    std::vector<t_layer_height_range>       m_invalid_layer_ranges[posCount];
+
     std::vector<ExPolygons> _slice_region(size_t region_id, const std::vector<float> &z, bool modifier);
     std::vector<ExPolygons> _slice_volumes(const std::vector<float> &z, const std::vector<const ModelVolume*> &volumes) const;
+    // Key of the persistent slice cache, hashing the layers, the meshes and the slicing relevant configuration.
+    uint64_t                slice_cache_key() const;
 };
 
 struct WipeTowerData
@@ -354,6 +412,9 @@ public:
 
 	std::string                 output_filename() const override;
 
+    // Directory of the persistent slice cache, an empty string disables the cache.
+    void                        set_slice_cache_dir(const std::string &dir) { m_slice_cache = SliceCache(dir); }
+
     // Accessed by SupportMaterial
     const PrintRegion*  get_region(size_t idx) const  { return m_regions[idx]; }
 
@@ -393,6 +454,11 @@ private:
     // Estimated print time, filament consumed.
     PrintStatistics                         m_print_statistics;
 
+    // Slices of ModelVolumes, surviving the re-creation of PrintObjects by Print::apply().
+    VolumeSlicesCache                       m_volume_slices_cache;
+    // Slices of PrintObjects stored on disk, surviving the slicer process.
+    SliceCache                              m_slice_cache;
+
     // To allow GCode to set the Print's GCodeExport step status.
     friend class GCode;
     // Allow PrintObject to access m_mutex and m_cancel_callback.
@@ -2,6 +2,7 @@
 #define slic3r_PrintBase_hpp_
 
 #include "libslic3r.h"
+#include <atomic>
 #include <set>
 #include <vector>
 #include <string>
@@ -43,10 +44,9 @@ public:
     };
 
 protected:
-    //FIXME last timestamp is shared between Print & SLAPrint,
-    // and if multiple Print or SLAPrint instances are executed in parallel, modification of g_last_timestamp
-    // is not synchronized!
-    static size_t g_last_timestamp;
+    // The last timestamp is shared between Print & SLAPrint. Multiple Print or SLAPrint instances
+    // may be executed in parallel (see the --batch-jobs command line option), each locking its own state mutex only.
+    static std::atomic<size_t> g_last_timestamp;
 };
 
 // To be instantiated over PrintStep or PrintObjectStep enums.
@@ -372,6 +372,9 @@ protected:
 	PrintStateBase::TimeStamp set_done(PrintObjectStepEnum step) 
         { return m_state.set_done(step, PrintObjectBase::state_mutex(m_print), [this](){ this->throw_if_canceled(); }); }
 
+    // To be called with the PrintBase::m_state_mutex locked, for example from the Print::apply().
+    bool            is_step_done_unguarded(PrintObjectStepEnum step) const { return m_state.is_done_unguarded(step); }
+
     bool            invalidate_step(PrintObjectStepEnum step)
         { return m_state.invalidate(step, PrintObjectBase::cancel_callback(m_print)); }
     template<typename StepTypeIterator>
@@ -2997,6 +2997,24 @@ CLIConfigDef::CLIConfigDef()
 {
     ConfigOptionDef *def;
     
+    def = this->add("batch", coBool);
+    def->label = L("Batch mode");
+    def->tooltip = L("Read slicing jobs from the standard input, one job per line, until the end of the input. "
+                     "A job is a list of input files and command line options, overriding the options "
+                     "passed to this process. A line with the job number, its status and its duration "
+                     "is printed to the standard output when a job finishes. The --output option "
+                     "of this process is ignored, a job is exported to its own --output file "
+                     "or next to its first input file.");
+    def->cli = "batch";
+    def->default_value = new ConfigOptionBool(false);
+
+    def = this->add("batch_jobs", coInt);
+    def->label = L("Concurrent batch jobs");
+    def->tooltip = L("Maximum number of jobs sliced concurrently in the batch mode.");
+    def->cli = "batch-jobs";
+    def->min = 1;
+    def->default_value = new ConfigOptionInt(1);
+
     def = this->add("cut", coFloat);
     def->label = L("Cut");
     def->tooltip = L("Cut model at the given Z.");
@@ -3092,6 +3110,13 @@ CLIConfigDef::CLIConfigDef()
     def->cli = "save";
     def->default_value = new ConfigOptionString();
     
+    def = this->add("slice_cache", coString);
+    def->label = L("Slice cache directory");
+    def->tooltip = L("Store the slices of the objects into the specified directory and reuse them "
+                     "when slicing the same objects with the same slicing parameters again.");
+    def->cli = "slice-cache";
+    def->default_value = new ConfigOptionString();
+    
     def = this->add("scale", coFloat);
     def->label = L("Scale");
     def->tooltip = L("Scaling factor (default: 1).");
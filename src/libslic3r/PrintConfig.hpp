@@ -1107,6 +1107,8 @@ extern const CLIConfigDef cli_config_def;
 class CLIConfig : public virtual ConfigBase, public StaticConfig
 {
 public:
+    ConfigOptionBool                batch;
+    ConfigOptionInt                 batch_jobs;
     ConfigOptionFloat               cut;
     ConfigOptionString              datadir;
     ConfigOptionBool                dont_arrange;
@@ -1125,6 +1127,7 @@ public:
     ConfigOptionFloat               scale;
 //    ConfigOptionPoint3              scale_to_fit;
     ConfigOptionBool                slice;
+    ConfigOptionString              slice_cache;
 
     CLIConfig() : ConfigBase(), StaticConfig()
     {
@@ -1137,6 +1140,8 @@ public:
 
     ConfigOption*			optptr(const t_config_option_key &opt_key, bool create = false) override
     {
+        OPT_PTR(batch);
+        OPT_PTR(batch_jobs);
         OPT_PTR(cut);
         OPT_PTR(datadir);
         OPT_PTR(dont_arrange);
@@ -1155,6 +1160,7 @@ public:
         OPT_PTR(scale);
 //        OPT_PTR(scale_to_fit);
         OPT_PTR(slice);
+        OPT_PTR(slice_cache);
         return NULL;
     }
 };
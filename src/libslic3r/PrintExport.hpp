@@ -2,15 +2,19 @@
 #define PRINTEXPORT_HPP
 
 // For png export of the sliced model
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <vector>
 
 #include <boost/log/trivial.hpp>
 
+#include <tbb/parallel_for.h>
+#include <tbb/task_group.h>
+#include <tbb/task_scheduler_init.h>
+
 #include "Rasterizer/Rasterizer.hpp"
-//#include <tbb/parallel_for.h>
-//#include <tbb/spin_mutex.h>//#include "tbb/mutex.h"
+#include "PrintBase.hpp"
 
 namespace Slic3r {
 
@@ -95,7 +99,8 @@ public:
 
 // Implementation for PNG raster output
 // Be aware that if a large number of layers are allocated, it can very well
-// exhaust the available memory especially on 32 bit platform.
+// exhaust the available memory especially on 32 bit platform. Use
+// save_streaming() to rasterize and save the layers without keeping them.
 template<> class FilePrinter<FilePrinterFormat::SLA_PNGZIP>
 {
     struct Layer {
@@ -118,6 +123,10 @@ template<> class FilePrinter<FilePrinterFormat::SLA_PNGZIP>
     double m_layer_height = .0;
     Raster::Origin m_o = Raster::Origin::TOP_LEFT;
 
+    // The layers are kept as run-length spans until they are compressed,
+    // the mostly black SLA layers would waste a full pixel buffer each.
+    Raster::Storage m_storage = Raster::Storage::SPANS;
+
     std::string createIniContent(const std::string& projectname) {
         double layer_height = m_layer_height;
 
@@ -200,12 +209,12 @@ public:
 
     inline void begin_layer(unsigned lyr) {
         if(m_layers_rst.size() <= lyr) m_layers_rst.resize(lyr+1);
-        m_layers_rst[lyr].first.reset(m_res, m_pxdim, m_o);
+        m_layers_rst[lyr].first.reset(m_res, m_pxdim, m_o, m_storage);
     }
 
     inline void begin_layer() {
         m_layers_rst.emplace_back();
-        m_layers_rst.front().first.reset(m_res, m_pxdim, m_o);
+        m_layers_rst.front().first.reset(m_res, m_pxdim, m_o, m_storage);
     }
 
     inline void finish_layer(unsigned lyr_id) {
@@ -259,6 +268,98 @@ public:
         }
     }
 
+    // Rasterize all the layers and save them into the zip file specified in
+    // the path argument without keeping them in the printer. The draw_layer
+    // functor with a signature void(Raster&, unsigned layer_id) draws
+    // the polygons of a layer into an empty raster. The progress functor
+    // with a signature void(unsigned layers_done) is called after each
+    // window of layers has been rasterized.
+    //
+    // The layers are rasterized and compressed in parallel in windows of
+    // a couple of layers. The compressed layers of a window are written into
+    // the zip file in order by a background task while the next window is
+    // being rasterized. Thus the peak memory is given by two windows of PNG
+    // data and a raster per worker thread, independent of the layer count.
+    template<class LyrFmt, class DrawFn, class ProgressFn>
+    inline void save_streaming(const std::string& path, unsigned layer_count,
+                               DrawFn draw_layer, ProgressFn progress)
+    {
+        const unsigned window = std::max(4u,
+            2u * unsigned(tbb::task_scheduler_init::default_num_threads()));
+
+        try {
+            LayerWriter<LyrFmt> writer(path);
+            if(!writer.is_ok()) return;
+
+            std::string project = writer.get_name();
+
+            writer.next_entry("config.ini");
+            if(!writer.is_ok()) return;
+
+            writer << createIniContent(project);
+
+            std::vector<std::string> png_compressed;
+            std::vector<std::string> png_to_write;
+            tbb::task_group          tg;
+            try {
+                for(unsigned window_begin = 0; window_begin < layer_count;
+                    window_begin += window)
+                {
+                    unsigned window_end = std::min(layer_count,
+                                                   window_begin + window);
+                    png_compressed.assign(window_end - window_begin,
+                                          std::string());
+                    tbb::parallel_for(
+                        tbb::blocked_range<unsigned>(window_begin, window_end),
+                        [this, &draw_layer, &png_compressed, window_begin]
+                        (const tbb::blocked_range<unsigned>& range)
+                    {
+                        for(unsigned i = range.begin(); i < range.end(); ++i) {
+                            Raster raster(m_res, m_pxdim, m_o, m_storage);
+                            draw_layer(raster, i);
+                            std::stringstream ss;
+                            raster.save(ss, Raster::Compression::PNG);
+                            png_compressed[i - window_begin] = ss.str();
+                        }
+                    });
+
+                    progress(window_end);
+
+                    // Wait until the previous window is written, then pass
+                    // this window to the writer.
+                    tg.wait();
+                    if(!writer.is_ok()) break;
+                    png_to_write.swap(png_compressed);
+                    tg.run([&writer, &project, &png_to_write, window_begin]() {
+                        for(unsigned i = 0; i < png_to_write.size(); ++i) {
+                            char lyrnum[6];
+                            std::sprintf(lyrnum, "%.5d", window_begin + i);
+                            writer.next_entry(project + lyrnum + ".png");
+
+                            if(!writer.is_ok()) break;
+
+                            writer << png_to_write[i];
+                            // Release the memory early.
+                            std::string().swap(png_to_write[i]);
+                        }
+                    });
+                }
+                tg.wait();
+            } catch(...) {
+                // Don't let the writer task outlive the PNG buffers.
+                tg.wait();
+                throw;
+            }
+        } catch(CanceledException&) {
+            // Canceling is not an error, just pass it to the caller.
+            throw;
+        } catch(std::exception& e) {
+            BOOST_LOG_TRIVIAL(error) << e.what();
+            // Rethrow the exception
+            throw;
+        }
+    }
+
     void save_layer(unsigned lyr, const std::string& path) {
         unsigned i = lyr;
         assert(i < m_layers_rst.size());
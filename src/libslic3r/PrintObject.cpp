@@ -8,6 +8,7 @@
 
 #include <utility>
 #include <boost/log/trivial.hpp>
+#include <boost/functional/hash.hpp>
 #include <float.h>
 
 #include <tbb/task_scheduler_init.h>
@@ -71,7 +72,7 @@ PrintObject::PrintObject(Print* print, ModelObject* model_object, bool add_insta
 bool PrintObject::set_copies(const Points &points)
 {
     // Order copies with a nearest-neighbor search.
-    std::vector<Point> copies;
+    Points copies;
     {
         std::vector<Points::size_type> ordered_copies;
         Slic3r::Geometry::chained_path(points, ordered_copies);
@@ -133,14 +134,34 @@ void PrintObject::make_perimeters()
 
     m_print->set_status(20, "Generating perimeters");
     BOOST_LOG_TRIVIAL(info) << "Generating perimeters...";
-    
+
+    // If the step was invalidated for a Z range only, just the layers of this range are recomputed
+    // together with their neighbors: The extra perimeters depend on the layer above,
+    // the overhangs depend on the layer below.
+    const std::vector<size_t> layers = this->invalid_layers(posPerimeters, 1);
+    const bool                all_layers = layers.size() == m_layers.size();
+
     // merge slices if they were split into types
     if (this->typed_slices) {
-        for (Layer *layer : m_layers) {
-            layer->merge_slices();
-            m_print->throw_if_canceled();
+        if (all_layers) {
+            for (Layer *layer : m_layers) {
+                layer->merge_slices();
+                m_print->throw_if_canceled();
+            }
+            this->typed_slices = false;
+        } else {
+            // Merge the slices of the layers above the recomputed layers as well, so that the extra perimeters
+            // are calculated against the same upper slices as if all the layers were recomputed.
+            // The slices of the other layers stay typed, detect_surfaces_type() works over typed slices as well.
+            std::vector<char> merge(m_layers.size() + 1, false);
+            for (size_t idx_layer : layers)
+                merge[idx_layer] = merge[idx_layer + 1] = true;
+            for (size_t idx_layer = 0; idx_layer < m_layers.size(); ++ idx_layer)
+                if (merge[idx_layer]) {
+                    m_layers[idx_layer]->merge_slices();
+                    m_print->throw_if_canceled();
+                }
         }
-        this->typed_slices = false;
     }
     
     // compare each layer to the one below, and mark those slices needing
@@ -157,9 +178,13 @@ void PrintObject::make_perimeters()
         
         BOOST_LOG_TRIVIAL(debug) << "Generating extra perimeters for region " << region_id << " in parallel - start";
         tbb::parallel_for(
-            tbb::blocked_range<size_t>(0, m_layers.size() - 1),
-            [this, &region, region_id](const tbb::blocked_range<size_t>& range) {
-                for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
+            tbb::blocked_range<size_t>(0, layers.size()),
+            [this, &layers, &region, region_id](const tbb::blocked_range<size_t>& range) {
+                for (size_t i = range.begin(); i < range.end(); ++ i) {
+                    size_t layer_idx = layers[i];
+                    if (layer_idx + 1 == m_layers.size())
+                        // The topmost layer has no layer above.
+                        continue;
                     m_print->throw_if_canceled();
                     LayerRegion &layerm                     = *m_layers[layer_idx]->m_regions[region_id];
                     const LayerRegion &upper_layerm         = *m_layers[layer_idx+1]->m_regions[region_id];
@@ -213,13 +238,13 @@ void PrintObject::make_perimeters()
         BOOST_LOG_TRIVIAL(debug) << "Generating extra perimeters for region " << region_id << " in parallel - end";
     }
 
-    BOOST_LOG_TRIVIAL(debug) << "Generating perimeters in parallel - start";
+    BOOST_LOG_TRIVIAL(debug) << "Generating perimeters of " << layers.size() << " of " << m_layers.size() << " layers in parallel - start";
     tbb::parallel_for(
-        tbb::blocked_range<size_t>(0, m_layers.size()),
-        [this](const tbb::blocked_range<size_t>& range) {
-            for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
+        tbb::blocked_range<size_t>(0, layers.size()),
+        [this, &layers](const tbb::blocked_range<size_t>& range) {
+            for (size_t i = range.begin(); i < range.end(); ++ i) {
                 m_print->throw_if_canceled();
-                m_layers[layer_idx]->make_perimeters();
+                m_layers[layers[i]]->make_perimeters();
             }
         }
     );
@@ -233,6 +258,7 @@ void PrintObject::make_perimeters()
     ###$self->_simplify_slices(&Slic3r::SCALED_RESOLUTION);
     */
     
+    this->clear_invalid_layer_ranges(posPerimeters);
     this->set_done(posPerimeters);
 }
 
@@ -254,11 +280,16 @@ void PrintObject::prepare_infill()
     // Here the S_TYPE_TOP / S_TYPE_BOTTOMBRIDGE / S_TYPE_BOTTOM infill is turned to just S_TYPE_INTERNAL if zero top / bottom infill layers are configured.
     // Also tiny S_TYPE_INTERNAL surfaces are turned to S_TYPE_INTERNAL_SOLID.
     BOOST_LOG_TRIVIAL(info) << "Preparing fill surfaces...";
-    for (auto *layer : m_layers)
-        for (auto *region : layer->m_regions) {
-            region->prepare_fill_surfaces();
-            m_print->throw_if_canceled();
-        }
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, m_layers.size()),
+        [this](const tbb::blocked_range<size_t>& range) {
+            for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx)
+                for (auto *region : m_layers[layer_idx]->m_regions) {
+                    region->prepare_fill_surfaces();
+                    m_print->throw_if_canceled();
+                }
+        });
+    m_print->throw_if_canceled();
 
     // this will detect bridges and reverse bridges
     // and rearrange top/bottom/internal surfaces
@@ -348,22 +379,68 @@ void PrintObject::prepare_infill()
     } // for each layer
 #endif /* SLIC3R_DEBUG_SLICE_PROCESSING */
 
+    this->clear_invalid_layer_ranges(posPrepareInfill);
     this->set_done(posPrepareInfill);
 }
 
+// Hash of everything of the fill surfaces the infill generation depends on.
+static size_t fill_surfaces_hash(const SurfaceCollection &fill_surfaces)
+{
+    size_t seed = 0;
+    boost::hash_combine(seed, fill_surfaces.surfaces.size());
+    auto hash_polygon = [&seed](const Polygon &polygon) {
+        boost::hash_combine(seed, polygon.points.size());
+        for (const Point &pt : polygon.points) {
+            boost::hash_combine(seed, pt(0));
+            boost::hash_combine(seed, pt(1));
+        }
+    };
+    for (const Surface &surface : fill_surfaces.surfaces) {
+        boost::hash_combine(seed, int(surface.surface_type));
+        boost::hash_combine(seed, surface.thickness);
+        boost::hash_combine(seed, surface.thickness_layers);
+        boost::hash_combine(seed, surface.bridge_angle);
+        boost::hash_combine(seed, surface.extra_perimeters);
+        hash_polygon(surface.expolygon.contour);
+        boost::hash_combine(seed, surface.expolygon.holes.size());
+        for (const Polygon &hole : surface.expolygon.holes)
+            hash_polygon(hole);
+    }
+    return seed;
+}
+
 void PrintObject::infill()
 {
     // prerequisites
     this->prepare_infill();
 
     if (this->set_started(posInfill)) {
+        m_print->set_status(70, "Infilling layers");
+        // If the step was invalidated for a Z range only, the fills are regenerated for the layers of this range
+        // and their neighbors, whose thin fills may have been regenerated by make_perimeters(), and for the layers,
+        // whose fill surfaces were modified by prepare_infill().
+        std::vector<char> invalid(m_layers.size(), false);
+        for (size_t idx_layer : this->invalid_layers(posInfill, 1))
+            invalid[idx_layer] = true;
         BOOST_LOG_TRIVIAL(debug) << "Filling layers in parallel - start";
         tbb::parallel_for(
             tbb::blocked_range<size_t>(0, m_layers.size()),
-            [this](const tbb::blocked_range<size_t>& range) {
+            [this, &invalid](const tbb::blocked_range<size_t>& range) {
+                std::vector<size_t> hashes;
                 for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
                     m_print->throw_if_canceled();
-                    m_layers[layer_idx]->make_fills();
+                    Layer *layer = m_layers[layer_idx];
+                    bool   fill  = invalid[layer_idx] != 0;
+                    hashes.clear();
+                    for (const LayerRegion *layerm : layer->regions()) {
+                        hashes.emplace_back(fill_surfaces_hash(layerm->fill_surfaces));
+                        fill |= hashes.back() != layerm->fill_surfaces_hash;
+                    }
+                    if (fill) {
+                        layer->make_fills();
+                        for (size_t idx_region = 0; idx_region < hashes.size(); ++ idx_region)
+                            layer->regions()[idx_region]->fill_surfaces_hash = hashes[idx_region];
+                    }
                 }
             }
         );
@@ -372,6 +449,7 @@ void PrintObject::infill()
         /*  we could free memory now, but this would make this step not idempotent
         ### $_->fill_surfaces->clear for map @{$_->regions}, @{$object->layers};
         */
+        this->clear_invalid_layer_ranges(posInfill);
         this->set_done(posInfill);
     }
 }
@@ -431,6 +509,123 @@ SupportLayerPtrs::const_iterator PrintObject::insert_support_layer(SupportLayerP
 // Called by Print::apply_config().
 // This method only accepts PrintObjectConfig and PrintRegionConfig option keys.
 bool PrintObject::invalidate_state_by_config_options(const std::vector<t_config_option_key> &opt_keys)
+{
+    return this->invalidate_state_by_config_options(opt_keys, nullptr);
+}
+
+bool PrintObject::invalidate_state_by_config_options(const std::vector<t_config_option_key> &opt_keys, coordf_t min_z, coordf_t max_z)
+{
+    t_layer_height_range z_range(min_z, max_z);
+    return this->invalidate_state_by_config_options(opt_keys, &z_range);
+}
+
+// Collects the PrintObject and Print steps depending on a PrintObjectConfig or PrintRegionConfig option.
+// Returns false for the options, which are not known to this table, those invalidate everything.
+static bool config_option_steps(const t_config_option_key &opt_key, std::vector<PrintObjectStep> &steps, std::vector<PrintStep> &print_steps)
+{
+    if (   opt_key == "perimeters"
+        || opt_key == "extra_perimeters"
+        || opt_key == "gap_fill_speed"
+        || opt_key == "overhangs"
+        || opt_key == "first_layer_extrusion_width"
+        || opt_key == "perimeter_extrusion_width"
+        || opt_key == "infill_overlap"
+        || opt_key == "thin_walls"
+        || opt_key == "external_perimeters_first") {
+        steps.emplace_back(posPerimeters);
+    } else if (
+           opt_key == "layer_height"
+        || opt_key == "first_layer_height"
+        || opt_key == "raft_layers") {
+        steps.emplace_back(posSlice);
+    } else if (
+           opt_key == "clip_multipart_objects"
+        || opt_key == "elefant_foot_compensation"
+        || opt_key == "support_material_contact_distance" 
+        || opt_key == "xy_size_compensation") {
+        steps.emplace_back(posSlice);
+    } else if (
+           opt_key == "support_material"
+        || opt_key == "support_material_auto"
+        || opt_key == "support_material_angle"
+        || opt_key == "support_material_buildplate_only"
+        || opt_key == "support_material_enforce_layers"
+        || opt_key == "support_material_extruder"
+        || opt_key == "support_material_extrusion_width"
+        || opt_key == "support_material_interface_layers"
+        || opt_key == "support_material_interface_contact_loops"
+        || opt_key == "support_material_interface_extruder"
+        || opt_key == "support_material_interface_spacing"
+        || opt_key == "support_material_pattern"
+        || opt_key == "support_material_xy_spacing"
+        || opt_key == "support_material_spacing"
+        || opt_key == "support_material_synchronize_layers"
+        || opt_key == "support_material_threshold"
+        || opt_key == "support_material_with_sheath"
+        || opt_key == "dont_support_bridges"
+        || opt_key == "first_layer_extrusion_width") {
+        steps.emplace_back(posSupportMaterial);
+    } else if (
+           opt_key == "interface_shells"
+        || opt_key == "infill_only_where_needed"
+        || opt_key == "infill_every_layers"
+        || opt_key == "solid_infill_every_layers"
+        || opt_key == "bottom_solid_layers"
+        || opt_key == "top_solid_layers"
+        || opt_key == "solid_infill_below_area"
+        || opt_key == "infill_extruder"
+        || opt_key == "solid_infill_extruder"
+        || opt_key == "infill_extrusion_width"
+        || opt_key == "ensure_vertical_shell_thickness"
+        || opt_key == "bridge_angle") {
+        steps.emplace_back(posPrepareInfill);
+    } else if (
+           opt_key == "external_fill_pattern"
+        || opt_key == "external_fill_link_max_length"
+        || opt_key == "fill_angle"
+        || opt_key == "fill_pattern"
+        || opt_key == "fill_link_max_length"
+        || opt_key == "top_infill_extrusion_width"
+        || opt_key == "first_layer_extrusion_width") {
+        steps.emplace_back(posInfill);
+    } else if (
+           opt_key == "fill_density"
+        || opt_key == "solid_infill_extrusion_width") {
+        steps.emplace_back(posPerimeters);
+        steps.emplace_back(posPrepareInfill);
+    } else if (
+           opt_key == "external_perimeter_extrusion_width"
+        || opt_key == "perimeter_extruder") {
+        steps.emplace_back(posPerimeters);
+        steps.emplace_back(posSupportMaterial);
+    } else if (opt_key == "bridge_flow_ratio") {
+        steps.emplace_back(posPerimeters);
+        steps.emplace_back(posInfill);
+    } else if (
+           opt_key == "seam_position"
+        || opt_key == "seam_preferred_direction"
+        || opt_key == "seam_preferred_direction_jitter"
+        || opt_key == "support_material_speed"
+        || opt_key == "support_material_interface_speed"
+        || opt_key == "bridge_speed"
+        || opt_key == "external_perimeter_speed"
+        || opt_key == "infill_speed"
+        || opt_key == "perimeter_speed"
+        || opt_key == "small_perimeter_speed"
+        || opt_key == "solid_infill_speed"
+        || opt_key == "top_solid_infill_speed") {
+        print_steps.emplace_back(psGCodeExport);
+    } else if (
+           opt_key == "wipe_into_infill"
+        || opt_key == "wipe_into_objects") {
+        print_steps.emplace_back(psWipeTower);
+        print_steps.emplace_back(psGCodeExport);
+    } else
+        return false;
+    return true;
+}
+
+bool PrintObject::invalidate_state_by_config_options(const std::vector<t_config_option_key> &opt_keys, const t_layer_height_range *z_range)
 {
     if (opt_keys.empty())
         return false;
@@ -438,122 +633,37 @@ bool PrintObject::invalidate_state_by_config_options(const std::vector<t_config_
     std::vector<PrintObjectStep> steps;
     bool invalidated = false;
     for (const t_config_option_key &opt_key : opt_keys) {
-        if (   opt_key == "perimeters"
-            || opt_key == "extra_perimeters"
-            || opt_key == "gap_fill_speed"
-            || opt_key == "overhangs"
-            || opt_key == "first_layer_extrusion_width"
-            || opt_key == "perimeter_extrusion_width"
-            || opt_key == "infill_overlap"
-            || opt_key == "thin_walls"
-            || opt_key == "external_perimeters_first") {
-            steps.emplace_back(posPerimeters);
-        } else if (
-               opt_key == "layer_height"
-            || opt_key == "first_layer_height"
-            || opt_key == "raft_layers") {
-            steps.emplace_back(posSlice);
-			this->reset_layer_height_profile();
-		}
-		else if (
-               opt_key == "clip_multipart_objects"
-            || opt_key == "elefant_foot_compensation"
-            || opt_key == "support_material_contact_distance" 
-            || opt_key == "xy_size_compensation") {
-            steps.emplace_back(posSlice);
-        } else if (
-               opt_key == "support_material"
-            || opt_key == "support_material_auto"
-            || opt_key == "support_material_angle"
-            || opt_key == "support_material_buildplate_only"
-            || opt_key == "support_material_enforce_layers"
-            || opt_key == "support_material_extruder"
-            || opt_key == "support_material_extrusion_width"
-            || opt_key == "support_material_interface_layers"
-            || opt_key == "support_material_interface_contact_loops"
-            || opt_key == "support_material_interface_extruder"
-            || opt_key == "support_material_interface_spacing"
-            || opt_key == "support_material_pattern"
-            || opt_key == "support_material_xy_spacing"
-            || opt_key == "support_material_spacing"
-            || opt_key == "support_material_synchronize_layers"
-            || opt_key == "support_material_threshold"
-            || opt_key == "support_material_with_sheath"
-            || opt_key == "dont_support_bridges"
-            || opt_key == "first_layer_extrusion_width") {
-            steps.emplace_back(posSupportMaterial);
-        } else if (
-               opt_key == "interface_shells"
-            || opt_key == "infill_only_where_needed"
-            || opt_key == "infill_every_layers"
-            || opt_key == "solid_infill_every_layers"
-            || opt_key == "bottom_solid_layers"
-            || opt_key == "top_solid_layers"
-            || opt_key == "solid_infill_below_area"
-            || opt_key == "infill_extruder"
-            || opt_key == "solid_infill_extruder"
-            || opt_key == "infill_extrusion_width"
-            || opt_key == "ensure_vertical_shell_thickness"
-            || opt_key == "bridge_angle") {
-            steps.emplace_back(posPrepareInfill);
-        } else if (
-               opt_key == "external_fill_pattern"
-            || opt_key == "external_fill_link_max_length"
-            || opt_key == "fill_angle"
-            || opt_key == "fill_pattern"
-            || opt_key == "fill_link_max_length"
-            || opt_key == "top_infill_extrusion_width"
-            || opt_key == "first_layer_extrusion_width") {
-            steps.emplace_back(posInfill);
-        } else if (
-               opt_key == "fill_density"
-            || opt_key == "solid_infill_extrusion_width") {
-            steps.emplace_back(posPerimeters);
-            steps.emplace_back(posPrepareInfill);
-        } else if (
-               opt_key == "external_perimeter_extrusion_width"
-            || opt_key == "perimeter_extruder") {
-            steps.emplace_back(posPerimeters);
-            steps.emplace_back(posSupportMaterial);
-        } else if (opt_key == "bridge_flow_ratio") {
-            steps.emplace_back(posPerimeters);
-            steps.emplace_back(posInfill);
-        } else if (
-               opt_key == "seam_position"
-            || opt_key == "seam_preferred_direction"
-            || opt_key == "seam_preferred_direction_jitter"
-            || opt_key == "support_material_speed"
-            || opt_key == "support_material_interface_speed"
-            || opt_key == "bridge_speed"
-            || opt_key == "external_perimeter_speed"
-            || opt_key == "infill_speed"
-            || opt_key == "perimeter_speed"
-            || opt_key == "small_perimeter_speed"
-            || opt_key == "solid_infill_speed"
-            || opt_key == "top_solid_infill_speed") {
-            invalidated |= m_print->invalidate_step(psGCodeExport);
-        } else if (
-               opt_key == "wipe_into_infill"
-            || opt_key == "wipe_into_objects") {
-            invalidated |= m_print->invalidate_step(psWipeTower);
-            invalidated |= m_print->invalidate_step(psGCodeExport);
-        } else {
+        std::vector<PrintStep> print_steps;
+        if (! config_option_steps(opt_key, steps, print_steps)) {
             // for legacy, if we can't handle this option let's invalidate all steps
             this->invalidate_all_steps();
 			this->reset_layer_height_profile();
             invalidated = true;
+            continue;
         }
+        if (opt_key == "layer_height" || opt_key == "first_layer_height" || opt_key == "raft_layers")
+            this->reset_layer_height_profile();
+        for (PrintStep step : print_steps)
+            invalidated |= m_print->invalidate_step(step);
     }
 
     sort_remove_duplicates(steps);
     for (PrintObjectStep step : steps)
-        invalidated |= this->invalidate_step(step);
+        invalidated |= (z_range == nullptr) ?
+            this->invalidate_step(step) :
+            this->invalidate_layer_range(step, z_range->first, z_range->second);
     return invalidated;
 }
 
 bool PrintObject::invalidate_step(PrintObjectStep step)
 {
 	bool invalidated = Inherited::invalidate_step(step);
+
+    // All the layers will be recomputed by this step, the depending steps clear their ranges below.
+    m_invalid_layer_ranges[step].clear();
+    if (step == posSlice)
+        for (PrintObjectStep s : { posPerimeters, posPrepareInfill, posInfill })
+            m_invalid_layer_ranges[s].clear();
     
     // propagate to dependent steps
     if (step == posPerimeters) {
@@ -578,11 +688,80 @@ bool PrintObject::invalidate_step(PrintObjectStep step)
     return invalidated;
 }
 
+bool PrintObject::invalidate_layer_range(PrintObjectStep step, coordf_t min_z, coordf_t max_z)
+{
+    // Only the perimeters and the infill are generated layer by layer independently. The posPrepareInfill step
+    // is always recomputed for the whole object, it just passes the range to posInfill.
+    // If the step has already been invalidated for all the layers, keep it that way.
+    if ((step != posPerimeters && step != posPrepareInfill && step != posInfill) ||
+        (! this->is_step_done_unguarded(step) && m_invalid_layer_ranges[step].empty()))
+        return this->invalidate_step(step);
+
+    m_invalid_layer_ranges[step].emplace_back(min_z, max_z);
+    bool invalidated = Inherited::invalidate_step(step);
+
+    // propagate to dependent steps
+    if (step == posPerimeters) {
+        invalidated |= this->invalidate_layer_range(posPrepareInfill, min_z, max_z);
+        invalidated |= m_print->invalidate_steps({ psSkirt, psBrim });
+    } else if (step == posPrepareInfill) {
+        invalidated |= this->invalidate_layer_range(posInfill, min_z, max_z);
+    } else if (step == posInfill)
+        invalidated |= m_print->invalidate_steps({ psSkirt, psBrim });
+
+    invalidated |= m_print->invalidate_step(psWipeTower);
+    invalidated |= m_print->invalidate_step(psGCodeExport);
+    return invalidated;
+}
+
 bool PrintObject::invalidate_all_steps()
 {
+    for (std::vector<t_layer_height_range> &ranges : m_invalid_layer_ranges)
+        ranges.clear();
     return Inherited::invalidate_all_steps() | m_print->invalidate_all_steps();
 }
 
+std::vector<size_t> PrintObject::invalid_layers(PrintObjectStep step, size_t margin) const
+{
+    std::vector<t_layer_height_range> ranges;
+    {
+        tbb::mutex::scoped_lock lock(PrintObjectBase::state_mutex(m_print));
+        ranges = m_invalid_layer_ranges[step];
+    }
+
+    std::vector<size_t> out;
+    if (ranges.empty()) {
+        out.reserve(m_layers.size());
+        for (size_t idx_layer = 0; idx_layer < m_layers.size(); ++ idx_layer)
+            out.emplace_back(idx_layer);
+        return out;
+    }
+
+    std::vector<char> invalid(m_layers.size(), false);
+    for (size_t idx_layer = 0; idx_layer < m_layers.size(); ++ idx_layer) {
+        const Layer *layer = m_layers[idx_layer];
+        coordf_t lo = layer->slice_z - 0.5 * layer->height;
+        coordf_t hi = layer->slice_z + 0.5 * layer->height;
+        for (const t_layer_height_range &range : ranges)
+            if (lo <= range.second && hi >= range.first) {
+                size_t begin = (idx_layer > margin) ? idx_layer - margin : 0;
+                size_t end   = std::min(idx_layer + margin + 1, m_layers.size());
+                std::fill(invalid.begin() + begin, invalid.begin() + end, true);
+                break;
+            }
+    }
+    for (size_t idx_layer = 0; idx_layer < m_layers.size(); ++ idx_layer)
+        if (invalid[idx_layer])
+            out.emplace_back(idx_layer);
+    return out;
+}
+
+void PrintObject::clear_invalid_layer_ranges(PrintObjectStep step)
+{
+    tbb::mutex::scoped_lock lock(PrintObjectBase::state_mutex(m_print));
+    m_invalid_layer_ranges[step].clear();
+}
+
 bool PrintObject::has_support_material() const
 {
     return m_config.support_material
@@ -1219,111 +1398,139 @@ void PrintObject::bridge_over_infill()
             -1,     // custom width, not relevant for bridge flow
             *this
         );
-        
-		for (LayerPtrs::iterator layer_it = m_layers.begin(); layer_it != m_layers.end(); ++ layer_it) {
+
+        // The bridges of a layer are detected over the stInternal surfaces of the layers below, which are not modified here.
+        // Still the fill surfaces of a layer must not be modified while the layers above read them,
+        // therefore the new surfaces are calculated for all layers first and then assigned in a second pass.
+        struct BridgedSurfaces {
+            bool        modified = false;
+            ExPolygons  to_bridge;
+            ExPolygons  not_to_bridge;
+        };
+        std::vector<BridgedSurfaces> bridged_surfaces(m_layers.size());
+
+        BOOST_LOG_TRIVIAL(debug) << "Bridge over infill for region " << region_id << " in parallel - start";
+        tbb::parallel_for(
             // skip first layer
-			if (layer_it == m_layers.begin())
-                continue;
-            
-            Layer* layer        = *layer_it;
-            LayerRegion* layerm = layer->m_regions[region_id];
+            tbb::blocked_range<size_t>(1, std::max<size_t>(1, m_layers.size())),
+            [this, region_id, &bridge_flow, &bridged_surfaces](const tbb::blocked_range<size_t>& range) {
+                for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
+                    m_print->throw_if_canceled();
+                    const Layer       *layer  = m_layers[layer_idx];
+                    LayerRegion       *layerm = layer->m_regions[region_id];
             
-            // extract the stInternalSolid surfaces that might be transformed into bridges
-            Polygons internal_solid;
-            layerm->fill_surfaces.filter_by_type(stInternalSolid, &internal_solid);
+                    // extract the stInternalSolid surfaces that might be transformed into bridges
+                    Polygons internal_solid;
+                    layerm->fill_surfaces.filter_by_type(stInternalSolid, &internal_solid);
             
-            // check whether the lower area is deep enough for absorbing the extra flow
-            // (for obvious physical reasons but also for preventing the bridge extrudates
-            // from overflowing in 3D preview)
-            ExPolygons to_bridge;
-            {
-                Polygons to_bridge_pp = internal_solid;
+                    // check whether the lower area is deep enough for absorbing the extra flow
+                    // (for obvious physical reasons but also for preventing the bridge extrudates
+                    // from overflowing in 3D preview)
+                    ExPolygons to_bridge;
+                    {
+                        Polygons to_bridge_pp = internal_solid;
                 
-                // iterate through lower layers spanned by bridge_flow
-                double bottom_z = layer->print_z - bridge_flow.height;
-                for (int i = int(layer_it - m_layers.begin()) - 1; i >= 0; --i) {
-                    const Layer* lower_layer = m_layers[i];
+                        // iterate through lower layers spanned by bridge_flow
+                        double bottom_z = layer->print_z - bridge_flow.height;
+                        for (int i = int(layer_idx) - 1; i >= 0; --i) {
+                            const Layer* lower_layer = m_layers[i];
                     
-                    // stop iterating if layer is lower than bottom_z
-                    if (lower_layer->print_z < bottom_z) break;
+                            // stop iterating if layer is lower than bottom_z
+                            if (lower_layer->print_z < bottom_z) break;
                     
-                    // iterate through regions and collect internal surfaces
-                    Polygons lower_internal;
-                    for (LayerRegion *lower_layerm : lower_layer->m_regions)
-                        lower_layerm->fill_surfaces.filter_by_type(stInternal, &lower_internal);
+                            // iterate through regions and collect internal surfaces
+                            Polygons lower_internal;
+                            for (LayerRegion *lower_layerm : lower_layer->m_regions)
+                                lower_layerm->fill_surfaces.filter_by_type(stInternal, &lower_internal);
                     
-                    // intersect such lower internal surfaces with the candidate solid surfaces
-                    to_bridge_pp = intersection(to_bridge_pp, lower_internal);
-                }
+                            // intersect such lower internal surfaces with the candidate solid surfaces
+                            to_bridge_pp = intersection(to_bridge_pp, lower_internal);
+                        }
                 
-                // there's no point in bridging too thin/short regions
-                //FIXME Vojtech: The offset2 function is not a geometric offset, 
-                // therefore it may create 1) gaps, and 2) sharp corners, which are outside the original contour.
-                // The gaps will be filled by a separate region, which makes the infill less stable and it takes longer.
-                {
-                    float min_width = float(bridge_flow.scaled_width()) * 3.f;
-                    to_bridge_pp = offset2(to_bridge_pp, -min_width, +min_width);
-                }
+                        // there's no point in bridging too thin/short regions
+                        //FIXME Vojtech: The offset2 function is not a geometric offset, 
+                        // therefore it may create 1) gaps, and 2) sharp corners, which are outside the original contour.
+                        // The gaps will be filled by a separate region, which makes the infill less stable and it takes longer.
+                        {
+                            float min_width = float(bridge_flow.scaled_width()) * 3.f;
+                            to_bridge_pp = offset2(to_bridge_pp, -min_width, +min_width);
+                        }
                 
-                if (to_bridge_pp.empty()) continue;
+                        if (to_bridge_pp.empty()) continue;
                 
-                // convert into ExPolygons
-                to_bridge = union_ex(to_bridge_pp);
-            }
+                        // convert into ExPolygons
+                        to_bridge = union_ex(to_bridge_pp);
+                    }
             
-            #ifdef SLIC3R_DEBUG
-            printf("Bridging " PRINTF_ZU " internal areas at layer " PRINTF_ZU "\n", to_bridge.size(), layer->id());
-            #endif
+                    #ifdef SLIC3R_DEBUG
+                    printf("Bridging " PRINTF_ZU " internal areas at layer " PRINTF_ZU "\n", to_bridge.size(), layer->id());
+                    #endif
             
-            // compute the remaning internal solid surfaces as difference
-            ExPolygons not_to_bridge = diff_ex(internal_solid, to_polygons(to_bridge), true);
-            to_bridge = intersection_ex(to_polygons(to_bridge), internal_solid, true);
-            // build the new collection of fill_surfaces
-            layerm->fill_surfaces.remove_type(stInternalSolid);
-            for (ExPolygon &ex : to_bridge)
-                layerm->fill_surfaces.surfaces.push_back(Surface(stInternalBridge, ex));
-            for (ExPolygon &ex : not_to_bridge)
-                layerm->fill_surfaces.surfaces.push_back(Surface(stInternalSolid, ex));            
-            /*
-            # exclude infill from the layers below if needed
-            # see discussion at https://github.com/alexrj/Slic3r/issues/240
-            # Update: do not exclude any infill. Sparse infill is able to absorb the excess material.
-            if (0) {
-                my $excess = $layerm->extruders->{infill}->bridge_flow->width - $layerm->height;
-                for (my $i = $layer_id-1; $excess >= $self->get_layer($i)->height; $i--) {
-                    Slic3r::debugf "  skipping infill below those areas at layer %d\n", $i;
-                    foreach my $lower_layerm (@{$self->get_layer($i)->regions}) {
-                        my @new_surfaces = ();
-                        # subtract the area from all types of surfaces
-                        foreach my $group (@{$lower_layerm->fill_surfaces->group}) {
-                            push @new_surfaces, map $group->[0]->clone(expolygon => $_),
-                                @{diff_ex(
-                                    [ map $_->p, @$group ],
-                                    [ map @$_, @$to_bridge ],
-                                )};
-                            push @new_surfaces, map Slic3r::Surface->new(
-                                expolygon       => $_,
-                                surface_type    => S_TYPE_INTERNALVOID,
-                            ), @{intersection_ex(
-                                [ map $_->p, @$group ],
-                                [ map @$_, @$to_bridge ],
-                            )};
+                    // compute the remaning internal solid surfaces as difference
+                    BridgedSurfaces &out = bridged_surfaces[layer_idx];
+                    out.modified      = true;
+                    out.not_to_bridge = diff_ex(internal_solid, to_polygons(to_bridge), true);
+                    out.to_bridge     = intersection_ex(to_polygons(to_bridge), internal_solid, true);
+                }
+            });
+        m_print->throw_if_canceled();
+
+        tbb::parallel_for(
+            tbb::blocked_range<size_t>(0, m_layers.size()),
+            [this, region_id, &bridged_surfaces](const tbb::blocked_range<size_t>& range) {
+                for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
+                    BridgedSurfaces &bridged = bridged_surfaces[layer_idx];
+                    if (! bridged.modified)
+                        continue;
+                    LayerRegion *layerm = m_layers[layer_idx]->m_regions[region_id];
+                    // build the new collection of fill_surfaces
+                    layerm->fill_surfaces.remove_type(stInternalSolid);
+                    for (ExPolygon &ex : bridged.to_bridge)
+                        layerm->fill_surfaces.surfaces.push_back(Surface(stInternalBridge, ex));
+                    for (ExPolygon &ex : bridged.not_to_bridge)
+                        layerm->fill_surfaces.surfaces.push_back(Surface(stInternalSolid, ex));
+                    /*
+                    # exclude infill from the layers below if needed
+                    # see discussion at https://github.com/alexrj/Slic3r/issues/240
+                    # Update: do not exclude any infill. Sparse infill is able to absorb the excess material.
+                    if (0) {
+                        my $excess = $layerm->extruders->{infill}->bridge_flow->width - $layerm->height;
+                        for (my $i = $layer_id-1; $excess >= $self->get_layer($i)->height; $i--) {
+                            Slic3r::debugf "  skipping infill below those areas at layer %d\n", $i;
+                            foreach my $lower_layerm (@{$self->get_layer($i)->regions}) {
+                                my @new_surfaces = ();
+                                # subtract the area from all types of surfaces
+                                foreach my $group (@{$lower_layerm->fill_surfaces->group}) {
+                                    push @new_surfaces, map $group->[0]->clone(expolygon => $_),
+                                        @{diff_ex(
+                                            [ map $_->p, @$group ],
+                                            [ map @$_, @$to_bridge ],
+                                        )};
+                                    push @new_surfaces, map Slic3r::Surface->new(
+                                        expolygon       => $_,
+                                        surface_type    => S_TYPE_INTERNALVOID,
+                                    ), @{intersection_ex(
+                                        [ map $_->p, @$group ],
+                                        [ map @$_, @$to_bridge ],
+                                    )};
+                                }
+                                $lower_layerm->fill_surfaces->clear;
+                                $lower_layerm->fill_surfaces->append($_) for @new_surfaces;
+                            }
+                    
+                            $excess -= $self->get_layer($i)->height;
                         }
-                        $lower_layerm->fill_surfaces->clear;
-                        $lower_layerm->fill_surfaces->append($_) for @new_surfaces;
                     }
-                    
-                    $excess -= $self->get_layer($i)->height;
-                }
-            }
-            */
+                    */
 
 #ifdef SLIC3R_DEBUG_SLICE_PROCESSING
-            layerm->export_region_slices_to_svg_debug("7_bridge_over_infill");
-            layerm->export_region_fill_surfaces_to_svg_debug("7_bridge_over_infill");
+                    layerm->export_region_slices_to_svg_debug("7_bridge_over_infill");
+                    layerm->export_region_fill_surfaces_to_svg_debug("7_bridge_over_infill");
 #endif /* SLIC3R_DEBUG_SLICE_PROCESSING */
-            m_print->throw_if_canceled();
-        }
+                }
+            });
+        m_print->throw_if_canceled();
+        BOOST_LOG_TRIVIAL(debug) << "Bridge over infill for region " << region_id << " in parallel - end";
     }
 }
 
@@ -1425,6 +1632,39 @@ void PrintObject::_slice()
             prev = layer;
         }
     }
+
+    // 2) Try to load the slices from the persistent slice cache.
+    const SliceCache &slice_cache = m_print->m_slice_cache;
+    uint64_t          slice_cache_key = slice_cache.empty() ? 0 : this->slice_cache_key();
+    {
+        SliceCache::Slices cached;
+        if (! slice_cache.empty() && slice_cache.load(slice_cache_key, cached) && cached.size() <= m_layers.size() &&
+            (cached.empty() || cached.front().size() == this->region_volumes.size())) {
+            BOOST_LOG_TRIVIAL(info) << "Slicing objects - loaded from the slice cache";
+            // Top empty layers were removed before the slices were stored.
+            while (m_layers.size() > cached.size()) {
+                delete m_layers.back();
+                m_layers.pop_back();
+            }
+            if (! m_layers.empty())
+                m_layers.back()->upper_layer = nullptr;
+            BOOST_LOG_TRIVIAL(debug) << "Slicing objects - make_slices from the slice cache in parallel - begin";
+            tbb::parallel_for(
+                tbb::blocked_range<size_t>(0, m_layers.size()),
+                [this, &cached](const tbb::blocked_range<size_t>& range) {
+                    for (size_t layer_id = range.begin(); layer_id < range.end(); ++ layer_id) {
+                        m_print->throw_if_canceled();
+                        Layer *layer = m_layers[layer_id];
+                        for (size_t region_id = 0; region_id < layer->m_regions.size(); ++ region_id)
+                            layer->m_regions[region_id]->slices.set(std::move(cached[layer_id][region_id]), stInternal);
+                        layer->make_slices();
+                    }
+                });
+            m_print->throw_if_canceled();
+            BOOST_LOG_TRIVIAL(debug) << "Slicing objects - make_slices from the slice cache in parallel - end";
+            return;
+        }
+    }
     
     // Slice all non-modifier volumes.
     for (size_t region_id = 0; region_id < this->region_volumes.size(); ++ region_id) {
@@ -1527,6 +1767,56 @@ end:
         });
     m_print->throw_if_canceled();
     BOOST_LOG_TRIVIAL(debug) << "Slicing objects - make_slices in parallel - end";
+
+    if (! slice_cache.empty()) {
+        SliceCache::Slices slices(m_layers.size());
+        for (size_t layer_id = 0; layer_id < m_layers.size(); ++ layer_id)
+            for (const LayerRegion *layerm : m_layers[layer_id]->m_regions)
+                slices[layer_id].emplace_back(to_expolygons(layerm->slices.surfaces));
+        slice_cache.store(slice_cache_key, slices);
+    }
+}
+
+// The slices are cached for the sliced meshes and their transformations, for the layer heights
+// and for the configuration options, which invalidate posSlice.
+uint64_t PrintObject::slice_cache_key() const
+{
+    SliceCache::Key key;
+    key.append(m_layers.size());
+    for (const Layer *layer : m_layers) {
+        key.append(layer->id());
+        key.append(layer->height);
+        key.append(layer->print_z);
+        key.append(layer->slice_z);
+    }
+    const Transform3d shift(Eigen::Translation3d(- unscale<double>(m_copies_shift(0)), - unscale<double>(m_copies_shift(1)), 0.));
+    key.append(this->region_volumes.size());
+    for (const std::vector<int> &volume_ids : this->region_volumes) {
+        key.append(volume_ids.size());
+        for (int volume_id : volume_ids) {
+            const ModelVolume *volume = this->model_object()->volumes[volume_id];
+            key.append(int(volume->type()));
+#if ENABLE_MODELVOLUME_TRANSFORM
+            Transform3d trafo = shift * m_trafo * volume->get_matrix();
+#else
+            Transform3d trafo = shift * m_trafo;
+#endif // ENABLE_MODELVOLUME_TRANSFORM
+            key.append(trafo.data(), sizeof(double) * 16);
+            const stl_file &stl = volume->mesh().stl;
+            key.append(stl.stats.number_of_facets);
+            for (uint32_t i = 0; i < stl.stats.number_of_facets; ++ i)
+                key.append(stl.facet_start[i].vertex, sizeof(stl_facet::vertex));
+        }
+    }
+    for (const t_config_option_key &opt_key : m_config.keys()) {
+        std::vector<PrintObjectStep> steps;
+        std::vector<PrintStep>       print_steps;
+        if (! config_option_steps(opt_key, steps, print_steps) || std::find(steps.begin(), steps.end(), posSlice) != steps.end()) {
+            key.append(opt_key);
+            key.append(m_config.serialize(opt_key));
+        }
+    }
+    return key.value();
 }
 
 std::vector<ExPolygons> PrintObject::_slice_region(size_t region_id, const std::vector<float> &z, bool modifier)
@@ -1568,35 +1858,139 @@ std::vector<ExPolygons> PrintObject::slice_support_blockers() const
     return this->_slice_volumes(zs, volumes);
 }
 
+VolumeSlicesCache::SlicesConstPtr VolumeSlicesCache::find(const ModelVolume &volume, const Transform3d &trafo, const std::vector<float> &z) const
+{
+    tbb::mutex::scoped_lock lock(m_mutex);
+    for (Entry &entry : m_entries)
+        if (entry.mesh.lock().get() == &volume.mesh() && entry.trafo.matrix() == trafo.matrix() && entry.z == z) {
+            entry.last_used = ++ m_timestamp;
+            return entry.slices;
+        }
+    return SlicesConstPtr();
+}
+
+void VolumeSlicesCache::insert(const ModelVolume &volume, const Transform3d &trafo, const std::vector<float> &z, SlicesConstPtr slices)
+{
+    tbb::mutex::scoped_lock lock(m_mutex);
+    Entry entry;
+    entry.mesh      = volume.mesh_ptr();
+    entry.trafo     = trafo;
+    entry.z         = z;
+    entry.slices    = std::move(slices);
+    entry.last_used = ++ m_timestamp;
+    m_entries.emplace_back(std::move(entry));
+}
+
+void VolumeSlicesCache::retain(const std::vector<PrintObject*> &print_objects)
+{
+    // Number of volumes of the PrintObjects referencing a mesh.
+    std::map<const TriangleMesh*, size_t> mesh_refs;
+    for (const PrintObject *print_object : print_objects)
+        for (const ModelVolume *volume : print_object->model_object()->volumes)
+            ++ mesh_refs[&volume->mesh()];
+    tbb::mutex::scoped_lock lock(m_mutex);
+    // Most recently used entries first.
+    std::sort(m_entries.begin(), m_entries.end(), [](const Entry &l, const Entry &r) { return l.last_used > r.last_used; });
+    m_entries.erase(std::remove_if(m_entries.begin(), m_entries.end(), [&mesh_refs](const Entry &entry) {
+        // An expired mesh is not referenced by any volume.
+        auto it = mesh_refs.find(entry.mesh.lock().get());
+        if (it == mesh_refs.end() || it->second == 0)
+            return true;
+        -- it->second;
+        return false;
+    }), m_entries.end());
+}
+
+void VolumeSlicesCache::clear()
+{
+    tbb::mutex::scoped_lock lock(m_mutex);
+    m_entries.clear();
+}
+
+// Slice each volume separately (in parallel) and merge the slices of multiple volumes by a Boolean union.
+// The slices of the individual volumes are cached by the Print, so that adding, removing or modifying
+// a volume does not trigger re-slicing of the other volumes of the ModelObject.
 std::vector<ExPolygons> PrintObject::_slice_volumes(const std::vector<float> &z, const std::vector<const ModelVolume*> &volumes) const
 {
     std::vector<ExPolygons> layers;
-    if (! volumes.empty()) {
-        // Compose mesh.
-        //FIXME better to perform slicing over each volume separately and then to use a Boolean operation to merge them.
-        TriangleMesh mesh;
-        for (const ModelVolume *v : volumes)
+    if (volumes.empty())
+        return layers;
+
+    const Print *print = this->print();
+    auto callback = TriangleMeshSlicer::throw_on_cancel_callback_type([print](){print->throw_if_canceled();});
+    // Transformation applied to the volume mesh: volume transformation, object instance transformation, XY shift.
+    const Transform3d shift(Eigen::Translation3d(- unscale<double>(m_copies_shift(0)), - unscale<double>(m_copies_shift(1)), 0.));
+    std::vector<VolumeSlicesCache::SlicesConstPtr> volume_slices(volumes.size());
+    std::vector<Transform3d> volume_trafos(volumes.size());
+    std::vector<size_t> volumes_to_slice;
+    for (size_t idx_volume = 0; idx_volume < volumes.size(); ++ idx_volume) {
+        const ModelVolume *v = volumes[idx_volume];
 #if ENABLE_MODELVOLUME_TRANSFORM
-        {
-            TriangleMesh vol_mesh(v->mesh);
-            vol_mesh.transform(v->get_matrix());
-            mesh.merge(vol_mesh);
-        }
+        volume_trafos[idx_volume] = shift * m_trafo * v->get_matrix();
 #else
-        mesh.merge(v->mesh);
+        volume_trafos[idx_volume] = shift * m_trafo;
 #endif // ENABLE_MODELVOLUME_TRANSFORM
-        if (mesh.stl.stats.number_of_facets > 0) {
-            mesh.transform(m_trafo);
-            // apply XY shift
-            mesh.translate(- unscale<float>(m_copies_shift(0)), - unscale<float>(m_copies_shift(1)), 0);
-            // perform actual slicing
-            TriangleMeshSlicer mslicer;
-            const Print *print = this->print();
-            auto callback = TriangleMeshSlicer::throw_on_cancel_callback_type([print](){print->throw_if_canceled();});
-            mslicer.init(&mesh, callback);
-            mslicer.slice(z, &layers, callback);
-            m_print->throw_if_canceled();
-        }
+        if (v->mesh().stl.stats.number_of_facets == 0)
+            continue;
+        volume_slices[idx_volume] = m_print->m_volume_slices_cache.find(*v, volume_trafos[idx_volume], z);
+        if (! volume_slices[idx_volume])
+            volumes_to_slice.emplace_back(idx_volume);
+    }
+
+    BOOST_LOG_TRIVIAL(debug) << "Slicing volumes - " << volumes_to_slice.size() << " of " << volumes.size() << " volumes not cached, slicing in parallel - start";
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, volumes_to_slice.size(), 1),
+        [this, &z, &volumes, &volumes_to_slice, &volume_slices, &volume_trafos, &callback](const tbb::blocked_range<size_t>& range) {
+            for (size_t i = range.begin(); i < range.end(); ++ i) {
+                size_t             idx_volume = volumes_to_slice[i];
+                const ModelVolume *v          = volumes[idx_volume];
+                TriangleMesh mesh(v->mesh());
+                mesh.transform(volume_trafos[idx_volume]);
+                // perform actual slicing
+                TriangleMeshSlicer mslicer;
+                mslicer.init(&mesh, callback);
+                std::shared_ptr<std::vector<ExPolygons>> slices = std::make_shared<std::vector<ExPolygons>>();
+                mslicer.slice(z, slices.get(), callback);
+                m_print->throw_if_canceled();
+                m_print->m_volume_slices_cache.insert(*v, volume_trafos[idx_volume], z, slices);
+                volume_slices[idx_volume] = std::move(slices);
+            }
+        });
+    m_print->throw_if_canceled();
+    BOOST_LOG_TRIVIAL(debug) << "Slicing volumes in parallel - end";
+
+    // Remove volumes with empty meshes.
+    volume_slices.erase(std::remove(volume_slices.begin(), volume_slices.end(), VolumeSlicesCache::SlicesConstPtr()), volume_slices.end());
+    if (volume_slices.size() == 1) {
+        layers = *volume_slices.front();
+    } else if (volume_slices.size() > 1) {
+        BOOST_LOG_TRIVIAL(debug) << "Slicing volumes - merging volumes in parallel - start";
+        layers.assign(z.size(), ExPolygons());
+        tbb::parallel_for(
+            tbb::blocked_range<size_t>(0, z.size()),
+            [this, &volume_slices, &layers](const tbb::blocked_range<size_t>& range) {
+                for (size_t layer_id = range.begin(); layer_id < range.end(); ++ layer_id) {
+                    m_print->throw_if_canceled();
+                    Polygons polygons;
+                    size_t   num_volumes = 0;
+                    for (const VolumeSlicesCache::SlicesConstPtr &slices : volume_slices)
+                        if (! (*slices)[layer_id].empty()) {
+                            polygons_append(polygons, to_polygons((*slices)[layer_id]));
+                            ++ num_volumes;
+                        }
+                    if (num_volumes == 1) {
+                        // Only a single volume intersects this layer, no need for a Boolean operation.
+                        for (const VolumeSlicesCache::SlicesConstPtr &slices : volume_slices)
+                            if (! (*slices)[layer_id].empty())
+                                layers[layer_id] = (*slices)[layer_id];
+                    } else if (num_volumes > 1)
+                        // Close the gaps between the touching volumes with the same safety offset, which
+                        // TriangleMeshSlicer::make_expolygons() applies to the loops of a single mesh.
+                        layers[layer_id] = offset2_ex(union_(polygons), float(scale_(0.0001)), -float(scale_(0.0001)));
+                }
+            });
+        m_print->throw_if_canceled();
+        BOOST_LOG_TRIVIAL(debug) << "Slicing volumes - merging volumes in parallel - end";
     }
     return layers;
 }
@@ -1825,73 +2219,267 @@ void PrintObject::clip_fill_surfaces()
     // We only want infill under ceilings; this is almost like an
     // internal support material.
     // Proceed top-down, skipping the bottom layer.
-    Polygons upper_internal;
-    for (int layer_id = int(m_layers.size()) - 1; layer_id > 0; -- layer_id) {
-        Layer *layer       = m_layers[layer_id];
-        Layer *lower_layer = m_layers[layer_id - 1];
-        // Detect things that we need to support.
-        // Cummulative slices.
-        Polygons slices;
-        for (const ExPolygon &expoly : layer->slices.expolygons)
-            polygons_append(slices, to_polygons(expoly));
-        // Cummulative fill surfaces.
-        Polygons fill_surfaces;
-        // Solid surfaces to be supported.
-        Polygons overhangs;
-        for (const LayerRegion *layerm : layer->m_regions)
-            for (const Surface &surface : layerm->fill_surfaces.surfaces) {
-                Polygons polygons = to_polygons(surface.expolygon);
-                if (surface.is_solid())
-                    polygons_append(overhangs, polygons);
-                polygons_append(fill_surfaces, std::move(polygons));
+    // Only the areas to be supported are carried from a layer to the layer below, so the areas each layer needs to support
+    // and the internal surfaces of the layer below are collected in parallel, then the supported areas are propagated top-down
+    // and finally applied to the layers in parallel again. The perimeters of a layer are thus calculated from its fill surfaces
+    // before their internal surfaces are split into the internal and internal void surfaces, covering the same area.
+    BOOST_LOG_TRIVIAL(debug) << "Clipping fill surfaces in parallel - start";
+    // Areas of a layer to be supported by the layer below.
+    std::vector<Polygons> overhangs(m_layers.size());
+    // Internal and internal void surfaces of the layer below.
+    std::vector<Polygons> lower_layer_internal_surfaces(m_layers.size());
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(1, std::max<size_t>(1, m_layers.size())),
+        [this, &overhangs, &lower_layer_internal_surfaces](const tbb::blocked_range<size_t>& range) {
+            for (size_t layer_id = range.begin(); layer_id < range.end(); ++ layer_id) {
+                m_print->throw_if_canceled();
+                const Layer *layer       = m_layers[layer_id];
+                const Layer *lower_layer = m_layers[layer_id - 1];
+                // Detect things that we need to support.
+                // Cummulative slices.
+                Polygons slices;
+                for (const ExPolygon &expoly : layer->slices.expolygons)
+                    polygons_append(slices, to_polygons(expoly));
+                // Cummulative fill surfaces.
+                Polygons fill_surfaces;
+                // Solid surfaces to be supported.
+                Polygons &layer_overhangs = overhangs[layer_id];
+                for (const LayerRegion *layerm : layer->m_regions)
+                    for (const Surface &surface : layerm->fill_surfaces.surfaces) {
+                        Polygons polygons = to_polygons(surface.expolygon);
+                        if (surface.is_solid())
+                            polygons_append(layer_overhangs, polygons);
+                        polygons_append(fill_surfaces, std::move(polygons));
+                    }
+                Polygons lower_layer_fill_surfaces;
+                for (const LayerRegion *layerm : lower_layer->m_regions)
+                    for (const Surface &surface : layerm->fill_surfaces.surfaces) {
+                        Polygons polygons = to_polygons(surface.expolygon);
+                        if (surface.surface_type == stInternal || surface.surface_type == stInternalVoid)
+                            polygons_append(lower_layer_internal_surfaces[layer_id], polygons);
+                        polygons_append(lower_layer_fill_surfaces, std::move(polygons));
+                    }
+                // We also need to support perimeters when there's at least one full unsupported loop
+                {
+                    // Get perimeters area as the difference between slices and fill_surfaces
+                    // Only consider the area that is not supported by lower perimeters
+                    Polygons perimeters = intersection(diff(slices, fill_surfaces), lower_layer_fill_surfaces);
+                    // Only consider perimeter areas that are at least one extrusion width thick.
+                    //FIXME Offset2 eats out from both sides, while the perimeters are create outside in.
+                    //Should the pw not be half of the current value?
+                    float pw = FLT_MAX;
+                    for (const LayerRegion *layerm : layer->m_regions)
+                        pw = std::min<float>(pw, layerm->flow(frPerimeter).scaled_width());
+                    // Append such thick perimeters to the areas that need support
+                    polygons_append(layer_overhangs, offset2(perimeters, -pw, +pw));
+                }
             }
-        Polygons lower_layer_fill_surfaces;
-        Polygons lower_layer_internal_surfaces;
-        for (const LayerRegion *layerm : lower_layer->m_regions)
-            for (const Surface &surface : layerm->fill_surfaces.surfaces) {
-                Polygons polygons = to_polygons(surface.expolygon);
-                if (surface.surface_type == stInternal || surface.surface_type == stInternalVoid)
-                    polygons_append(lower_layer_internal_surfaces, polygons);
-                polygons_append(lower_layer_fill_surfaces, std::move(polygons));
+        });
+    m_print->throw_if_canceled();
+
+    // Find new internal infill, top-down.
+    // upper_internal[layer_id] is the internal infill of layer_id needed to support the layers above.
+    std::vector<Polygons> upper_internal(m_layers.size());
+    for (int layer_id = int(m_layers.size()) - 1; layer_id > 0; -- layer_id) {
+        m_print->throw_if_canceled();
+        polygons_append(overhangs[layer_id], upper_internal[layer_id]);
+        upper_internal[layer_id - 1] = intersection(overhangs[layer_id], lower_layer_internal_surfaces[layer_id]);
+        overhangs[layer_id].clear();
+        lower_layer_internal_surfaces[layer_id].clear();
+    }
+
+    // Apply new internal infill to regions.
+    tbb::parallel_for(
+        // The top layer is not clipped.
+        tbb::blocked_range<size_t>(0, std::max<size_t>(1, m_layers.size()) - 1),
+        [this, &upper_internal](const tbb::blocked_range<size_t>& range) {
+            for (size_t layer_id = range.begin(); layer_id < range.end(); ++ layer_id) {
+                m_print->throw_if_canceled();
+                for (LayerRegion *layerm : m_layers[layer_id]->m_regions) {
+                    if (layerm->region()->config().fill_density.value == 0)
+                        continue;
+                    SurfaceType internal_surface_types[] = { stInternal, stInternalVoid };
+                    Polygons internal;
+                    for (Surface &surface : layerm->fill_surfaces.surfaces)
+                        if (surface.surface_type == stInternal || surface.surface_type == stInternalVoid)
+                            polygons_append(internal, std::move(surface.expolygon));
+                    layerm->fill_surfaces.remove_types(internal_surface_types, 2);
+                    layerm->fill_surfaces.append(intersection_ex(internal, upper_internal[layer_id], true), stInternal);
+                    layerm->fill_surfaces.append(diff_ex        (internal, upper_internal[layer_id], true), stInternalVoid);
+                    // If there are voids it means that our internal infill is not adjacent to
+                    // perimeters. In this case it would be nice to add a loop around infill to
+                    // make it more robust and nicer. TODO.
+#ifdef SLIC3R_DEBUG_SLICE_PROCESSING
+                    layerm->export_region_fill_surfaces_to_svg_debug("6_clip_fill_surfaces");
+#endif
+                }
             }
-        // We also need to support perimeters when there's at least one full unsupported loop
-        {
-            // Get perimeters area as the difference between slices and fill_surfaces
-            // Only consider the area that is not supported by lower perimeters
-            Polygons perimeters = intersection(diff(slices, fill_surfaces), lower_layer_fill_surfaces);
-            // Only consider perimeter areas that are at least one extrusion width thick.
-            //FIXME Offset2 eats out from both sides, while the perimeters are create outside in.
-            //Should the pw not be half of the current value?
-            float pw = FLT_MAX;
-            for (const LayerRegion *layerm : layer->m_regions)
-                pw = std::min<float>(pw, layerm->flow(frPerimeter).scaled_width());
-            // Append such thick perimeters to the areas that need support
-            polygons_append(overhangs, offset2(perimeters, -pw, +pw));
+        });
+    m_print->throw_if_canceled();
+    BOOST_LOG_TRIVIAL(debug) << "Clipping fill surfaces in parallel - end";
+}
+
+// Insert a solid internal layer every solid_infill_every_layers. Mark stInternal surfaces as stInternalSolid or stInternalBridge.
+static void insert_solid_infill_layer(LayerRegion *layerm, int layer_idx)
+{
+    const PrintRegionConfig &region_config = layerm->region()->config();
+    if (region_config.solid_infill_every_layers.value > 0 && region_config.fill_density.value > 0 &&
+        (layer_idx % region_config.solid_infill_every_layers) == 0) {
+        SurfaceType type = (region_config.fill_density == 100) ? stInternalSolid : stInternalBridge;
+        for (Surface &surface : layerm->fill_surfaces.surfaces)
+            if (surface.surface_type == stInternal)
+                surface.surface_type = type;
+    }
+}
+
+// Surfaces of a layer region of the given external type, from which a horizontal shell is propagated.
+static Polygons horizontal_shell_solid(const LayerRegion *layerm, SurfaceType type)
+{
+    // Find slices of current type for current layer.
+    // Use slices instead of fill_surfaces, because they also include the perimeter area,
+    // which needs to be propagated in shells; we need to grow slices like we did for
+    // fill_surfaces though. Using both ungrown slices and grown fill_surfaces will
+    // not work in some situations, as there won't be any grown region in the perimeter 
+    // area (this was seen in a model where the top layer had one extra perimeter, thus
+    // its fill_surfaces were thinner than the lower layer's infill), however it's the best
+    // solution so far. Growing the external slices by EXTERNAL_INFILL_MARGIN will put
+    // too much solid infill inside nearly-vertical slopes.
+
+    // Surfaces including the area of perimeters. Everything, that is visible from the top / bottom
+    // (not covered by a layer above / below).
+    // This does not contain the areas covered by perimeters!
+    Polygons solid;
+    for (const Surface &surface : layerm->slices.surfaces)
+        if (surface.surface_type == type)
+            polygons_append(solid, to_polygons(surface.expolygon));
+    // Infill areas (slices without the perimeters).
+    for (const Surface &surface : layerm->fill_surfaces.surfaces)
+        if (surface.surface_type == type)
+            polygons_append(solid, to_polygons(surface.expolygon));
+    return solid;
+}
+
+// Propagate the horizontal shell of an external surface of layerm into a neighbor layer:
+// the lower layer of a TOP surface, or an upper layer of a BOTTOM surface.
+// Returns false if the shell shall not be propagated into the next neighbor layer.
+static bool propagate_horizontal_shell(const LayerRegion *layerm, LayerRegion *neighbor_layerm, Polygons &solid)
+{
+    const PrintRegionConfig &region_config = layerm->region()->config();
+
+    // find intersection between neighbor and current layer's surfaces
+    // intersections have contours and holes
+    // we update $solid so that we limit the next neighbor layer to the areas that were
+    // found on this one - in other words, solid shells on one layer (for a given external surface)
+    // are always a subset of the shells found on the previous shell layer
+    // this approach allows for DWIM in hollow sloping vases, where we want bottom
+    // shells to be generated in the base but not in the walls (where there are many
+    // narrow bottom surfaces): reassigning $solid will consider the 'shadow' of the 
+    // upper perimeter as an obstacle and shell will not be propagated to more upper layers
+    //FIXME How does it work for S_TYPE_INTERNALBRIDGE? This is set for sparse infill. Likely this does not work.
+    Polygons new_internal_solid;
+    {
+        Polygons internal;
+        for (const Surface &surface : neighbor_layerm->fill_surfaces.surfaces)
+            if (surface.surface_type == stInternal || surface.surface_type == stInternalSolid)
+                polygons_append(internal, to_polygons(surface.expolygon));
+        new_internal_solid = intersection(solid, internal, true);
+    }
+    if (new_internal_solid.empty()) {
+        // No internal solid needed on this layer. In order to decide whether to continue
+        // searching on the next neighbor (thus enforcing the configured number of solid
+        // layers, use different strategies according to configured infill density:
+        if (region_config.fill_density.value == 0) {
+            // If user expects the object to be void (for example a hollow sloping vase),
+            // don't continue the search. In this case, we only generate the external solid
+            // shell if the object would otherwise show a hole (gap between perimeters of 
+            // the two layers), and internal solid shells are a subset of the shells found 
+            // on each previous layer.
+            return false;
+        } else {
+            // If we have internal infill, we can generate internal solid shells freely.
+            return true;
         }
-        // Find new internal infill.
-        polygons_append(overhangs, std::move(upper_internal));
-        upper_internal = intersection(overhangs, lower_layer_internal_surfaces);
-        // Apply new internal infill to regions.
-        for (LayerRegion *layerm : lower_layer->m_regions) {
-            if (layerm->region()->config().fill_density.value == 0)
-                continue;
-            SurfaceType internal_surface_types[] = { stInternal, stInternalVoid };
+    }
+    
+    if (region_config.fill_density.value == 0) {
+        // if we're printing a hollow object we discard any solid shell thinner
+        // than a perimeter width, since it's probably just crossing a sloping wall
+        // and it's not wanted in a hollow print even if it would make sense when
+        // obeying the solid shell count option strictly (DWIM!)
+        float margin = float(neighbor_layerm->flow(frExternalPerimeter).scaled_width());
+        Polygons too_narrow = diff(
+            new_internal_solid, 
+            offset2(new_internal_solid, -margin, +margin, jtMiter, 5), 
+            true);
+        // Trim the regularized region by the original region.
+        if (! too_narrow.empty())
+            new_internal_solid = solid = diff(new_internal_solid, too_narrow);
+    }
+
+    // make sure the new internal solid is wide enough, as it might get collapsed
+    // when spacing is added in Fill.pm
+    {
+        //FIXME Vojtech: Disable this and you will be sorry.
+        // https://github.com/prusa3d/Slic3r/issues/26 bottom
+        float margin = 3.f * layerm->flow(frSolidInfill).scaled_width(); // require at least this size
+        // we use a higher miterLimit here to handle areas with acute angles
+        // in those cases, the default miterLimit would cut the corner and we'd
+        // get a triangle in $too_narrow; if we grow it below then the shell
+        // would have a different shape from the external surface and we'd still
+        // have the same angle, so the next shell would be grown even more and so on.
+        Polygons too_narrow = diff(
+            new_internal_solid,
+            offset2(new_internal_solid, -margin, +margin, ClipperLib::jtMiter, 5),
+            true);
+        if (! too_narrow.empty()) {
+            // grow the collapsing parts and add the extra area to  the neighbor layer 
+            // as well as to our original surfaces so that we support this 
+            // additional area in the next shell too
+            // make sure our grown surfaces don't exceed the fill area
             Polygons internal;
-            for (Surface &surface : layerm->fill_surfaces.surfaces)
-                if (surface.surface_type == stInternal || surface.surface_type == stInternalVoid)
-                    polygons_append(internal, std::move(surface.expolygon));
-            layerm->fill_surfaces.remove_types(internal_surface_types, 2);
-            layerm->fill_surfaces.append(intersection_ex(internal, upper_internal, true), stInternal);
-            layerm->fill_surfaces.append(diff_ex        (internal, upper_internal, true), stInternalVoid);
-            // If there are voids it means that our internal infill is not adjacent to
-            // perimeters. In this case it would be nice to add a loop around infill to
-            // make it more robust and nicer. TODO.
-#ifdef SLIC3R_DEBUG_SLICE_PROCESSING
-            layerm->export_region_fill_surfaces_to_svg_debug("6_clip_fill_surfaces");
-#endif
+            for (const Surface &surface : neighbor_layerm->fill_surfaces.surfaces)
+                if (surface.is_internal() && !surface.is_bridge())
+                    polygons_append(internal, to_polygons(surface.expolygon));
+            polygons_append(new_internal_solid, 
+                intersection(
+                    offset(too_narrow, +margin),
+                    // Discard bridges as they are grown for anchoring and we can't
+                    // remove such anchors. (This may happen when a bridge is being 
+                    // anchored onto a wall where little space remains after the bridge
+                    // is grown, and that little space is an internal solid shell so 
+                    // it triggers this too_narrow logic.)
+                    internal));
+            solid = new_internal_solid;
         }
-        m_print->throw_if_canceled();
     }
+    
+    // internal-solid are the union of the existing internal-solid surfaces
+    // and new ones
+    SurfaceCollection backup = std::move(neighbor_layerm->fill_surfaces);
+    polygons_append(new_internal_solid, to_polygons(backup.filter_by_type(stInternalSolid)));
+    ExPolygons internal_solid = union_ex(new_internal_solid, false);
+    // assign new internal-solid surfaces to layer
+    neighbor_layerm->fill_surfaces.set(internal_solid, stInternalSolid);
+    // subtract intersections from layer surfaces to get resulting internal surfaces
+    Polygons polygons_internal = to_polygons(std::move(internal_solid));
+    ExPolygons internal = diff_ex(
+        to_polygons(backup.filter_by_type(stInternal)),
+        polygons_internal,
+        true);
+    // assign resulting internal surfaces to layer
+    neighbor_layerm->fill_surfaces.append(internal, stInternal);
+    polygons_append(polygons_internal, to_polygons(std::move(internal)));
+    // assign top and bottom surfaces to layer
+    SurfaceType surface_types_solid[] = { stTop, stBottom, stBottomBridge };
+    backup.keep_types(surface_types_solid, 3);
+    std::vector<SurfacesPtr> top_bottom_groups;
+    backup.group(&top_bottom_groups);
+    for (SurfacesPtr &group : top_bottom_groups)
+        neighbor_layerm->fill_surfaces.append(
+            diff_ex(to_polygons(group), polygons_internal),
+            // Use an existing surface as a template, it carries the bridge angle etc.
+            *group.front());
+    return true;
 }
 
 void PrintObject::discover_horizontal_shells()
@@ -1899,176 +2487,68 @@ void PrintObject::discover_horizontal_shells()
     BOOST_LOG_TRIVIAL(trace) << "discover_horizontal_shells()";
     
     for (size_t region_id = 0; region_id < this->region_volumes.size(); ++ region_id) {
+        const PrintRegionConfig &region_config = m_print->regions()[region_id]->config();
+
+        // If ensure_vertical_shell_thickness, then the rest has already been performed by discover_vertical_shells().
+        if (region_config.ensure_vertical_shell_thickness.value) {
+            tbb::parallel_for(
+                tbb::blocked_range<size_t>(0, m_layers.size()),
+                [this, region_id](const tbb::blocked_range<size_t>& range) {
+                    for (size_t i = range.begin(); i < range.end(); ++ i) {
+                        m_print->throw_if_canceled();
+                        insert_solid_infill_layer(m_layers[i]->regions()[region_id], int(i));
+                    }
+                });
+            continue;
+        }
+
+        // Propagate the shells of the bottom surfaces upwards. This sweep is serial: the bottom surfaces of a layer
+        // are trimmed by the shells propagated into the layer from below before they are propagated further,
+        // and the solid infill layers are inserted only after the layer received the shells from below.
+        BOOST_LOG_TRIVIAL(debug) << "Discovering horizontal shells for region " << region_id << ", bottom shells - start";
         for (int i = 0; i < int(m_layers.size()); ++ i) {
             m_print->throw_if_canceled();
-            LayerRegion             *layerm = m_layers[i]->regions()[region_id];
-            const PrintRegionConfig &region_config = layerm->region()->config();
-            if (region_config.solid_infill_every_layers.value > 0 && region_config.fill_density.value > 0 &&
-                (i % region_config.solid_infill_every_layers) == 0) {
-                // Insert a solid internal layer. Mark stInternal surfaces as stInternalSolid or stInternalBridge.
-                SurfaceType type = (region_config.fill_density == 100) ? stInternalSolid : stInternalBridge;
-                for (Surface &surface : layerm->fill_surfaces.surfaces)
-                    if (surface.surface_type == stInternal)
-                        surface.surface_type = type;
-            }
-
-            // If ensure_vertical_shell_thickness, then the rest has already been performed by discover_vertical_shells().
-            if (region_config.ensure_vertical_shell_thickness.value)
-                continue;
-            
-            for (int idx_surface_type = 0; idx_surface_type < 3; ++ idx_surface_type) {
+            LayerRegion *layerm = m_layers[i]->regions()[region_id];
+            insert_solid_infill_layer(layerm, i);
+            for (SurfaceType type : { stBottom, stBottomBridge }) {
                 m_print->throw_if_canceled();
-                SurfaceType type = (idx_surface_type == 0) ? stTop : (idx_surface_type == 1) ? stBottom : stBottomBridge;
-                // Find slices of current type for current layer.
-                // Use slices instead of fill_surfaces, because they also include the perimeter area,
-                // which needs to be propagated in shells; we need to grow slices like we did for
-                // fill_surfaces though. Using both ungrown slices and grown fill_surfaces will
-                // not work in some situations, as there won't be any grown region in the perimeter 
-                // area (this was seen in a model where the top layer had one extra perimeter, thus
-                // its fill_surfaces were thinner than the lower layer's infill), however it's the best
-                // solution so far. Growing the external slices by EXTERNAL_INFILL_MARGIN will put
-                // too much solid infill inside nearly-vertical slopes.
-
-                // Surfaces including the area of perimeters. Everything, that is visible from the top / bottom
-                // (not covered by a layer above / below).
-                // This does not contain the areas covered by perimeters!
-                Polygons solid;
-                for (const Surface &surface : layerm->slices.surfaces)
-                    if (surface.surface_type == type)
-                        polygons_append(solid, to_polygons(surface.expolygon));
-                // Infill areas (slices without the perimeters).
-                for (const Surface &surface : layerm->fill_surfaces.surfaces)
-                    if (surface.surface_type == type)
-                        polygons_append(solid, to_polygons(surface.expolygon));
+                Polygons solid = horizontal_shell_solid(layerm, type);
                 if (solid.empty())
                     continue;
 //                Slic3r::debugf "Layer %d has %s surfaces\n", $i, ($type == S_TYPE_TOP) ? 'top' : 'bottom';
-                
-                size_t solid_layers = (type == stTop) ? region_config.top_solid_layers.value : region_config.bottom_solid_layers.value;                
-                for (int n = (type == stTop) ? i-1 : i+1; std::abs(n - i) < solid_layers; (type == stTop) ? -- n : ++ n) {
-                    if (n < 0 || n >= int(m_layers.size()))
-                        continue;
-//                    Slic3r::debugf "  looking for neighbors on layer %d...\n", $n;                  
-                    // Reference to the lower layer of a TOP surface, or an upper layer of a BOTTOM surface.
-                    LayerRegion *neighbor_layerm = m_layers[n]->regions()[region_id];
-                    
-                    // find intersection between neighbor and current layer's surfaces
-                    // intersections have contours and holes
-                    // we update $solid so that we limit the next neighbor layer to the areas that were
-                    // found on this one - in other words, solid shells on one layer (for a given external surface)
-                    // are always a subset of the shells found on the previous shell layer
-                    // this approach allows for DWIM in hollow sloping vases, where we want bottom
-                    // shells to be generated in the base but not in the walls (where there are many
-                    // narrow bottom surfaces): reassigning $solid will consider the 'shadow' of the 
-                    // upper perimeter as an obstacle and shell will not be propagated to more upper layers
-                    //FIXME How does it work for S_TYPE_INTERNALBRIDGE? This is set for sparse infill. Likely this does not work.
-                    Polygons new_internal_solid;
-                    {
-                        Polygons internal;
-                        for (const Surface &surface : neighbor_layerm->fill_surfaces.surfaces)
-                            if (surface.surface_type == stInternal || surface.surface_type == stInternalSolid)
-                                polygons_append(internal, to_polygons(surface.expolygon));
-                        new_internal_solid = intersection(solid, internal, true);
-                    }
-                    if (new_internal_solid.empty()) {
-                        // No internal solid needed on this layer. In order to decide whether to continue
-                        // searching on the next neighbor (thus enforcing the configured number of solid
-                        // layers, use different strategies according to configured infill density:
-                        if (region_config.fill_density.value == 0) {
-                            // If user expects the object to be void (for example a hollow sloping vase),
-                            // don't continue the search. In this case, we only generate the external solid
-                            // shell if the object would otherwise show a hole (gap between perimeters of 
-                            // the two layers), and internal solid shells are a subset of the shells found 
-                            // on each previous layer.
-                            goto EXTERNAL;
-                        } else {
-                            // If we have internal infill, we can generate internal solid shells freely.
-                            continue;
-                        }
-                    }
-                    
-                    if (region_config.fill_density.value == 0) {
-                        // if we're printing a hollow object we discard any solid shell thinner
-                        // than a perimeter width, since it's probably just crossing a sloping wall
-                        // and it's not wanted in a hollow print even if it would make sense when
-                        // obeying the solid shell count option strictly (DWIM!)
-                        float margin = float(neighbor_layerm->flow(frExternalPerimeter).scaled_width());
-                        Polygons too_narrow = diff(
-                            new_internal_solid, 
-                            offset2(new_internal_solid, -margin, +margin, jtMiter, 5), 
-                            true);
-                        // Trim the regularized region by the original region.
-                        if (! too_narrow.empty())
-                            new_internal_solid = solid = diff(new_internal_solid, too_narrow);
-                    }
+                for (int n = i + 1; n < int(m_layers.size()) && n - i < region_config.bottom_solid_layers.value; ++ n)
+                    if (! propagate_horizontal_shell(layerm, m_layers[n]->regions()[region_id], solid))
+                        break;
+            }
+        }
 
-                    // make sure the new internal solid is wide enough, as it might get collapsed
-                    // when spacing is added in Fill.pm
-                    {
-                        //FIXME Vojtech: Disable this and you will be sorry.
-                        // https://github.com/prusa3d/Slic3r/issues/26 bottom
-                        float margin = 3.f * layerm->flow(frSolidInfill).scaled_width(); // require at least this size
-                        // we use a higher miterLimit here to handle areas with acute angles
-                        // in those cases, the default miterLimit would cut the corner and we'd
-                        // get a triangle in $too_narrow; if we grow it below then the shell
-                        // would have a different shape from the external surface and we'd still
-                        // have the same angle, so the next shell would be grown even more and so on.
-                        Polygons too_narrow = diff(
-                            new_internal_solid,
-                            offset2(new_internal_solid, -margin, +margin, ClipperLib::jtMiter, 5),
-                            true);
-                        if (! too_narrow.empty()) {
-                            // grow the collapsing parts and add the extra area to  the neighbor layer 
-                            // as well as to our original surfaces so that we support this 
-                            // additional area in the next shell too
-                            // make sure our grown surfaces don't exceed the fill area
-                            Polygons internal;
-                            for (const Surface &surface : neighbor_layerm->fill_surfaces.surfaces)
-                                if (surface.is_internal() && !surface.is_bridge())
-                                    polygons_append(internal, to_polygons(surface.expolygon));
-                            polygons_append(new_internal_solid, 
-                                intersection(
-                                    offset(too_narrow, +margin),
-                                    // Discard bridges as they are grown for anchoring and we can't
-                                    // remove such anchors. (This may happen when a bridge is being 
-                                    // anchored onto a wall where little space remains after the bridge
-                                    // is grown, and that little space is an internal solid shell so 
-                                    // it triggers this too_narrow logic.)
-                                    internal));
-                            solid = new_internal_solid;
-                        }
+        // Propagate the shells of the top surfaces downwards. The top surfaces of a layer do not receive any shell
+        // from the layers above before being propagated, and the shells of the top surfaces never reach the layers
+        // visited by the bottom shells sweep later, therefore the top shells are propagated after the bottom shells.
+        // In the k-th pass, the shells of all layers are propagated k layers down in parallel. A layer receives the shells
+        // of the layers above in the same order as if the layers were processed one by one from the bottom up.
+        BOOST_LOG_TRIVIAL(debug) << "Discovering horizontal shells for region " << region_id << ", top shells in parallel - start";
+        std::vector<Polygons> top_solid(m_layers.size());
+        tbb::parallel_for(
+            tbb::blocked_range<size_t>(0, m_layers.size()),
+            [this, region_id, &top_solid](const tbb::blocked_range<size_t>& range) {
+                for (size_t i = range.begin(); i < range.end(); ++ i)
+                    top_solid[i] = horizontal_shell_solid(m_layers[i]->regions()[region_id], stTop);
+            });
+        for (size_t k = 1; int(k) < region_config.top_solid_layers.value && k < m_layers.size(); ++ k)
+            tbb::parallel_for(
+                tbb::blocked_range<size_t>(k, m_layers.size()),
+                [this, region_id, k, &top_solid](const tbb::blocked_range<size_t>& range) {
+                    for (size_t i = range.begin(); i < range.end(); ++ i) {
+                        m_print->throw_if_canceled();
+                        // An empty solid does not modify the neighbor layer.
+                        if (! top_solid[i].empty() &&
+                            ! propagate_horizontal_shell(m_layers[i]->regions()[region_id], m_layers[i - k]->regions()[region_id], top_solid[i]))
+                            top_solid[i].clear();
                     }
-                    
-                    // internal-solid are the union of the existing internal-solid surfaces
-                    // and new ones
-                    SurfaceCollection backup = std::move(neighbor_layerm->fill_surfaces);
-                    polygons_append(new_internal_solid, to_polygons(backup.filter_by_type(stInternalSolid)));
-                    ExPolygons internal_solid = union_ex(new_internal_solid, false);
-                    // assign new internal-solid surfaces to layer
-                    neighbor_layerm->fill_surfaces.set(internal_solid, stInternalSolid);
-                    // subtract intersections from layer surfaces to get resulting internal surfaces
-                    Polygons polygons_internal = to_polygons(std::move(internal_solid));
-                    ExPolygons internal = diff_ex(
-                        to_polygons(backup.filter_by_type(stInternal)),
-                        polygons_internal,
-                        true);
-                    // assign resulting internal surfaces to layer
-                    neighbor_layerm->fill_surfaces.append(internal, stInternal);
-                    polygons_append(polygons_internal, to_polygons(std::move(internal)));
-                    // assign top and bottom surfaces to layer
-                    SurfaceType surface_types_solid[] = { stTop, stBottom, stBottomBridge };
-                    backup.keep_types(surface_types_solid, 3);
-                    std::vector<SurfacesPtr> top_bottom_groups;
-                    backup.group(&top_bottom_groups);
-                    for (SurfacesPtr &group : top_bottom_groups)
-                        neighbor_layerm->fill_surfaces.append(
-                            diff_ex(to_polygons(group), polygons_internal),
-                            // Use an existing surface as a template, it carries the bridge angle etc.
-                            *group.front());
-                }
-		EXTERNAL:;
-            } // foreach type (stTop, stBottom, stBottomBridge)
-        } // for each layer
+                });
+        m_print->throw_if_canceled();
+        BOOST_LOG_TRIVIAL(debug) << "Discovering horizontal shells for region " << region_id << " - end";
     } // for each region
 
 #ifdef SLIC3R_DEBUG_SLICE_PROCESSING
@@ -2126,71 +2606,79 @@ void PrintObject::combine_infill()
         }
         
         // loop through layers to which we have assigned layers to combine
-        for (size_t layer_idx = 0; layer_idx < m_layers.size(); ++ layer_idx) {
-            m_print->throw_if_canceled();
-            size_t num_layers = combine[layer_idx];
-			if (num_layers <= 1)
-                continue;
-            // Get all the LayerRegion objects to be combined.
-            std::vector<LayerRegion*> layerms;
-            layerms.reserve(num_layers);
-			for (size_t i = layer_idx + 1 - num_layers; i <= layer_idx; ++ i)
-                layerms.emplace_back(m_layers[i]->regions()[region_id]);
-            // We need to perform a multi-layer intersection, so let's split it in pairs.
-            // Initialize the intersection with the candidates of the lowest layer.
-            ExPolygons intersection = to_expolygons(layerms.front()->fill_surfaces.filter_by_type(stInternal));
-            // Start looping from the second layer and intersect the current intersection with it.
-            for (size_t i = 1; i < layerms.size(); ++ i)
-                intersection = intersection_ex(
-                    to_polygons(intersection),
-                    to_polygons(layerms[i]->fill_surfaces.filter_by_type(stInternal)),
-                    false);
-            double area_threshold = layerms.front()->infill_area_threshold();
-            if (! intersection.empty() && area_threshold > 0.)
-                intersection.erase(std::remove_if(intersection.begin(), intersection.end(), 
-                    [area_threshold](const ExPolygon &expoly) { return expoly.area() <= area_threshold; }), 
-                    intersection.end());
-            if (intersection.empty())
-                continue;
-//            Slic3r::debugf "  combining %d %s regions from layers %d-%d\n",
-//                scalar(@$intersection),
-//                ($type == S_TYPE_INTERNAL ? 'internal' : 'internal-solid'),
-//                $layer_idx-($every-1), $layer_idx;
-            // intersection now contains the regions that can be combined across the full amount of layers,
-            // so let's remove those areas from all layers.
-            Polygons intersection_with_clearance;
-            intersection_with_clearance.reserve(intersection.size());
-            float clearance_offset = 
-                0.5f * layerms.back()->flow(frPerimeter).scaled_width() +
-             // Because fill areas for rectilinear and honeycomb are grown 
-             // later to overlap perimeters, we need to counteract that too.
-                ((region->config().fill_pattern == ipRectilinear   ||
-                  region->config().fill_pattern == ipGrid          ||
-                  region->config().fill_pattern == ipLine          ||
-                  region->config().fill_pattern == ipHoneycomb) ? 1.5f : 0.5f) * 
-                    layerms.back()->flow(frSolidInfill).scaled_width();
-            for (ExPolygon &expoly : intersection)
-                polygons_append(intersection_with_clearance, offset(expoly, clearance_offset));
-            for (LayerRegion *layerm : layerms) {
-                Polygons internal = to_polygons(layerm->fill_surfaces.filter_by_type(stInternal));
-                layerm->fill_surfaces.remove_type(stInternal);
-                layerm->fill_surfaces.append(diff_ex(internal, intersection_with_clearance, false), stInternal);
-                if (layerm == layerms.back()) {
-                    // Apply surfaces back with adjusted depth to the uppermost layer.
-                    Surface templ(stInternal, ExPolygon());
-                    templ.thickness = 0.;
-                    for (LayerRegion *layerm2 : layerms)
-                        templ.thickness += layerm2->layer()->height;
-                    templ.thickness_layers = (unsigned short)layerms.size();
-                    layerm->fill_surfaces.append(intersection, templ);
-                } else {
-                    // Save void surfaces.
-                    layerm->fill_surfaces.append(
-                        intersection_ex(internal, intersection_with_clearance, false),
-                        stInternalVoid);
+        // The groups of the combined layers do not overlap, thus the groups are processed in parallel.
+        BOOST_LOG_TRIVIAL(debug) << "Combining infill for region " << region_id << " in parallel - start";
+        tbb::parallel_for(
+            tbb::blocked_range<size_t>(0, m_layers.size()),
+            [this, region_id, region, &combine](const tbb::blocked_range<size_t>& range) {
+                for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
+                    m_print->throw_if_canceled();
+                    size_t num_layers = combine[layer_idx];
+                    if (num_layers <= 1)
+                        continue;
+                    // Get all the LayerRegion objects to be combined.
+                    std::vector<LayerRegion*> layerms;
+                    layerms.reserve(num_layers);
+                    for (size_t i = layer_idx + 1 - num_layers; i <= layer_idx; ++ i)
+                        layerms.emplace_back(m_layers[i]->regions()[region_id]);
+                    // We need to perform a multi-layer intersection, so let's split it in pairs.
+                    // Initialize the intersection with the candidates of the lowest layer.
+                    ExPolygons intersection = to_expolygons(layerms.front()->fill_surfaces.filter_by_type(stInternal));
+                    // Start looping from the second layer and intersect the current intersection with it.
+                    for (size_t i = 1; i < layerms.size(); ++ i)
+                        intersection = intersection_ex(
+                            to_polygons(intersection),
+                            to_polygons(layerms[i]->fill_surfaces.filter_by_type(stInternal)),
+                            false);
+                    double area_threshold = layerms.front()->infill_area_threshold();
+                    if (! intersection.empty() && area_threshold > 0.)
+                        intersection.erase(std::remove_if(intersection.begin(), intersection.end(), 
+                            [area_threshold](const ExPolygon &expoly) { return expoly.area() <= area_threshold; }), 
+                            intersection.end());
+                    if (intersection.empty())
+                        continue;
+//                    Slic3r::debugf "  combining %d %s regions from layers %d-%d\n",
+//                        scalar(@$intersection),
+//                        ($type == S_TYPE_INTERNAL ? 'internal' : 'internal-solid'),
+//                        $layer_idx-($every-1), $layer_idx;
+                    // intersection now contains the regions that can be combined across the full amount of layers,
+                    // so let's remove those areas from all layers.
+                    Polygons intersection_with_clearance;
+                    intersection_with_clearance.reserve(intersection.size());
+                    float clearance_offset = 
+                        0.5f * layerms.back()->flow(frPerimeter).scaled_width() +
+                     // Because fill areas for rectilinear and honeycomb are grown 
+                     // later to overlap perimeters, we need to counteract that too.
+                        ((region->config().fill_pattern == ipRectilinear   ||
+                          region->config().fill_pattern == ipGrid          ||
+                          region->config().fill_pattern == ipLine          ||
+                          region->config().fill_pattern == ipHoneycomb) ? 1.5f : 0.5f) * 
+                            layerms.back()->flow(frSolidInfill).scaled_width();
+                    for (ExPolygon &expoly : intersection)
+                        polygons_append(intersection_with_clearance, offset(expoly, clearance_offset));
+                    for (LayerRegion *layerm : layerms) {
+                        Polygons internal = to_polygons(layerm->fill_surfaces.filter_by_type(stInternal));
+                        layerm->fill_surfaces.remove_type(stInternal);
+                        layerm->fill_surfaces.append(diff_ex(internal, intersection_with_clearance, false), stInternal);
+                        if (layerm == layerms.back()) {
+                            // Apply surfaces back with adjusted depth to the uppermost layer.
+                            Surface templ(stInternal, ExPolygon());
+                            templ.thickness = 0.;
+                            for (LayerRegion *layerm2 : layerms)
+                                templ.thickness += layerm2->layer()->height;
+                            templ.thickness_layers = (unsigned short)layerms.size();
+                            layerm->fill_surfaces.append(intersection, templ);
+                        } else {
+                            // Save void surfaces.
+                            layerm->fill_surfaces.append(
+                                intersection_ex(internal, intersection_with_clearance, false),
+                                stInternalVoid);
+                        }
+                    }
                 }
-            }
-        }
+            });
+        m_print->throw_if_canceled();
+        BOOST_LOG_TRIVIAL(debug) << "Combining infill for region " << region_id << " in parallel - end";
     }
 }
 
@@ -2,6 +2,7 @@
 #include <ExPolygon.hpp>
 
 #include <cstdint>
+#include <algorithm>
 
 // For rasterizing
 #include <agg/agg_basics.h>
@@ -35,10 +36,24 @@ public:
     static const TPixel ColorBlack;
 
     using Origin = Raster::Origin;
+    using Storage = Raster::Storage;
+
+    // A run of covered pixels in a row. If len is negative, the span is
+    // solid: -len pixels with the single coverage value at m_covers[covers].
+    // Otherwise the span has len per pixel coverage values starting at
+    // m_covers[covers]. This is the convention of agg::scanline_p8.
+    struct Span {
+        int x;
+        int len;
+        size_t covers;
+    };
+
+    using TRow = std::vector<Span>;
 
 private:
     Raster::Resolution m_resolution;
     Raster::PixelDim m_pxdim;
+    Storage m_storage;
     TBuffer m_buf;
     TRawBuffer m_rbuf;
     TPixelRenderer m_pixfmt;
@@ -46,6 +61,10 @@ private:
     TRendererAA m_renderer;
     Origin m_o;
 
+    // The spans of each row and the coverage values they refer to
+    std::vector<TRow> m_rows;
+    std::vector<agg::int8u> m_covers;
+
     inline void flipy(agg::path_storage& path) const {
         path.flip_y(0, m_resolution.height_px);
     }
@@ -53,16 +72,17 @@ private:
 public:
 
     inline Impl(const Raster::Resolution& res, const Raster::PixelDim &pd,
-                Origin o):
-        m_resolution(res), m_pxdim(pd),
-        m_buf(res.pixels()),
+                Origin o, Storage s):
+        m_resolution(res), m_pxdim(pd), m_storage(s),
+        m_buf(s == Storage::BUFFER ? res.pixels() : 0),
         m_rbuf(reinterpret_cast<TPixelRenderer::value_type*>(m_buf.data()),
               res.width_px, res.height_px,
               int(res.width_px*TPixelRenderer::num_components)),
         m_pixfmt(m_rbuf),
         m_raw_renderer(m_pixfmt),
         m_renderer(m_raw_renderer),
-        m_o(o)
+        m_o(o),
+        m_rows(s == Storage::SPANS ? res.height_px : 0)
     {
         m_renderer.color(ColorWhite);
 
@@ -88,20 +108,93 @@ public:
             ras.add_path(holepath);
         }
 
-        agg::render_scanlines(ras, scanlines, m_renderer);
+        if(m_storage == Storage::SPANS) {
+            if(ras.rewind_scanlines()) {
+                scanlines.reset(ras.min_x(), ras.max_x());
+                while(ras.sweep_scanline(scanlines)) record(scanlines);
+            }
+        } else agg::render_scanlines(ras, scanlines, m_renderer);
     }
 
     inline void clear() {
-        m_raw_renderer.clear(ColorBlack);
+        if(m_storage == Storage::SPANS) {
+            for(TRow& row : m_rows) row.clear();
+            m_covers.clear();
+        } else m_raw_renderer.clear(ColorBlack);
     }
 
-    inline TBuffer& buffer()  { return m_buf; }
+    // Call fn with a pointer to the pixels of each row, starting with the
+    // first row of the buffer. With the SPANS storage, the rows are composed
+    // one by one into a single row of pixels.
+    template<class Fn> void foreach_row(Fn&& fn) {
+        const unsigned w = m_resolution.width_px;
+
+        if(m_storage == Storage::SPANS) {
+            std::vector<agg::int8u> px(w);
+            for(const TRow& row : m_rows) {
+                std::fill(px.begin(), px.end(), agg::int8u(0));
+                for(const Span& sp : row) blend(px, sp);
+                fn(px.data());
+            }
+        } else {
+            auto ptr = reinterpret_cast<const agg::int8u*>(m_buf.data());
+            for(unsigned r = 0; r < m_resolution.height_px; r++, ptr += w)
+                fn(ptr);
+        }
+    }
 
     inline const Raster::Resolution resolution() { return m_resolution; }
 
     inline Origin origin() const /*noexcept*/ { return m_o; }
 
+    inline Storage storage() const /*noexcept*/ { return m_storage; }
+
 private:
+
+    // Store the spans of a scanline clipped to the raster, the same way
+    // agg::renderer_base clips them for the pixel buffer.
+    template<class Scanline> void record(const Scanline& sl) {
+        int y = sl.y();
+        if(y < 0 || y >= int(m_resolution.height_px)) return;
+
+        TRow& row = m_rows[size_t(y)];
+        unsigned num_spans = sl.num_spans();
+        auto span = sl.begin();
+        for(;; ++span) {
+            bool solid = span->len < 0;
+            int x0 = span->x;
+            int x1 = x0 + (solid ? -span->len : span->len);
+            const agg::int8u* covers = span->covers;
+
+            if(x0 < 0) { if(!solid) covers -= x0; x0 = 0; }
+            x1 = std::min(x1, int(m_resolution.width_px));
+
+            if(x0 < x1) {
+                row.push_back({x0, solid ? x0 - x1 : x1 - x0, m_covers.size()});
+                m_covers.insert(m_covers.end(), covers,
+                                covers + (solid ? 1 : x1 - x0));
+            }
+
+            if(--num_spans == 0) break;
+        }
+    }
+
+    // Draw a span over the row with the solid white color. The blending is
+    // the same as the one of TRendererAA on the pixel buffer.
+    void blend(std::vector<agg::int8u>& px, const Span& sp) const {
+        auto blendpx = [](agg::int8u& p, agg::int8u cover) {
+            if(cover == agg::cover_full) p = ColorWhite.v;
+            else p = TPixel::lerp(p, ColorWhite.v,
+                                  TPixel::mult_cover(ColorWhite.a, cover));
+        };
+
+        const agg::int8u* covers = m_covers.data() + sp.covers;
+        if(sp.len < 0)
+            for(int x = sp.x; x < sp.x - sp.len; ++x) blendpx(px[x], *covers);
+        else
+            for(int x = sp.x; x < sp.x + sp.len; ++x) blendpx(px[x], *covers++);
+    }
+
     double getPx(const Point& p) {
         return p(0) * SCALING_FACTOR/m_pxdim.w_mm;
     }
@@ -126,8 +219,8 @@ private:
 const Raster::Impl::TPixel Raster::Impl::ColorWhite = Raster::Impl::TPixel(255);
 const Raster::Impl::TPixel Raster::Impl::ColorBlack = Raster::Impl::TPixel(0);
 
-Raster::Raster(const Resolution &r, const PixelDim &pd, Origin o):
-    m_impl(new Impl(r, pd, o)) {}
+Raster::Raster(const Resolution &r, const PixelDim &pd, Origin o, Storage s):
+    m_impl(new Impl(r, pd, o, s)) {}
 
 Raster::Raster() {}
 
@@ -146,9 +239,16 @@ void Raster::reset(const Raster::Resolution &r, const Raster::PixelDim &pd)
 
 void Raster::reset(const Raster::Resolution &r, const Raster::PixelDim &pd,
                    Raster::Origin o)
+{
+    auto s = m_impl? m_impl->storage() : Storage::BUFFER;
+    reset(r, pd, o, s);
+}
+
+void Raster::reset(const Raster::Resolution &r, const Raster::PixelDim &pd,
+                   Raster::Origin o, Raster::Storage s)
 {
     m_impl.reset();
-    m_impl.reset(new Impl(r, pd, o));
+    m_impl.reset(new Impl(r, pd, o, s));
 }
 
 void Raster::reset()
@@ -191,14 +291,9 @@ void Raster::save(std::ostream& stream, Compression comp)
 
         wr.write_info();
 
-        auto& b = m_impl->buffer();
-        auto ptr = reinterpret_cast<png::byte*>( b.data() );
-        unsigned stride =
-                sizeof(Impl::TBuffer::value_type) *  resolution().width_px;
-
-        for(unsigned r = 0; r < resolution().height_px; r++, ptr+=stride) {
-            wr.write_row(ptr);
-        }
+        m_impl->foreach_row([&wr](const agg::int8u* row) {
+            wr.write_row(const_cast<png::byte*>(row));
+        });
 
         break;
     }
@@ -208,9 +303,10 @@ void Raster::save(std::ostream& stream, Compression comp)
                << m_impl->resolution().height_px << " "
                << "255 ";
 
-        auto sz = m_impl->buffer().size()*sizeof(Impl::TBuffer::value_type);
-        stream.write(reinterpret_cast<const char*>(m_impl->buffer().data()),
-                     std::streamsize(sz));
+        auto sz = std::streamsize(m_impl->resolution().width_px);
+        m_impl->foreach_row([&stream, sz](const agg::int8u* row) {
+            stream.write(reinterpret_cast<const char*>(row), sz);
+        });
     }
     }
 }
@@ -39,6 +39,20 @@ public:
         BOTTOM_LEFT
     };
 
+    /// How the rasterized pixels are kept until the raster is saved.
+    ///
+    /// The BUFFER storage holds a full gray pixel buffer of the raster. The
+    /// SPANS storage keeps the covered pixels of each row as run-length spans
+    /// straight from the scanline rasterizer, with per pixel anti-aliasing
+    /// coverage only at the span edges. A row of pixels is composed from the
+    /// spans only when it is saved. SLA layers are mostly black, so the memory
+    /// needed is roughly proportional to the count of the polygon edges.
+    /// Both storages produce the same pixels.
+    enum class Storage {
+        BUFFER, //!> Full gray pixel buffer
+        SPANS   //!> Run-length spans of each row
+    };
+
     /// Type that represents a resolution in pixels.
     struct Resolution {
         unsigned width_px;
@@ -59,7 +73,8 @@ public:
 
     /// Constructor taking the resolution and the pixel dimension.
     explicit Raster(const Resolution& r, const PixelDim& pd,
-                    Origin o = Origin::BOTTOM_LEFT );
+                    Origin o = Origin::BOTTOM_LEFT,
+                    Storage s = Storage::BUFFER);
     Raster();
     Raster(const Raster& cpy) = delete;
     Raster& operator=(const Raster& cpy) = delete;
@@ -69,6 +84,7 @@ public:
     /// Reallocated everything for the given resolution and pixel dimension.
     void reset(const Resolution& r, const PixelDim& pd);
     void reset(const Resolution& r, const PixelDim& pd, Origin o);
+    void reset(const Resolution& r, const PixelDim& pd, Origin o, Storage s);
 
     /**
      * Release the allocated resources. Drawing in this state ends in
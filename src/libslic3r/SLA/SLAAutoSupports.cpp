@@ -1,14 +1,107 @@
-#include "igl/random_points_on_mesh.h"
 #include "igl/AABB.h"
 
 #include "SLAAutoSupports.hpp"
 #include "Model.hpp"
 
 #include <iostream>
+#include <random>
+#include <unordered_map>
 
 
 namespace Slic3r {
 
+namespace {
+
+// Samples points on a mesh uniformly by area. The cumulative areas of the facets are calculated once,
+// a sample then costs a binary search over the facets.
+class AreaSampler {
+public:
+    AreaSampler(const Eigen::MatrixXf &V, const Eigen::MatrixXi &F) : m_V(V), m_F(F), m_rng(std::random_device()())
+    {
+        m_cumulative_area.reserve(size_t(F.rows()));
+        double area = 0.;
+        for (Eigen::Index i = 0; i < F.rows(); ++ i) {
+            Vec3d a1 = (V.row(F(i, 1)) - V.row(F(i, 0))).cast<double>().transpose();
+            Vec3d a2 = (V.row(F(i, 2)) - V.row(F(i, 0))).cast<double>().transpose();
+            area += a1.cross(a2).norm();
+            m_cumulative_area.emplace_back(area);
+        }
+    }
+
+    bool empty() const { return m_cumulative_area.empty() || m_cumulative_area.back() <= 0.; }
+
+    // Returns a random point on the mesh and the index of the facet it lies on.
+    Vec3f sample(int &facet_idx)
+    {
+        std::uniform_real_distribution<double> dist(0., 1.);
+        auto it = std::upper_bound(m_cumulative_area.begin(), m_cumulative_area.end(), dist(m_rng) * m_cumulative_area.back());
+        facet_idx = int(std::min<size_t>(it - m_cumulative_area.begin(), m_cumulative_area.size() - 1));
+        // Uniformly distributed barycentric coordinates.
+        float u = float(dist(m_rng));
+        float v = float(dist(m_rng));
+        if (u + v > 1.f) {
+            u = 1.f - u;
+            v = 1.f - v;
+        }
+        return (1.f - u - v) * m_V.row(m_F(facet_idx, 0)) + u * m_V.row(m_F(facet_idx, 1)) + v * m_V.row(m_F(facet_idx, 2));
+    }
+
+private:
+    const Eigen::MatrixXf  &m_V;
+    const Eigen::MatrixXi  &m_F;
+    std::vector<double>     m_cumulative_area;
+    std::mt19937            m_rng;
+};
+
+// Spatial hash of the support point indices to find the points close to a new candidate.
+class PointGrid3D {
+public:
+    explicit PointGrid3D(float cell_size) : m_cell_size(cell_size) {}
+
+    void insert(const Vec3f &pt, size_t idx) { m_cells[cell(pt)].emplace_back(idx); }
+
+    // Calls fn(idx) for all the points inserted in the cells overlapping a cube of the given radius around pt
+    // until fn returns false. Returns false if the visitation was stopped.
+    template<typename Fn> bool visit(const Vec3f &pt, float radius, size_t num_points, Fn fn) const
+    {
+        // If the cube covers more cells than there are points, test all the points.
+        const double cells_per_axis = 2. * double(radius) / double(m_cell_size) + 2.;
+        if (! (cells_per_axis * cells_per_axis * cells_per_axis <= double(num_points))) {
+            for (size_t idx = 0; idx < num_points; ++ idx)
+                if (! fn(idx))
+                    return false;
+            return true;
+        }
+        const Vec3i lo = cell(pt - Vec3f(radius, radius, radius));
+        const Vec3i hi = cell(pt + Vec3f(radius, radius, radius));
+        for (int k = lo(2); k <= hi(2); ++ k)
+            for (int j = lo(1); j <= hi(1); ++ j)
+                for (int i = lo(0); i <= hi(0); ++ i) {
+                    auto it = m_cells.find(Vec3i(i, j, k));
+                    if (it != m_cells.end())
+                        for (size_t idx : it->second)
+                            if (! fn(idx))
+                                return false;
+                }
+        return true;
+    }
+
+private:
+    Vec3i cell(const Vec3f &pt) const
+    {
+        return Vec3i(int(std::floor(pt(0) / m_cell_size)), int(std::floor(pt(1) / m_cell_size)), int(std::floor(pt(2) / m_cell_size)));
+    }
+
+    struct CellHash {
+        size_t operator()(const Vec3i &c) const { return size_t(c(0)) * 73856093 ^ size_t(c(1)) * 19349663 ^ size_t(c(2)) * 83492791; }
+    };
+
+    float                                                    m_cell_size;
+    std::unordered_map<Vec3i, std::vector<size_t>, CellHash> m_cells;
+};
+
+} // namespace
+
 SLAAutoSupports::SLAAutoSupports(ModelObject& mo, const SLAAutoSupports::Config& c)
 : m_model_object(mo), mesh(), m_config(c)
 {}
@@ -47,10 +140,6 @@ void SLAAutoSupports::generate()
     if (bb.size()(2) < m_config.minimal_z)
         return;
 
-    // All points that we curretly have must be transformed too, so distance to them is correcly calculated.
-    for (Vec3f& point : m_model_object.sla_support_points)
-        point = transformation_matrix.cast<float>() * point;
-
     const stl_file& stl = mesh.stl;
     Eigen::MatrixXf V;
     Eigen::MatrixXi F;
@@ -66,6 +155,16 @@ void SLAAutoSupports::generate()
         F(i, 2) = 3*i+2;
     }
 
+    // Degenerate meshes with zero area offer no place for a support point. Check it before the support points
+    // are transformed, so that they are left untouched.
+    AreaSampler sampler(V, F);
+    if (sampler.empty())
+        return;
+
+    // All points that we curretly have must be transformed too, so distance to them is correcly calculated.
+    for (Vec3f& point : m_model_object.sla_support_points)
+        point = transformation_matrix.cast<float>() * point;
+
     // In order to calculate distance to already placed points, we must keep know which facet the point lies on.
     std::vector<Vec3f> facets_normals;
 
@@ -96,20 +195,22 @@ void SLAAutoSupports::generate()
     // Angle at which the density reaches zero:
     const float threshold_angle = std::min(M_PI_2, M_PI_4 * acos(0.f/m_config.density_at_horizontal) / acos(m_config.density_at_45/m_config.density_at_horizontal));
 
-    srand(time(NULL)); // rand() is used by igl::random_point_on_mesh
+    // The approximate geodesic distance is never smaller than the squared euclidean distance, therefore only the points
+    // closer than sqrt(distance_limit) may refuse a new point. The grid cell is sized for the distance limit at the highest density.
+    const float min_distance_limit = 1.f / (2.4f * m_config.density_at_horizontal);
+    PointGrid3D grid((min_distance_limit > 0.f && std::isfinite(min_distance_limit)) ? std::sqrt(min_distance_limit) : float(bb.size().norm()));
+    for (size_t i = 0; i < m_model_object.sla_support_points.size(); ++ i)
+        grid.insert(m_model_object.sla_support_points[i], i);
+
     while (refused_points < refused_limit) {
         // Place a random point on the mesh and calculate corresponding facet's normal:
-        Eigen::VectorXi FI;
-        Eigen::MatrixXf B;
-        igl::random_points_on_mesh(1, V, F, B, FI);
-        point = B(0,0)*V.row(F(FI(0),0)) +
-                B(0,1)*V.row(F(FI(0),1)) +
-                B(0,2)*V.row(F(FI(0),2));
+        int facet_idx = 0;
+        point = sampler.sample(facet_idx);
         if (point(2) - bb.min(2) < m_config.minimal_z)
             continue;
 
-        Vec3f a1 = V.row(F(FI(0),1)) - V.row(F(FI(0),0));
-        Vec3f a2 = V.row(F(FI(0),2)) - V.row(F(FI(0),0));
+        Vec3f a1 = V.row(F(facet_idx,1)) - V.row(F(facet_idx,0));
+        Vec3f a2 = V.row(F(facet_idx,2)) - V.row(F(facet_idx,0));
         normal = a1.cross(a2);
         normal.normalize();
 
@@ -119,20 +220,19 @@ void SLAAutoSupports::generate()
             continue;
 
         const float distance_limit = 1./(2.4*get_required_density(angle));
-        bool add_it = true;
-        for (unsigned int i=0; i<m_model_object.sla_support_points.size(); ++i) {
-            if (approximate_geodesic_distance(m_model_object.sla_support_points[i], point, facets_normals[i], normal) < distance_limit) {
-                add_it = false;
-                ++refused_points;
-                break;
-            }
-        }
+        // Slightly enlarged to be safe against the rounding errors of approximate_geodesic_distance().
+        const float search_radius  = 1.001f * std::sqrt(distance_limit) + EPSILON;
+        bool add_it = grid.visit(point, search_radius, m_model_object.sla_support_points.size(), [this, &point, &normal, &facets_normals, distance_limit](size_t i) {
+            return ! (approximate_geodesic_distance(m_model_object.sla_support_points[i], point, facets_normals[i], normal) < distance_limit);
+        });
         if (add_it) {
+            grid.insert(point, m_model_object.sla_support_points.size());
             m_model_object.sla_support_points.push_back(point);
             facets_normals.push_back(normal);
             ++added_points;
             refused_points = 0;
-        }
+        } else
+            ++refused_points;
     }
 
     // Now transform all support points to mesh coordinates:
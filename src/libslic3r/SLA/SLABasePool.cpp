@@ -5,6 +5,8 @@
 #include "SLABoostAdapter.hpp"
 #include "ClipperUtils.hpp"
 
+#include <tbb/parallel_for.h>
+
 //#include "SVG.hpp"
 //#include "benchmark.h"
 
@@ -387,42 +389,47 @@ ExPolygons concave_hull(const ExPolygons& polys, double max_dist_mm = 50,
     // connector sticks are routed.
     Point cc = centroid(centroids);
 
-    punion.reserve(punion.size() + centroids.size());
-
-    idx = 0;
-    std::transform(centroids.begin(), centroids.end(),
-                   std::back_inserter(punion),
-                   [&punion, &boxindex, cc, max_dist_mm, &idx, throw_on_cancel]
-                   (const Point& c)
+    // The connector sticks are independent of each other, they are generated
+    // in parallel and appended to the islands afterwards.
+    ExPolygons bridges(centroids.size());
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, centroids.size()),
+        [&punion, &centroids, &bridges, &boxindex, cc, max_dist_mm,
+         throw_on_cancel](const tbb::blocked_range<size_t>& range)
     {
-        throw_on_cancel();
-        double dx = x(c) - x(cc), dy = y(c) - y(cc);
-        double l = std::sqrt(dx * dx + dy * dy);
-        double nx = dx / l, ny = dy / l;
-        double max_dist = mm(max_dist_mm);
-
-        ExPolygon& expo = punion[idx++];
-        BoundingBox querybb(expo);
-
-        querybb.offset(max_dist);
-        std::vector<SpatElement> result;
-        boxindex.query(bgi::intersects(querybb), std::back_inserter(result));
-        if(result.size() <= 1) return ExPolygon();
-
-        ExPolygon r;
-        auto& ctour = r.contour.points;
-
-        ctour.reserve(3);
-        ctour.emplace_back(cc);
-
-        Point d(coord_t(mm(1)*nx), coord_t(mm(1)*ny));
-        ctour.emplace_back(c + Point( -y(d),  x(d) ));
-        ctour.emplace_back(c + Point(  y(d), -x(d) ));
-        offset(r, mm(1));
-
-        return r;
+        for(size_t idx = range.begin(); idx < range.end(); ++idx) {
+            throw_on_cancel();
+            const Point& c = centroids[idx];
+            double dx = x(c) - x(cc), dy = y(c) - y(cc);
+            double l = std::sqrt(dx * dx + dy * dy);
+            double nx = dx / l, ny = dy / l;
+            double max_dist = mm(max_dist_mm);
+
+            const ExPolygon& expo = punion[idx];
+            BoundingBox querybb(expo);
+
+            querybb.offset(max_dist);
+            std::vector<SpatElement> result;
+            boxindex.query(bgi::intersects(querybb),
+                           std::back_inserter(result));
+            if(result.size() <= 1) continue;
+
+            ExPolygon& r = bridges[idx];
+            auto& ctour = r.contour.points;
+
+            ctour.reserve(3);
+            ctour.emplace_back(cc);
+
+            Point d(coord_t(mm(1)*nx), coord_t(mm(1)*ny));
+            ctour.emplace_back(c + Point( -y(d),  x(d) ));
+            ctour.emplace_back(c + Point(  y(d), -x(d) ));
+            offset(r, mm(1));
+        }
     });
 
+    punion.reserve(punion.size() + bridges.size());
+    std::move(bridges.begin(), bridges.end(), std::back_inserter(punion));
+
     punion = unify(punion);
 
     return punion;
@@ -461,100 +468,116 @@ void create_base_pool(const ExPolygons &ground_layer, TriangleMesh& out,
                    cfg.max_merge_distance_mm;
 
     auto concavehs = concave_hull(ground_layer, mdist, cfg.throw_on_cancel);
-    for(ExPolygon& concaveh : concavehs) {
-        if(concaveh.contour.points.empty()) return;
-        concaveh.holes.clear();
-
-        const coord_t WALL_THICKNESS = mm(cfg.min_wall_thickness_mm);
-
-        const coord_t WALL_DISTANCE = mm(2*cfg.edge_radius_mm) +
-                                      coord_t(0.8*WALL_THICKNESS);
-
-        const coord_t HEIGHT = mm(cfg.min_wall_height_mm);
-
-        auto outer_base = concaveh;
-        offset(outer_base, WALL_THICKNESS+WALL_DISTANCE);
-        auto inner_base = outer_base;
-        offset(inner_base, -WALL_THICKNESS);
-        inner_base.holes.clear(); outer_base.holes.clear();
-
-        ExPolygon top_poly;
-        top_poly.contour = outer_base.contour;
-        top_poly.holes.emplace_back(inner_base.contour);
-        auto& tph = top_poly.holes.back().points;
-        std::reverse(tph.begin(), tph.end());
-
-        Contour3D pool;
-
-        ExPolygon ob = outer_base; double wh = 0;
-
-        // now we will calculate the angle or portion of the circle from
-        // pi/2 that will connect perfectly with the bottom plate.
-        // this is a tangent point calculation problem and the equation can
-        // be found for example here:
-        // http://www.ambrsoft.com/TrigoCalc/Circles2/CirclePoint/CirclePointDistance.htm
-        // the y coordinate would be:
-        // y = cy + (r^2*py - r*px*sqrt(px^2 + py^2 - r^2) / (px^2 + py^2)
-        // where px and py are the coordinates of the point outside the circle
-        // cx and cy are the circle center, r is the radius
-        // to get the angle we use arcsin function and subtract 90 degrees then
-        // flip the sign to get the right input to the round_edge function.
-        double r = cfg.edge_radius_mm;
-        double cy = 0;
-        double cx = 0;
-        double px = cfg.min_wall_thickness_mm;
-        double py = r - cfg.min_wall_height_mm;
-
-        double pxcx = px - cx;
-        double pycy = py - cy;
-        double b_2 = pxcx*pxcx + pycy*pycy;
-        double r_2 = r*r;
-        double D = std::sqrt(b_2 - r_2);
-        double vy = (r_2*pycy - r*pxcx*D) / b_2;
-        double phi = -(std::asin(vy/r) * 180 / PI - 90);
-
-        auto curvedwalls = round_edges(ob,
-                                       r,
-                                       phi,  // 170 degrees
-                                       0,    // z position of the input plane
-                                       true,
-                                       cfg.throw_on_cancel,
-                                       ob, wh);
-
-        pool.merge(curvedwalls);
-
-        ExPolygon ob_contr = ob;
-        ob_contr.holes.clear();
-
-        auto pwalls = walls(ob_contr, inner_base, wh, -cfg.min_wall_height_mm,
-                            cfg.throw_on_cancel);
-        pool.merge(pwalls);
-
-        Polygons top_triangles, bottom_triangles;
-        triangulate(top_poly, top_triangles);
-        triangulate(inner_base, bottom_triangles);
-        auto top_plate = convert(top_triangles, 0, false);
-        auto bottom_plate = convert(bottom_triangles, -HEIGHT, true);
-
-        ob = inner_base; wh = 0;
-        // rounded edge generation for the inner bed
-        curvedwalls = round_edges(ob,
-                                  cfg.edge_radius_mm,
-                                  90,   // 90 degrees
-                                  0,    // z position of the input plane
-                                  false,
-                                  cfg.throw_on_cancel,
-                                  ob, wh);
-        pool.merge(curvedwalls);
-
-        auto innerbed = inner_bed(ob, cfg.min_wall_height_mm/2 + wh, wh);
-
-        pool.merge(top_plate);
-        pool.merge(bottom_plate);
-        pool.merge(innerbed);
-
-        out.merge(mesh(pool));
-    }
+
+    // Only the hulls preceding the first degenerate one make up the pool.
+    auto hulls_end = std::find_if(concavehs.begin(), concavehs.end(),
+                                  [](const ExPolygon& h) {
+        return h.contour.points.empty();
+    });
+    concavehs.erase(hulls_end, concavehs.end());
+
+    // The walls of the separate hulls are generated in parallel, the results
+    // are merged into the output mesh in their original order.
+    std::vector<Contour3D> pools(concavehs.size());
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, concavehs.size(), 1),
+        [&concavehs, &pools, &cfg](const tbb::blocked_range<size_t>& range)
+    {
+        for(size_t hidx = range.begin(); hidx < range.end(); ++hidx) {
+            ExPolygon& concaveh = concavehs[hidx];
+            concaveh.holes.clear();
+
+            const coord_t WALL_THICKNESS = mm(cfg.min_wall_thickness_mm);
+
+            const coord_t WALL_DISTANCE = mm(2*cfg.edge_radius_mm) +
+                                          coord_t(0.8*WALL_THICKNESS);
+
+            const coord_t HEIGHT = mm(cfg.min_wall_height_mm);
+
+            auto outer_base = concaveh;
+            offset(outer_base, WALL_THICKNESS+WALL_DISTANCE);
+            auto inner_base = outer_base;
+            offset(inner_base, -WALL_THICKNESS);
+            inner_base.holes.clear(); outer_base.holes.clear();
+
+            ExPolygon top_poly;
+            top_poly.contour = outer_base.contour;
+            top_poly.holes.emplace_back(inner_base.contour);
+            auto& tph = top_poly.holes.back().points;
+            std::reverse(tph.begin(), tph.end());
+
+            Contour3D& pool = pools[hidx];
+
+            ExPolygon ob = outer_base; double wh = 0;
+
+            // now we will calculate the angle or portion of the circle from
+            // pi/2 that will connect perfectly with the bottom plate.
+            // this is a tangent point calculation problem and the equation can
+            // be found for example here:
+            // http://www.ambrsoft.com/TrigoCalc/Circles2/CirclePoint/CirclePointDistance.htm
+            // the y coordinate would be:
+            // y = cy + (r^2*py - r*px*sqrt(px^2 + py^2 - r^2) / (px^2 + py^2)
+            // where px and py are the coordinates of the point outside the circle
+            // cx and cy are the circle center, r is the radius
+            // to get the angle we use arcsin function and subtract 90 degrees then
+            // flip the sign to get the right input to the round_edge function.
+            double r = cfg.edge_radius_mm;
+            double cy = 0;
+            double cx = 0;
+            double px = cfg.min_wall_thickness_mm;
+            double py = r - cfg.min_wall_height_mm;
+
+            double pxcx = px - cx;
+            double pycy = py - cy;
+            double b_2 = pxcx*pxcx + pycy*pycy;
+            double r_2 = r*r;
+            double D = std::sqrt(b_2 - r_2);
+            double vy = (r_2*pycy - r*pxcx*D) / b_2;
+            double phi = -(std::asin(vy/r) * 180 / PI - 90);
+
+            auto curvedwalls = round_edges(ob,
+                                           r,
+                                           phi,  // 170 degrees
+                                           0,    // z position of the input plane
+                                           true,
+                                           cfg.throw_on_cancel,
+                                           ob, wh);
+
+            pool.merge(curvedwalls);
+
+            ExPolygon ob_contr = ob;
+            ob_contr.holes.clear();
+
+            auto pwalls = walls(ob_contr, inner_base, wh, -cfg.min_wall_height_mm,
+                                cfg.throw_on_cancel);
+            pool.merge(pwalls);
+
+            Polygons top_triangles, bottom_triangles;
+            triangulate(top_poly, top_triangles);
+            triangulate(inner_base, bottom_triangles);
+            auto top_plate = convert(top_triangles, 0, false);
+            auto bottom_plate = convert(bottom_triangles, -HEIGHT, true);
+
+            ob = inner_base; wh = 0;
+            // rounded edge generation for the inner bed
+            curvedwalls = round_edges(ob,
+                                      cfg.edge_radius_mm,
+                                      90,   // 90 degrees
+                                      0,    // z position of the input plane
+                                      false,
+                                      cfg.throw_on_cancel,
+                                      ob, wh);
+            pool.merge(curvedwalls);
+
+            auto innerbed = inner_bed(ob, cfg.min_wall_height_mm/2 + wh, wh);
+
+            pool.merge(top_plate);
+            pool.merge(bottom_plate);
+            pool.merge(innerbed);
+        }
+    });
+
+    for(Contour3D& pool : pools) out.merge(mesh(std::move(pool)));
 }
 
 }
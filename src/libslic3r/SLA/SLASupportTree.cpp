@@ -547,6 +547,8 @@ EigenMesh3D to_eigenmesh(const Contour3D& cntr) {
         F.row(i) = cntr.indices[size_t(i)];
     }
 
+    emesh.build_index();
+
     return emesh;
 }
 
@@ -590,6 +592,8 @@ EigenMesh3D to_eigenmesh(const TriangleMesh& tmesh) {
         F(i, 2) = int(3*i+2);
     }
 
+    outmesh.build_index();
+
     return outmesh;
 }
 
@@ -1061,7 +1065,12 @@ bool SLASupportTree::generate(const PointSet &points,
         // not be enough space for the pinhead. Filtering is applied for
         // these reasons.
 
-        int pcount = 0, hlcount = 0;
+        // The corrected normals of the valid points and the start points of
+        // the rays checking the space for the pinheads
+        std::vector<int> valid; valid.reserve(size_t(count));
+        PointSet corrected_norm(count, 3);
+        PointSet ray_starts(count, 3);
+
         for(int i = 0; i < count; i++) {
             tifcl();
             auto n = nmls.row(i);
@@ -1088,31 +1097,49 @@ bool SLASupportTree::generate(const PointSet &points,
                          std::sin(azimuth) * std::sin(polar),
                          std::cos(polar));
 
-                // save the head (pinpoint) position
                 Vec3d hp = filt_pts.row(i);
 
-                // the full width of the head
-                double w = cfg.head_width_mm +
-                           cfg.head_back_radius_mm +
-                           2*cfg.head_front_radius_mm;
+                auto row = Eigen::Index(valid.size());
+                corrected_norm.row(row) = nn;
+                ray_starts.row(row) = hp + 0.1*nn;
+                valid.emplace_back(i);
+            }
+        }
 
-                // We should shoot a ray in the direction of the pinhead and
-                // see if there is enough space for it
-                double t = ray_mesh_intersect(hp + 0.1*nn, nn, mesh);
+        auto nvalid = Eigen::Index(valid.size());
+        corrected_norm.conservativeResize(nvalid, Eigen::NoChange);
+        ray_starts.conservativeResize(nvalid, Eigen::NoChange);
 
-                if(t > 2*w || std::isinf(t)) {
-                    // 2*w because of lower and upper pinhead
+        // We should shoot a ray in the direction of the pinhead and
+        // see if there is enough space for it
+        tifcl();
+        std::vector<double> hits = mesh.query_ray_hits(ray_starts,
+                                                       corrected_norm);
 
-                    head_pos.row(pcount) = hp;
+        // the full width of the head
+        double w = cfg.head_width_mm +
+                   cfg.head_back_radius_mm +
+                   2*cfg.head_front_radius_mm;
 
-                    // save the verified and corrected normal
-                    head_norm.row(pcount) = nn;
+        int pcount = 0, hlcount = 0;
+        for(size_t k = 0; k < valid.size(); k++) {
+            // save the head (pinpoint) position
+            Vec3d hp = filt_pts.row(valid[k]);
+            Vec3d nn = corrected_norm.row(Eigen::Index(k));
+            double t = hits[k];
 
-                    ++pcount;
-                } else {
-                    headless_norm.row(hlcount) = nn;
-                    headless_pos.row(hlcount++) = hp;
-                }
+            if(t > 2*w || std::isinf(t)) {
+                // 2*w because of lower and upper pinhead
+
+                head_pos.row(pcount) = hp;
+
+                // save the verified and corrected normal
+                head_norm.row(pcount) = nn;
+
+                ++pcount;
+            } else {
+                headless_norm.row(hlcount) = nn;
+                headless_pos.row(hlcount++) = hp;
             }
         }
 
@@ -1170,14 +1197,19 @@ bool SLASupportTree::generate(const PointSet &points,
         gndidx.reserve(size_t(head_pos.rows()));
         nogndidx.reserve(size_t(head_pos.rows()));
 
+        // Shoot the rays down from all the head junctions at once
+        PointSet startpoints(head_pos.rows(), 3);
+        PointSet dirs(head_pos.rows(), 3);
         for(unsigned i = 0; i < head_pos.rows(); i++) {
-            tifcl();
-            auto& head = result.heads()[i];
+            startpoints.row(i) = result.heads()[i].junction_point();
+            dirs.row(i) = Vec3d(0, 0, -1);
+        }
 
-            Vec3d dir(0, 0, -1);
-            Vec3d startpoint = head.junction_point();
+        tifcl();
+        std::vector<double> hits = mesh.query_ray_hits(startpoints, dirs);
 
-            double t = ray_mesh_intersect(startpoint, dir, mesh);
+        for(unsigned i = 0; i < head_pos.rows(); i++) {
+            double t = hits[i];
 
             gndheight.emplace_back(t);
 
@@ -89,15 +89,44 @@ struct Controller {
     std::function<void(void)> cancelfn = [](){};
 };
 
+using PointSet = Eigen::MatrixXd;
+
 /// An index-triangle structure for libIGL functions. Also serves as an
 /// alternative (raw) input format for the SLASupportTree
 struct EigenMesh3D {
     Eigen::MatrixXd V;
     Eigen::MatrixXi F;
     double ground_level = 0;
-};
 
-using PointSet = Eigen::MatrixXd;
+    /// Build the AABB tree of the triangles for the ray and distance
+    /// queries. It has to be called again whenever V or F has changed,
+    /// the to_eigenmesh() functions call it. Without the tree the queries
+    /// fall back to testing every triangle.
+    void build_index();
+    bool has_index() const { return bool(m_aabb); }
+
+    /// Distance along the ray (s, dir) to the first hit of the mesh or
+    /// infinity if the ray misses the mesh.
+    double query_ray_hit(const Vec3d& s, const Vec3d& dir) const;
+
+    /// The same as query_ray_hit() for every row of the sources and dirs
+    /// matrices, evaluated in parallel.
+    std::vector<double> query_ray_hits(const PointSet& sources,
+                                       const PointSet& dirs) const;
+
+    /// Squared distances of the points to the mesh, indices of the closest
+    /// triangles and the closest points (see igl::point_mesh_squared_distance)
+    void squared_distance(const PointSet& points,
+                          Eigen::VectorXd& sqr_dists,
+                          Eigen::VectorXi& triangle_ids,
+                          PointSet& closest_points) const;
+
+private:
+    class AABBImpl;
+    // The tree is not modified after it was built, so the copies of the mesh
+    // share it.
+    std::shared_ptr<const AABBImpl> m_aabb;
+};
 
 EigenMesh3D to_eigenmesh(const TriangleMesh& m);
 
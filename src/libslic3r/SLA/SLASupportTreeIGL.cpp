@@ -9,6 +9,9 @@
 #include "boost/geometry/index/rtree.hpp"
 
 #include <igl/ray_mesh_intersect.h>
+#include <igl/AABB.h>
+
+#include <tbb/parallel_for.h>
 
 //#if !defined(_MSC_VER) || defined(_WIN64)
 #if 1
@@ -84,6 +87,58 @@ size_t SpatIndex::size() const
     return m_impl->m_store.size();
 }
 
+class EigenMesh3D::AABBImpl: public igl::AABB<Eigen::MatrixXd, 3> {};
+
+void EigenMesh3D::build_index()
+{
+    if(F.rows() == 0) { m_aabb.reset(); return; }
+    auto aabb = std::make_shared<AABBImpl>();
+    aabb->init(V, F);
+    m_aabb = std::move(aabb);
+}
+
+double EigenMesh3D::query_ray_hit(const Vec3d &s, const Vec3d &dir) const
+{
+    igl::Hit hit;
+    hit.t = std::numeric_limits<float>::infinity();
+    if(m_aabb) {
+        Eigen::RowVector3d rs = s.transpose(), rdir = dir.transpose();
+        m_aabb->intersect_ray(V, F, rs, rdir, hit);
+    } else
+        igl::ray_mesh_intersect(s, dir, V, F, hit);
+    return double(hit.t);
+}
+
+std::vector<double> EigenMesh3D::query_ray_hits(const PointSet &sources,
+                                                const PointSet &dirs) const
+{
+    assert(sources.rows() == dirs.rows());
+    std::vector<double> ret(size_t(sources.rows()));
+    tbb::parallel_for(size_t(0), ret.size(),
+                      [this, &sources, &dirs, &ret](size_t i)
+    {
+        auto idx = Eigen::Index(i);
+        ret[i] = query_ray_hit(sources.row(idx).transpose(),
+                               dirs.row(idx).transpose());
+    });
+    return ret;
+}
+
+void EigenMesh3D::squared_distance(const PointSet &points,
+                                   Eigen::VectorXd &sqr_dists,
+                                   Eigen::VectorXi &triangle_ids,
+                                   PointSet &closest_points) const
+{
+#ifdef IGL_COMPATIBLE
+    if(m_aabb)
+        m_aabb->squared_distance(V, F, points, sqr_dists, triangle_ids,
+                                 closest_points);
+    else
+        igl::point_mesh_squared_distance(points, V, F, sqr_dists,
+                                         triangle_ids, closest_points);
+#endif
+}
+
 PointSet normals(const PointSet& points, const EigenMesh3D& mesh) {
     if(points.rows() == 0 || mesh.V.rows() == 0 || mesh.F.rows() == 0) return {};
 #ifdef IGL_COMPATIBLE
@@ -91,7 +146,7 @@ PointSet normals(const PointSet& points, const EigenMesh3D& mesh) {
     Eigen::VectorXi I;
     PointSet C;
 
-    igl::point_mesh_squared_distance( points, mesh.V, mesh.F, dists, I, C);
+    mesh.squared_distance(points, dists, I, C);
 
     PointSet ret(I.rows(), 3);
     for(int i = 0; i < I.rows(); i++) {
@@ -117,10 +172,7 @@ double ray_mesh_intersect(const Vec3d& s,
                           const Vec3d& dir,
                           const EigenMesh3D& m)
 {
-    igl::Hit hit;
-    hit.t = std::numeric_limits<float>::infinity();
-    igl::ray_mesh_intersect(s, dir, m.V, m.F, hit);
-    return double(hit.t);
+    return m.query_ray_hit(s, dir);
 }
 
 // Clustering a set of points by the given criteria
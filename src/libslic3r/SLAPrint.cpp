@@ -5,6 +5,7 @@
 
 #include <unordered_set>
 #include <numeric>
+#include <atomic>
 
 #include <tbb/parallel_for.h>
 #include <boost/log/trivial.hpp>
@@ -55,16 +56,19 @@ const std::array<std::string, slaposCount> OBJ_STEP_LABELS =
     L("Slicing supports")               // slaposIndexSlices,
 };
 
+const unsigned min_objstatus = 0;   // where the per object operations start
+const unsigned max_objstatus = 95;  // where the per object operations end
+
 // Should also add up to 100 (%)
 const std::array<unsigned, slapsCount> PRINT_STEP_LEVELS =
 {
-    80,     // slapsRasterize
-    20,     // slapsValidate
+    50,     // slapsRasterize
+    50,     // slapsValidate
 };
 
 const std::array<std::string, slapsCount> PRINT_STEP_LABELS =
 {
-    L("Rasterizing layers"),         // slapsRasterize
+    L("Preparing layers"),           // slapsRasterize
     L("Validating"),                 // slapsValidate
 };
 
@@ -426,6 +430,43 @@ void report_status(SLAPrint& p, int st, const std::string& msg, Args&&...args) {
     p.set_status(st, msg, std::forward<Args>(args)...);
 }
 
+void SLAPrint::draw_level(Raster& raster, unsigned level_id) const
+{
+    assert(level_id < m_printer_levels.size());
+
+    // If the raster has vertical orientation, we will flip the coordinates
+    bool flpXY = m_printer_config.display_orientation.getInt() ==
+            SLADisplayOrientation::sladoPortrait;
+
+    const LayerRefs& lrange = m_printer_input.at(m_printer_levels[level_id]);
+
+    for(auto& lyrref : lrange) { // for all layers in the current level
+        this->throw_if_canceled();
+        const Layer& sl = lyrref.lref;   // get the layer reference
+        const LayerCopies& copies = lyrref.copies;
+
+        // Draw all the polygons in the slice to the actual layer.
+        for(auto& cp : copies) {
+            for(ExPolygon slice : sl) {
+                // The order is important here:
+                // apply rotation before translation...
+                slice.rotate(double(cp.rotation));
+                slice.translate(cp.shift(X), cp.shift(Y));
+                if(flpXY) swapXY(slice);
+                raster.draw(slice);
+            }
+        }
+    }
+}
+
+void SLAPrint::report_raster_status(unsigned levels_done)
+{
+    // The layers are rasterized by export_raster() after process() reported
+    // the slicing done, therefore the export has a progress range of its own.
+    auto st = 100 * size_t(levels_done) / std::max<size_t>(m_printer_levels.size(), 1);
+    report_status(*this, int(st), L("Exporting the rasterized layers"));
+}
+
 void SLAPrint::process()
 {
     using namespace sla;
@@ -438,13 +479,18 @@ void SLAPrint::process()
     auto   ilh  = float(ilhd);
     const size_t objcount = m_objects.size();
 
-    const unsigned min_objstatus = 0;   // where the per object operations start
-    const unsigned max_objstatus = 80;  // where the per object operations end
-
     // the coefficient that multiplies the per object status values which
     // are set up for <0, 100>. They need to be scaled into the whole process
     const double ostepd = (max_objstatus - min_objstatus) / (objcount * 100.0);
 
+    // The objects are processed concurrently, so the status can not be
+    // accumulated step by step. Instead, the levels of the finished object
+    // steps are summed up and scaled into the per object status range.
+    std::atomic<unsigned> objlevels_done(0);
+    auto objstatus = [&objlevels_done, ostepd]() {
+        return min_objstatus + unsigned(objlevels_done * ostepd);
+    };
+
     // The slicing will be performed on an imaginary 1D grid which starts from
     // the bottom of the bounding box created around the supported model. So
     // the first layer which is usually thicker will be part of the supports
@@ -506,7 +552,7 @@ void SLAPrint::process()
     };
 
     // In this step we create the supports
-    auto support_tree = [this, objcount, ostepd](SLAPrintObject& po) {
+    auto support_tree = [this, objcount, &objstatus](SLAPrintObject& po) {
         if(!po.m_supportdata) return;
 
         if(!po.m_config.supports_enable.getBool()) {
@@ -520,15 +566,12 @@ void SLAPrint::process()
             sla::Controller ctl;
 
             // some magic to scale the status values coming from the support
-            // tree creation into the whole print process
-            auto stfirst = OBJ_STEP_LEVELS.begin();
-            auto stthis = stfirst + slaposSupportTree;
-            // we need to add up the status portions until this operation
-            int init = std::accumulate(stfirst, stthis, 0);
-            init = int(init * ostepd);     // scale the init portion
+            // tree creation into the whole print process: the sub operations
+            // are reported relative to the status at the start of this step
+            int init = int(objstatus());
 
             // scaling for the sub operations
-            double d = *stthis / (objcount * 100.0);
+            double d = OBJ_STEP_LEVELS[slaposSupportTree] / (objcount * 100.0);
 
             ctl.statuscb = [this, init, d](unsigned st, const std::string& msg)
             {
@@ -679,8 +722,9 @@ void SLAPrint::process()
         }
     };
 
-    // Rasterizing the model objects, and their supports
-    auto rasterize = [this, max_objstatus]() {
+    // Collecting the layers of the model objects and their supports for the
+    // printer, the rasterization itself is done by export_raster()
+    auto rasterize = [this]() {
         if(canceled()) return;
 
         // clear the rasterizer input
@@ -715,8 +759,9 @@ void SLAPrint::process()
         }
 
         // collect all the keys
-        std::vector<long long> keys; keys.reserve(m_printer_input.size());
-        for(auto& e : m_printer_input) keys.emplace_back(e.first);
+        m_printer_levels.clear();
+        m_printer_levels.reserve(m_printer_input.size());
+        for(auto& e : m_printer_input) m_printer_levels.emplace_back(e.first);
 
         // If the raster has vertical orientation, we will flip the coordinates
         bool flpXY = m_printer_config.display_orientation.getInt() ==
@@ -743,71 +788,9 @@ void SLAPrint::process()
                                                   SLAPrinter::RO_LANDSCAPE));
         }
 
-        // Allocate space for all the layers
-        SLAPrinter& printer = *m_printer;
-        auto lvlcnt = unsigned(m_printer_input.size());
-        printer.layers(lvlcnt);
-
-        // slot is the portion of 100% that is realted to rasterization
-        unsigned slot = PRINT_STEP_LEVELS[slapsRasterize];
-        // ist: initial state; pst: previous state
-        unsigned ist = max_objstatus, pst = ist;
-        // coefficient to map the rasterization state (0-99) to the allocated
-        // portion (slot) of the process state
-        double sd = (100 - ist) / 100.0;
-        SpinMutex slck;
-
-        // procedure to process one height level. This will run in parallel
-        auto lvlfn =
-        [this, &slck, &keys, &printer, slot, sd, ist, &pst, flpXY]
-            (unsigned level_id)
-        {
-            if(canceled()) return;
-
-            LayerRefs& lrange = m_printer_input[keys[level_id]];
-
-            // Switch to the appropriate layer in the printer
-            printer.begin_layer(level_id);
-
-            for(auto& lyrref : lrange) { // for all layers in the current level
-                if(canceled()) break;
-                const Layer& sl = lyrref.lref;   // get the layer reference
-                const LayerCopies& copies = lyrref.copies;
-
-                // Draw all the polygons in the slice to the actual layer.
-                for(auto& cp : copies) {
-                    for(ExPolygon slice : sl) {
-                        // The order is important here:
-                        // apply rotation before translation...
-                        slice.rotate(double(cp.rotation));
-                        slice.translate(cp.shift(X), cp.shift(Y));
-                        if(flpXY) swapXY(slice);
-                        printer.draw_polygon(slice, level_id);
-                    }
-                }
-            }
-
-            // Finish the layer for later saving it.
-            printer.finish_layer(level_id);
-
-            // Status indication guarded with the spinlock
-            auto st = ist + unsigned(sd*level_id*slot/m_printer_input.size());
-            { std::lock_guard<SpinMutex> lck(slck);
-            if( st > pst) {
-                report_status(*this, int(st), PRINT_STEP_LABELS[slapsRasterize]);
-                pst = st;
-            }
-            }
-        };
-
-        // last minute escape
-        if(canceled()) return;
-
-        // Sequential version (for testing)
-        // for(unsigned l = 0; l < lvlcnt; ++l) process_level(l);
-
-        // Print all the layers in parallel
-        tbb::parallel_for<unsigned, decltype(lvlfn)>(0, lvlcnt, lvlfn);
+        // The layers are not rasterized here. Keeping the compressed raster
+        // of every layer in memory would need many GB for tall prints, so
+        // export_raster() draws the levels while writing the zip file.
     };
 
     using slaposFn = std::function<void(SLAPrintObject&)>;
@@ -841,36 +824,52 @@ void SLAPrint::process()
         [](){}  // validate
     };
 
-    unsigned st = min_objstatus;
-    unsigned incr = 0;
-
     BOOST_LOG_TRIVIAL(info) << "Start slicing process.";
 
-    // TODO: this loop could run in parallel but should not exhaust all the CPU
-    // power available
-    for(SLAPrintObject * po : m_objects) {
-
-        BOOST_LOG_TRIVIAL(info) << "Slicing object " << po->model_object()->name;
-
-        for(size_t s = 0; s < objectsteps.size(); ++s) {
-            auto currentstep = objectsteps[s];
-
-            // Cancellation checking. Each step will check for cancellation
-            // on its own and return earlier gracefully. Just after it returns
-            // execution gets to this point and throws the canceled signal.
-            throw_if_canceled();
-
-            st += unsigned(incr * ostepd);
+    // The SLAPrintObjects are independent of each other until the
+    // rasterization, therefore each of them is pushed through its steps by
+    // its own task. A packed plate of small parts keeps all the cores busy
+    // this way. The steps of one object depend on each other, they are
+    // executed sequentially inside the task and they parallelize internally.
+    // The step state machine is guarded by the print state mutex. If the
+    // processing is canceled, the first task to notice throws, the remaining
+    // tasks are canceled by TBB and the exception is re-thrown by
+    // tbb::parallel_for.
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, m_objects.size(), 1),
+        [this, &objectsteps, &pobj_program, &objlevels_done, &objstatus]
+        (const tbb::blocked_range<size_t>& range)
+    {
+        for(size_t idx = range.begin(); idx < range.end(); ++idx) {
+            SLAPrintObject *po = m_objects[idx];
+
+            BOOST_LOG_TRIVIAL(info) << "Slicing object "
+                                    << po->model_object()->name;
+
+            for(size_t s = 0; s < objectsteps.size(); ++s) {
+                auto currentstep = objectsteps[s];
+
+                // Cancellation checking. Each step will check for
+                // cancellation on its own and return earlier gracefully.
+                // Just after it returns execution gets to this point and
+                // throws the canceled signal.
+                throw_if_canceled();
+
+                if(po->m_stepmask[currentstep] &&
+                   po->set_started(currentstep))
+                {
+                    report_status(*this, int(objstatus()),
+                                  OBJ_STEP_LABELS[currentstep]);
+                    pobj_program[currentstep](*po);
+                    po->set_done(currentstep);
+                }
 
-            if(po->m_stepmask[currentstep] && po->set_started(currentstep)) {
-                report_status(*this, int(st), OBJ_STEP_LABELS[currentstep]);
-                pobj_program[currentstep](*po);
-                po->set_done(currentstep);
+                objlevels_done += OBJ_STEP_LEVELS[currentstep];
             }
-
-            incr = OBJ_STEP_LEVELS[currentstep];
         }
-    }
+    });
+
+    throw_if_canceled();
 
     std::array<SLAPrintStep, slapsCount> printsteps = {
         slapsRasterize, slapsValidate
@@ -880,7 +879,7 @@ void SLAPrint::process()
 //    m_stepmask[slapsRasterize] = false;
 
     double pstd = (100 - max_objstatus) / 100.0;
-    st = max_objstatus;
+    unsigned st = max_objstatus;
     for(size_t s = 0; s < print_program.size(); ++s) {
         auto currentstep = printsteps[s];
 
@@ -190,8 +190,19 @@ public:
     // Returns true if the last step was finished with success.
     bool                finished() const override { return this->is_step_done(slaposIndexSlices); }
 
+    // Rasterize the sliced layers and save them into a zip file. The layers
+    // are rasterized while being written, so they are never all in memory.
+    // Nothing is kept after the export, therefore each call rasterizes
+    // the whole print again, including a repeated export from the GUI.
     template<class Fmt> void export_raster(const std::string& fname) {
-        if(m_printer) m_printer->save<Fmt>(fname);
+        if(m_printer) m_printer->save_streaming<Fmt>(
+            fname, unsigned(m_printer_levels.size()),
+            [this](Raster& raster, unsigned level_id) {
+                this->draw_level(raster, level_id);
+            },
+            [this](unsigned levels_done) {
+                this->report_raster_status(levels_done);
+            });
     }
     const PrintObjects& objects() const { return m_objects; }
 
@@ -202,6 +213,11 @@ private:
     using SLAPrinter = FilePrinter<FilePrinterFormat::SLA_PNGZIP>;
     using SLAPrinterPtr = std::unique_ptr<SLAPrinter>;
 
+    // Draw all the object and support slices of a level into the raster.
+    void draw_level(Raster& raster, unsigned level_id) const;
+    // Report the progress of the export from 0 to 100 after levels_done levels were drawn.
+    void report_raster_status(unsigned levels_done);
+
     // Invalidate steps based on a set of parameters changed.
     bool invalidate_state_by_config_options(const std::vector<t_config_option_key> &opt_keys);
 
@@ -230,6 +246,8 @@ private:
     // supports
     using LayerRefs = std::vector<LayerRef>;
     std::map<LevelID, LayerRefs>            m_printer_input;
+    // The keys of m_printer_input in ascending order, indexed by level_id.
+    std::vector<LevelID>                    m_printer_levels;
 
     // The printer itself
     SLAPrinterPtr                           m_printer;
@@ -0,0 +1,218 @@
+#include "ShortestPath.hpp"
+#include "ExtrusionEntity.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace Slic3r {
+
+// Uniform grid over a set of points with about two points per cell, supporting removal of points
+// and a query for the closest point not removed yet. The query searches rings of cells around the query point
+// until the distance of the next ring exceeds the distance of the closest point found.
+class ClosestPointGrid
+{
+public:
+    ClosestPointGrid(const Points &points, ChainTieBreak tie_break) : m_points(points), m_tie_break(tie_break), m_removed(points.size(), false)
+    {
+        std::vector<size_t> indices(points.size());
+        for (size_t i = 0; i < indices.size(); ++ i)
+            indices[i] = i;
+        this->build(indices);
+    }
+
+    void remove(size_t idx)
+    {
+        if (m_removed[idx])
+            return;
+        m_removed[idx] = true;
+        -- m_num_alive;
+        // Rebuild the grid over the remaining points once most of the points were removed,
+        // so that the queries do not wade through the removed points and empty cells.
+        if (m_num_alive * 4 < m_cell_points.size() && m_cell_points.size() > 64) {
+            std::vector<size_t> indices;
+            indices.reserve(m_num_alive);
+            for (size_t idx : m_cell_points)
+                if (! m_removed[idx])
+                    indices.emplace_back(idx);
+            this->build(indices);
+        }
+    }
+
+    // Returns the index of the closest point not removed yet, the points at the same distance are picked by m_tie_break.
+    // Returns size_t(-1) if all the points were removed.
+    size_t closest(const Point &pt) const
+    {
+        size_t idx_min  = size_t(-1);
+        double dist_min = std::numeric_limits<double>::max();
+        if (m_num_alive == 0)
+            return idx_min;
+
+        const int64_t cx = std::max<int64_t>(0, std::min<int64_t>(m_cols - 1, (int64_t(pt(0)) - m_min(0)) / m_cell_size));
+        const int64_t cy = std::max<int64_t>(0, std::min<int64_t>(m_rows - 1, (int64_t(pt(1)) - m_min(1)) / m_cell_size));
+        for (int64_t r = 0;; ++ r) {
+            const int64_t x0 = cx - r;
+            const int64_t x1 = cx + r;
+            const int64_t y0 = cy - r;
+            const int64_t y1 = cy + r;
+            const bool    left   = x0 >= 0;
+            const bool    right  = x1 < m_cols;
+            const bool    bottom = y0 >= 0;
+            const bool    top    = y1 < m_rows;
+            if (! left && ! right && ! bottom && ! top)
+                // All the cells were searched.
+                break;
+            if (idx_min != size_t(-1)) {
+                // Lower bound of the distance of the points outside the cells searched so far, with a safety margin
+                // for the rounding of the squared distances.
+                double bound = std::numeric_limits<double>::max();
+                if (left)
+                    bound = std::min(bound, double(pt(0)) - double(m_min(0) + (x0 + 1) * m_cell_size));
+                if (right)
+                    bound = std::min(bound, double(m_min(0) + x1 * m_cell_size) - double(pt(0)));
+                if (bottom)
+                    bound = std::min(bound, double(pt(1)) - double(m_min(1) + (y0 + 1) * m_cell_size));
+                if (top)
+                    bound = std::min(bound, double(m_min(1) + y1 * m_cell_size) - double(pt(1)));
+                bound -= 1.;
+                if (bound > 0. && bound * bound > dist_min)
+                    break;
+            }
+            auto visit = [this, &pt, &idx_min, &dist_min](int64_t x, int64_t y) {
+                const size_t cell = size_t(y * m_cols + x);
+                for (size_t i = m_cell_start[cell]; i < m_cell_start[cell + 1]; ++ i) {
+                    const size_t idx = m_cell_points[i];
+                    if (m_removed[idx])
+                        continue;
+                    const Point &pt2 = m_points[idx];
+                    const double d   = sqr(double(pt(0)) - double(pt2(0))) + sqr(double(pt(1)) - double(pt2(1)));
+                    if (d < dist_min || (d == dist_min && ((m_tie_break == ctbLowestIndex || d == 0.) ? idx < idx_min : idx > idx_min))) {
+                        dist_min = d;
+                        idx_min  = idx;
+                    }
+                }
+            };
+            for (int64_t y = std::max<int64_t>(y0, 0); y <= std::min<int64_t>(y1, m_rows - 1); ++ y)
+                if (y == y0 || y == y1) {
+                    for (int64_t x = std::max<int64_t>(x0, 0); x <= std::min<int64_t>(x1, m_cols - 1); ++ x)
+                        visit(x, y);
+                } else {
+                    if (left)
+                        visit(x0, y);
+                    if (right)
+                        visit(x1, y);
+                }
+        }
+        return idx_min;
+    }
+
+private:
+    void build(const std::vector<size_t> &indices)
+    {
+        m_num_alive = indices.size();
+        m_cell_points.clear();
+        m_cell_start.assign(1, 0);
+        m_cols = 0;
+        m_rows = 0;
+        if (indices.empty())
+            return;
+
+        m_min = m_points[indices.front()].cast<int64_t>();
+        Vec2i64 max = m_min;
+        for (size_t idx : indices) {
+            const Vec2i64 pt = m_points[idx].cast<int64_t>();
+            m_min = m_min.cwiseMin(pt);
+            max   = max.cwiseMax(pt);
+        }
+        const int64_t width  = max(0) - m_min(0) + 1;
+        const int64_t height = max(1) - m_min(1) + 1;
+        const double  num_cells = std::max(1., 0.5 * double(indices.size()));
+        m_cell_size = std::max<int64_t>(1, int64_t(std::ceil(std::max(
+            std::sqrt(double(width) * double(height) / num_cells),
+            double(std::max(width, height)) / num_cells))));
+        m_cols = (width  + m_cell_size - 1) / m_cell_size;
+        m_rows = (height + m_cell_size - 1) / m_cell_size;
+
+        // Counting sort of the points into the cells.
+        std::vector<size_t> point_cells(indices.size());
+        m_cell_start.assign(size_t(m_cols * m_rows) + 1, 0);
+        for (size_t i = 0; i < indices.size(); ++ i) {
+            const Vec2i64 pt = m_points[indices[i]].cast<int64_t>() - m_min;
+            point_cells[i] = size_t((pt(1) / m_cell_size) * m_cols + pt(0) / m_cell_size);
+            ++ m_cell_start[point_cells[i] + 1];
+        }
+        for (size_t i = 1; i < m_cell_start.size(); ++ i)
+            m_cell_start[i] += m_cell_start[i - 1];
+        m_cell_points.assign(indices.size(), 0);
+        std::vector<size_t> cell_end(m_cell_start.begin(), m_cell_start.end() - 1);
+        for (size_t i = 0; i < indices.size(); ++ i)
+            m_cell_points[cell_end[point_cells[i]] ++] = indices[i];
+    }
+
+    const Points       &m_points;
+    ChainTieBreak       m_tie_break;
+    std::vector<bool>   m_removed;
+    size_t              m_num_alive;
+    Vec2i64             m_min;
+    int64_t             m_cell_size;
+    int64_t             m_cols;
+    int64_t             m_rows;
+    // Indices of points sorted by the cells, the points of a cell start at m_cell_start[cell].
+    std::vector<size_t> m_cell_start;
+    std::vector<size_t> m_cell_points;
+};
+
+std::vector<size_t> chain_points(const Points &points, const Point &start_near, ChainTieBreak tie_break)
+{
+    std::vector<size_t> out;
+    out.reserve(points.size());
+    ClosestPointGrid grid(points, tie_break);
+    Point pt = start_near;
+    for (size_t i = 0; i < points.size(); ++ i) {
+        size_t idx = grid.closest(pt);
+        out.emplace_back(idx);
+        grid.remove(idx);
+        pt = points[idx];
+    }
+    return out;
+}
+
+ChainedSegments chain_segments(const Points &end_points, const std::vector<bool> &can_reverse, const Point &start_near, ChainTieBreak tie_break)
+{
+    assert(end_points.size() == 2 * can_reverse.size());
+    const size_t num_items = can_reverse.size();
+    ChainedSegments out;
+    out.reserve(num_items);
+    ClosestPointGrid grid(end_points, tie_break);
+    for (size_t i = 0; i < num_items; ++ i)
+        if (! can_reverse[i])
+            grid.remove(2 * i + 1);
+    Point pt = start_near;
+    for (size_t i = 0; i < num_items; ++ i) {
+        size_t idx      = grid.closest(pt);
+        size_t item     = idx / 2;
+        bool   reversed = (idx & 1) != 0;
+        out.emplace_back(item, reversed);
+        grid.remove(2 * item);
+        grid.remove(2 * item + 1);
+        pt = end_points[reversed ? 2 * item : 2 * item + 1];
+    }
+    return out;
+}
+
+ChainedSegments chain_extrusion_entities(const std::vector<const ExtrusionEntity*> &entities, const Point &start_near, bool no_reverse)
+{
+    Points            end_points;
+    std::vector<bool> can_reverse;
+    end_points.reserve(2 * entities.size());
+    can_reverse.reserve(entities.size());
+    for (const ExtrusionEntity *entity : entities) {
+        end_points.emplace_back(entity->first_point());
+        end_points.emplace_back(entity->last_point());
+        can_reverse.emplace_back(! no_reverse && entity->can_reverse());
+    }
+    return chain_segments(end_points, can_reverse, start_near);
+}
+
+} // namespace Slic3r
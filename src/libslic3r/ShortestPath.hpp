@@ -0,0 +1,41 @@
+#ifndef slic3r_ShortestPath_hpp_
+#define slic3r_ShortestPath_hpp_
+
+#include "libslic3r.h"
+#include "Point.hpp"
+
+#include <utility>
+#include <vector>
+
+namespace Slic3r {
+
+class ExtrusionEntity;
+
+// Greedy nearest neighbor ordering backed by a uniform grid of the points not visited yet,
+// replacing the linear search for the nearest point, which was quadratic in the number of points.
+
+// Which of the points at the same distance from the query point is picked.
+enum ChainTieBreak {
+    // The highest index wins, of the coincident points the lowest index, as Point::nearest_point_index() picks them.
+    ctbHighestIndex,
+    // The lowest index wins, thus a first point wins over a last point, as PolylineCollection::chained_path_from() expects.
+    ctbLowestIndex,
+};
+
+// Returns the indices of points in the order of a nearest neighbor walk starting at start_near.
+std::vector<size_t> chain_points(const Points &points, const Point &start_near, ChainTieBreak tie_break = ctbHighestIndex);
+
+// Chain of items (paths) with two end points each: end_points[2 * i] is the first and end_points[2 * i + 1]
+// the last point of the i-th item. An item may be entered from its last point, and thus reversed,
+// only if can_reverse[i] is set. Returns the item indices in the order of the walk starting at start_near,
+// each paired with a flag whether the item shall be reversed. Ties are broken by the index of the end point.
+typedef std::vector<std::pair<size_t, bool>> ChainedSegments;
+ChainedSegments chain_segments(const Points &end_points, const std::vector<bool> &can_reverse, const Point &start_near, ChainTieBreak tie_break = ctbHighestIndex);
+
+// Chain of extrusion entities referenced by pointers, so that the entities do not need to be copied to be ordered.
+// Loops and the entities, which cannot be reversed, are entered at their first point only, as are all the entities if no_reverse is set.
+ChainedSegments chain_extrusion_entities(const std::vector<const ExtrusionEntity*> &entities, const Point &start_near, bool no_reverse = false);
+
+} // namespace Slic3r
+
+#endif /* slic3r_ShortestPath_hpp_ */
@@ -0,0 +1,166 @@
+#include "SliceCache.hpp"
+#include "Utils.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/nowide/cstdio.hpp>
+
+namespace Slic3r {
+
+// Bump the version whenever the file layout or the content of the cached slices changes.
+static const char SLICE_CACHE_MAGIC[8] = { 'S', 'L', '3', 'R', 'S', 'L', 'C', '1' };
+
+void SliceCache::Key::append(const void *data, size_t size)
+{
+    const unsigned char *p = (const unsigned char*)data;
+    for (size_t i = 0; i < size; ++ i) {
+        m_value ^= p[i];
+        m_value *= 0x100000001b3ULL;
+    }
+}
+
+std::string SliceCache::path(uint64_t key) const
+{
+    return (boost::filesystem::path(m_dir) / (boost::format("%016x.slices") % key).str()).string();
+}
+
+// Sequential reader of the cache file content, failing on truncated data.
+class SliceCacheReader
+{
+public:
+    SliceCacheReader(const std::vector<char> &data) : m_ptr(data.data()), m_end(data.data() + data.size()) {}
+
+    bool read(void *dst, size_t size) {
+        if (size_t(m_end - m_ptr) < size)
+            return false;
+        memcpy(dst, m_ptr, size);
+        m_ptr += size;
+        return true;
+    }
+    bool read(uint32_t &value) { return this->read(&value, sizeof(value)); }
+    bool read(Polygon &polygon) {
+        uint32_t num_points;
+        if (! this->read(num_points) || size_t(m_end - m_ptr) / (2 * sizeof(int32_t)) < num_points)
+            return false;
+        polygon.points.assign(num_points, Point());
+        for (Point &pt : polygon.points) {
+            int32_t xy[2];
+            this->read(xy, sizeof(xy));
+            pt = Point(xy[0], xy[1]);
+        }
+        return true;
+    }
+    bool at_end() const { return m_ptr == m_end; }
+
+private:
+    const char *m_ptr;
+    const char *m_end;
+};
+
+static void append_polygon(std::vector<char> &out, const Polygon &polygon)
+{
+    uint32_t num_points = uint32_t(polygon.points.size());
+    out.insert(out.end(), (const char*)&num_points, (const char*)(&num_points + 1));
+    for (const Point &pt : polygon.points) {
+        int32_t xy[2] = { int32_t(pt(0)), int32_t(pt(1)) };
+        out.insert(out.end(), (const char*)xy, (const char*)(xy + 2));
+    }
+}
+
+bool SliceCache::load(uint64_t key, Slices &slices) const
+{
+    if (m_dir.empty())
+        return false;
+
+    std::vector<char> data;
+    {
+        std::string path = this->path(key);
+        FILE *file = boost::nowide::fopen(path.c_str(), "rb");
+        if (file == nullptr)
+            return false;
+        char buf[65536];
+        for (size_t len; (len = fread(buf, 1, sizeof(buf), file)) > 0;)
+            data.insert(data.end(), buf, buf + len);
+        fclose(file);
+    }
+
+    SliceCacheReader reader(data);
+    char     magic[sizeof(SLICE_CACHE_MAGIC)];
+    uint64_t file_key;
+    uint32_t num_layers, num_regions;
+    if (! reader.read(magic, sizeof(magic)) || memcmp(magic, SLICE_CACHE_MAGIC, sizeof(magic)) != 0 ||
+        ! reader.read(&file_key, sizeof(file_key)) || file_key != key ||
+        ! reader.read(num_layers) || ! reader.read(num_regions))
+        return false;
+
+    Slices out(num_layers, std::vector<ExPolygons>(num_regions));
+    for (std::vector<ExPolygons> &layer : out)
+        for (ExPolygons &expolygons : layer) {
+            uint32_t num_expolygons;
+            if (! reader.read(num_expolygons))
+                return false;
+            expolygons.reserve(std::min<size_t>(num_expolygons, data.size()));
+            for (uint32_t i = 0; i < num_expolygons; ++ i) {
+                ExPolygon expoly;
+                uint32_t  num_holes;
+                if (! reader.read(expoly.contour) || ! reader.read(num_holes))
+                    return false;
+                for (uint32_t j = 0; j < num_holes; ++ j) {
+                    expoly.holes.emplace_back();
+                    if (! reader.read(expoly.holes.back()))
+                        return false;
+                }
+                expolygons.emplace_back(std::move(expoly));
+            }
+        }
+    if (! reader.at_end())
+        return false;
+
+    slices = std::move(out);
+    return true;
+}
+
+void SliceCache::store(uint64_t key, const Slices &slices) const
+{
+    if (m_dir.empty())
+        return;
+
+    std::vector<char> data(SLICE_CACHE_MAGIC, SLICE_CACHE_MAGIC + sizeof(SLICE_CACHE_MAGIC));
+    auto append = [&data](uint32_t value) { data.insert(data.end(), (const char*)&value, (const char*)(&value + 1)); };
+    data.insert(data.end(), (const char*)&key, (const char*)(&key + 1));
+    append(uint32_t(slices.size()));
+    append(uint32_t(slices.empty() ? 0 : slices.front().size()));
+    for (const std::vector<ExPolygons> &layer : slices)
+        for (const ExPolygons &expolygons : layer) {
+            append(uint32_t(expolygons.size()));
+            for (const ExPolygon &expoly : expolygons) {
+                append_polygon(data, expoly.contour);
+                append(uint32_t(expoly.holes.size()));
+                for (const Polygon &hole : expoly.holes)
+                    append_polygon(data, hole);
+            }
+        }
+
+    std::string path = this->path(key);
+    try {
+        boost::filesystem::create_directories(m_dir);
+        std::string path_tmp = path + "." + boost::filesystem::unique_path().string() + ".tmp";
+        FILE *file = boost::nowide::fopen(path_tmp.c_str(), "wb");
+        if (file == nullptr)
+            throw std::runtime_error("Cannot open file for writing");
+        bool written = fwrite(data.data(), 1, data.size(), file) == data.size();
+        written &= fclose(file) == 0;
+        if (! written || rename_file(path_tmp, path) != 0) {
+            boost::filesystem::remove(path_tmp);
+            throw std::runtime_error("Cannot write file");
+        }
+    } catch (const std::exception &ex) {
+        BOOST_LOG_TRIVIAL(warning) << "Slice cache: failed to store " << path << ": " << ex.what();
+    }
+}
+
+} // namespace Slic3r
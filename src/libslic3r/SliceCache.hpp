@@ -0,0 +1,57 @@
+#ifndef slic3r_SliceCache_hpp_
+#define slic3r_SliceCache_hpp_
+
+#include <string>
+#include <vector>
+
+#include "libslic3r.h"
+#include "ExPolygon.hpp"
+
+namespace Slic3r {
+
+// Content addressed on-disk store of the PrintObject slices, surviving the slicer process.
+// Repeated command line runs over the same meshes with the same slicing parameters (parameter sweeps,
+// print farms re-slicing a part with a different infill) read back the sliced and compensated region slices
+// instead of slicing the meshes again. The cache directory may be shared by multiple slicer processes.
+class SliceCache
+{
+public:
+    // Incremental 64bit FNV-1a hash of the input of the slicing step.
+    class Key
+    {
+    public:
+        void        append(const void *data, size_t size);
+        template<typename T>
+        void        append(const T &value) { this->append(&value, sizeof(T)); }
+        void        append(const std::string &str) { this->append(str.size()); this->append(str.data(), str.size()); }
+        uint64_t    value() const { return m_value; }
+
+    private:
+        uint64_t    m_value = 0xcbf29ce484222325ULL;
+    };
+
+    // Slices indexed by [layer][region].
+    typedef std::vector<std::vector<ExPolygons>> Slices;
+
+    SliceCache() {}
+    explicit SliceCache(const std::string &dir) : m_dir(dir) {}
+
+    // Caching is disabled if no directory is set.
+    bool                empty() const { return m_dir.empty(); }
+    const std::string&  dir() const { return m_dir; }
+
+    // Returns false if there is no valid entry for the key.
+    bool                load(uint64_t key, Slices &slices) const;
+    // Writes a temporary file, which is then renamed to the final name, so that a concurrently running
+    // slicer never reads a partially written entry. Failing to write into the cache is not an error.
+    void                store(uint64_t key, const Slices &slices) const;
+
+private:
+    std::string         path(uint64_t key) const;
+
+    std::string         m_dir;
+};
+
+} // namespace Slic3r
+
+#endif /* slic3r_SliceCache_hpp_ */
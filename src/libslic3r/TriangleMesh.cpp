@@ -18,6 +18,7 @@
 #include <boost/log/trivial.hpp>
 
 #include <tbb/parallel_for.h>
+#include <tbb/enumerable_thread_specific.h>
 
 #include <Eigen/Dense>
 
@@ -485,14 +486,21 @@ const float* TriangleMesh::first_vertex() const
     return this->stl.facet_start ? &this->stl.facet_start->vertex[0](0) : nullptr;
 }
 
-Polygon TriangleMesh::convex_hull()
+Polygon TriangleMesh::convex_hull() const
 {
-    this->require_shared_vertices();
     Points pp;
-    pp.reserve(this->stl.stats.shared_vertices);
-    for (int i = 0; i < this->stl.stats.shared_vertices; ++ i) {
-        const stl_vertex &v = this->stl.v_shared[i];
-        pp.emplace_back(Point::new_scale(v(0), v(1)));
+    if (this->stl.v_shared != nullptr && this->stl.stats.shared_vertices > 0) {
+        pp.reserve(this->stl.stats.shared_vertices);
+        for (int i = 0; i < this->stl.stats.shared_vertices; ++ i) {
+            const stl_vertex &v = this->stl.v_shared[i];
+            pp.emplace_back(Point::new_scale(v(0), v(1)));
+        }
+    } else {
+        // Don't generate the shared vertices, this mesh may be shared by multiple threads (see ModelVolume::mesh()).
+        pp.reserve(3 * this->stl.stats.number_of_facets);
+        for (uint32_t i = 0; i < this->stl.stats.number_of_facets; ++ i)
+            for (const stl_vertex &v : this->stl.facet_start[i].vertex)
+                pp.emplace_back(Point::new_scale(v(0), v(1)));
     }
     return Slic3r::Geometry::convex_hull(pp);
 }
@@ -508,20 +516,17 @@ BoundingBoxf3 TriangleMesh::bounding_box() const
 
 BoundingBoxf3 TriangleMesh::transformed_bounding_box(const Transform3d& t) const
 {
-    bool has_shared = (stl.v_shared != nullptr);
-    if (!has_shared)
-        stl_generate_shared_vertices(&stl);
-
-    unsigned int vertices_count = (stl.stats.shared_vertices > 0) ? (unsigned int)stl.stats.shared_vertices : 3 * (unsigned int)stl.stats.number_of_facets;
+    // Don't generate the shared vertices if missing, this mesh may be shared by multiple threads (see ModelVolume::mesh()).
+    bool has_shared = stl.v_shared != nullptr && stl.stats.shared_vertices > 0;
+    unsigned int vertices_count = has_shared ? (unsigned int)stl.stats.shared_vertices : 3 * (unsigned int)stl.stats.number_of_facets;
 
     if (vertices_count == 0)
         return BoundingBoxf3();
 
     Eigen::MatrixXd src_vertices(3, vertices_count);
 
-    if (stl.stats.shared_vertices > 0)
+    if (has_shared)
     {
-		assert(stl.v_shared != nullptr);
         stl_vertex* vertex_ptr = stl.v_shared;
         for (int i = 0; i < stl.stats.shared_vertices; ++i)
         {
@@ -548,9 +553,6 @@ BoundingBoxf3 TriangleMesh::transformed_bounding_box(const Transform3d& t) const
         }
     }
 
-    if (!has_shared && (stl.stats.shared_vertices > 0))
-        stl_invalidate_shared_vertices(&stl);
-
     Eigen::MatrixXd dst_vertices(3, vertices_count);
     dst_vertices = t * src_vertices.colwise().homogeneous();
 
@@ -774,14 +776,40 @@ void TriangleMeshSlicer::slice(const std::vector<float> &z, std::vector<Polygons
     BOOST_LOG_TRIVIAL(debug) << "TriangleMeshSlicer::_slice_do";
     std::vector<IntersectionLines> lines(z.size());
     {
-        boost::mutex lines_mutex;
+        // Each worker thread collects its intersection lines into its own set of per-layer buckets,
+        // so that no locking is needed while slicing the facets. The buckets are merged per layer below.
+        tbb::enumerable_thread_specific<std::vector<IntersectionLines>> lines_per_thread(
+            [&z]() { return std::vector<IntersectionLines>(z.size()); });
         tbb::parallel_for(
             tbb::blocked_range<int>(0,this->mesh->stl.stats.number_of_facets),
-            [&lines, &lines_mutex, &z, throw_on_cancel, this](const tbb::blocked_range<int>& range) {
+            [&lines_per_thread, &z, throw_on_cancel, this](const tbb::blocked_range<int>& range) {
+                std::vector<IntersectionLines> &lines_local = lines_per_thread.local();
                 for (int facet_idx = range.begin(); facet_idx < range.end(); ++ facet_idx) {
                     if ((facet_idx & 0x0ffff) == 0)
                         throw_on_cancel();
-                    this->_slice_do(facet_idx, &lines, &lines_mutex, z);
+                    this->_slice_do(facet_idx, &lines_local, z);
+                }
+            }
+        );
+        throw_on_cancel();
+
+        // Merge the thread local buckets, one layer at a time.
+        BOOST_LOG_TRIVIAL(debug) << "TriangleMeshSlicer::slice - merging intersection lines";
+        tbb::parallel_for(
+            tbb::blocked_range<size_t>(0, z.size()),
+            [&lines, &lines_per_thread](const tbb::blocked_range<size_t>& range) {
+                for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
+                    size_t num_lines = 0;
+                    for (const std::vector<IntersectionLines> &lines_local : lines_per_thread)
+                        num_lines += lines_local[layer_idx].size();
+                    IntersectionLines &dst = lines[layer_idx];
+                    dst.reserve(num_lines);
+                    for (std::vector<IntersectionLines> &lines_local : lines_per_thread) {
+                        IntersectionLines &src = lines_local[layer_idx];
+                        dst.insert(dst.end(), src.begin(), src.end());
+                        // Release the memory of the thread local bucket as soon as possible.
+                        IntersectionLines().swap(src);
+                    }
                 }
             }
         );
@@ -839,8 +867,7 @@ void TriangleMeshSlicer::slice(const std::vector<float> &z, std::vector<Polygons
 #endif
 }
 
-void TriangleMeshSlicer::_slice_do(size_t facet_idx, std::vector<IntersectionLines>* lines, boost::mutex* lines_mutex, 
-    const std::vector<float> &z) const
+void TriangleMeshSlicer::_slice_do(size_t facet_idx, std::vector<IntersectionLines>* lines, const std::vector<float> &z) const
 {
     const stl_facet &facet = this->mesh->stl.facet_start[facet_idx];
     
@@ -868,7 +895,6 @@ void TriangleMeshSlicer::_slice_do(size_t facet_idx, std::vector<IntersectionLin
         std::vector<float>::size_type layer_idx = it - z.begin();
         IntersectionLine il;
         if (this->slice_facet(*it / SCALING_FACTOR, facet, facet_idx, min_z, max_z, &il) == TriangleMeshSlicer::Slicing) {
-            boost::lock_guard<boost::mutex> l(*lines_mutex);
             if (il.edge_type == feHorizontal) {
                 // Insert all marked edges of the face. The marked edges do not share an edge with another horizontal face
                 // (they may not have a nighbor, or their neighbor is vertical)
@@ -56,7 +56,7 @@ public:
     void merge(const TriangleMesh &mesh);
     ExPolygons horizontal_projection() const;
     const float* first_vertex() const;
-    Polygon convex_hull();
+    Polygon convex_hull() const;
     BoundingBoxf3 bounding_box() const;
     // Returns the bbox of this TriangleMesh transformed by the given transformation
     BoundingBoxf3 transformed_bounding_box(const Transform3d& t) const;
@@ -82,6 +82,33 @@ private:
     friend class TriangleMeshSlicer;
 };
 
+// Read only access to the indexed (shared) vertices of a repaired mesh.
+// If the mesh does not have the shared vertices yet, they are generated into a private copy of the stl_file header,
+// so that the mesh, which may be shared between several ModelVolumes, is not modified.
+class TriangleMeshSharedVertices
+{
+public:
+    explicit TriangleMeshSharedVertices(const TriangleMesh &mesh) : m_stl(mesh.stl), m_owned(mesh.stl.v_shared == nullptr)
+    {
+        if (m_owned) {
+            // The facets and neighbors are only read by stl_generate_shared_vertices().
+            m_stl.v_indices = nullptr;
+            m_stl.v_shared  = nullptr;
+            stl_generate_shared_vertices(&m_stl);
+        }
+    }
+    ~TriangleMeshSharedVertices() { if (m_owned) stl_invalidate_shared_vertices(&m_stl); }
+
+    const stl_file& stl() const { return m_stl; }
+
+private:
+    TriangleMeshSharedVertices(const TriangleMeshSharedVertices &) = delete;
+    TriangleMeshSharedVertices& operator=(const TriangleMeshSharedVertices &) = delete;
+
+    stl_file m_stl;
+    bool     m_owned;
+};
+
 enum FacetEdgeType { 
     // A general case, the cutting plane intersect a face at two different edges.
     feGeneral,
@@ -181,7 +208,8 @@ private:
     // Scaled copy of this->mesh->stl.v_shared
     std::vector<stl_vertex>  v_scaled_shared;
 
-    void _slice_do(size_t facet_idx, std::vector<IntersectionLines>* lines, boost::mutex* lines_mutex, const std::vector<float> &z) const;
+    // Slice a single facet, store the intersection lines into per layer buckets of lines (not thread safe, lines shall be thread local).
+    void _slice_do(size_t facet_idx, std::vector<IntersectionLines>* lines, const std::vector<float> &z) const;
     void make_loops(std::vector<IntersectionLine> &lines, Polygons* loops) const;
     void make_expolygons(const Polygons &loops, ExPolygons* slices) const;
     void make_expolygons_simple(std::vector<IntersectionLine> &lines, ExPolygons* slices) const;
@@ -85,14 +85,14 @@ inline T unscale(Q v) { return T(v) * T(SCALING_FACTOR); }
 
 enum Axis { X=0, Y, Z, E, F, NUM_AXES };
 
-template <class T>
-inline void append_to(std::vector<T> &dst, const std::vector<T> &src)
+template <class T, class Alloc>
+inline void append_to(std::vector<T, Alloc> &dst, const std::vector<T, Alloc> &src)
 {
     dst.insert(dst.end(), src.begin(), src.end());
 }
 
-template <typename T>
-inline void append(std::vector<T>& dest, const std::vector<T>& src)
+template <typename T, typename Alloc>
+inline void append(std::vector<T, Alloc>& dest, const std::vector<T, Alloc>& src)
 {
     if (dest.empty())
         dest = src;
@@ -100,8 +100,8 @@ inline void append(std::vector<T>& dest, const std::vector<T>& src)
         dest.insert(dest.end(), src.begin(), src.end());
 }
 
-template <typename T>
-inline void append(std::vector<T>& dest, std::vector<T>&& src)
+template <typename T, typename Alloc>
+inline void append(std::vector<T, Alloc>& dest, std::vector<T, Alloc>&& src)
 {
     if (dest.empty())
         dest = std::move(src);
@@ -130,8 +130,8 @@ inline void remove_nulls(std::vector<T*> &vec)
     	vec.end());
 }
 
-template <typename T>
-inline void sort_remove_duplicates(std::vector<T> &vec)
+template <typename T, typename Alloc>
+inline void sort_remove_duplicates(std::vector<T, Alloc> &vec)
 {
 	std::sort(vec.begin(), vec.end());
 	vec.erase(std::unique(vec.begin(), vec.end()), vec.end());
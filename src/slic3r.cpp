@@ -12,15 +12,22 @@
     __declspec(dllexport) int AmdPowerXpressRequestHighPerformance = 1;
 #endif /* WIN32 */
 
+#include <algorithm>
+#include <chrono>
 #include <cstdio>
 #include <string>
 #include <cstring>
 #include <iostream>
+#include <mutex>
+#include <thread>
 #include <math.h>
+#include <boost/algorithm/string/trim.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/format.hpp>
 #include <boost/nowide/args.hpp>
 #include <boost/nowide/cenv.hpp>
 #include <boost/nowide/iostream.hpp>
+#include <boost/tokenizer.hpp>
 
 #include "libslic3r/libslic3r.h"
 #include "libslic3r/Config.hpp"
@@ -40,6 +47,183 @@ using namespace Slic3r;
 /// utility function for displaying CLI usage
 void printUsage();
 
+// Reads the input files and applies the command line transformations.
+// Returns false if an input file could not be read.
+static bool load_models(const t_config_option_keys &input_files, const CLIConfig &cli_config, DynamicPrintConfig &print_config, std::vector<Model> &models)
+{
+    for (const t_config_option_key &file : input_files) {
+        if (! boost::filesystem::exists(file)) {
+            boost::nowide::cerr << "No such file: " << file << std::endl;
+            return false;
+        }
+        Model model;
+        try {
+            model = Model::read_from_file(file, &print_config, true);
+        } catch (std::exception &e) {
+            boost::nowide::cerr << file << ": " << e.what() << std::endl;
+            return false;
+        }
+        if (model.objects.empty()) {
+            boost::nowide::cerr << "Error: file is empty: " << file << std::endl;
+            continue;
+        }
+        model.add_default_instances();        
+        // apply command line transform options
+        for (ModelObject* o : model.objects) {
+/*
+            if (cli_config.scale_to_fit.is_positive_volume())
+                o->scale_to_fit(cli_config.scale_to_fit.value);
+*/
+            // TODO: honor option order?
+            o->scale(cli_config.scale.value);
+            o->rotate(Geometry::deg2rad(cli_config.rotate_x.value), X);
+            o->rotate(Geometry::deg2rad(cli_config.rotate_y.value), Y);
+            o->rotate(Geometry::deg2rad(cli_config.rotate.value), Z);
+        }
+        // TODO: handle --merge
+        models.push_back(model);
+    }
+    return true;
+}
+
+// Arranges and slices the model, exports the G-code.
+// Returns an error message if the print is not valid, an empty string otherwise.
+static std::string slice_model(Model &model, const CLIConfig &cli_config, DynamicPrintConfig print_config)
+{
+    PrinterTechnology printer_technology = print_config.option<ConfigOptionEnum<PrinterTechnology>>("printer_technology", true)->value;
+    std::string outfile = cli_config.output.value;
+    Print       fff_print;
+    SLAPrint    sla_print;
+    PrintBase  *print = (printer_technology == ptFFF) ? static_cast<PrintBase*>(&fff_print) : static_cast<PrintBase*>(&sla_print);
+    if (! cli_config.dont_arrange) {
+        //FIXME make the min_object_distance configurable.
+        model.arrange_objects(fff_print.config().min_object_distance());
+        model.center_instances_around_point(cli_config.print_center);
+    }
+    if (outfile.empty()) {
+        outfile = model.propose_export_file_name();
+        outfile += (printer_technology == ptFFF) ? ".gcode" : ".zip";
+    }
+    if (printer_technology == ptFFF) {
+        for (auto* mo : model.objects)
+            fff_print.auto_assign_extruders(mo);
+        fff_print.set_slice_cache_dir(cli_config.slice_cache.value);
+    }
+    print_config.normalize();
+    print->apply(model, print_config);
+    std::string err = print->validate();
+    if (err.empty()) {
+        if (printer_technology == ptFFF) {
+            fff_print.export_gcode(outfile, nullptr);
+        } else {
+            assert(printer_technology == ptSLA);
+			//FIXME add the output here
+        }
+    }
+    return err;
+}
+
+// Slices a single job of the batch mode. The job is a command line with input files and options,
+// the options override the command line options and configuration of the batch process.
+// Returns an error message, an empty string on success.
+static std::string run_batch_job(const std::string &job, const CLIConfig &batch_cli_config, const DynamicPrintConfig &batch_print_config)
+{
+    // Split the job into arguments, double quotes enclose arguments containing spaces.
+    // There is no escape character, so that the backslashes of Windows paths are kept.
+    std::vector<std::string> args { "slic3r" };
+    typedef boost::tokenizer<boost::escaped_list_separator<char>> Tokenizer;
+    for (const std::string &arg : Tokenizer(job, boost::escaped_list_separator<char>("", " ", "\"")))
+        if (! arg.empty())
+            args.emplace_back(arg);
+    std::vector<char*> argv;
+    for (std::string &arg : args)
+        argv.emplace_back(&arg.front());
+
+    DynamicPrintAndCLIConfig config;
+    t_config_option_keys input_files;
+    if (! config.read_cli(int(argv.size()), argv.data(), &input_files))
+        return "Invalid command line";
+    if (input_files.empty())
+        return "No input files";
+
+    CLIConfig cli_config = batch_cli_config;
+    // The config files of the batch process have already been loaded into batch_print_config.
+    cli_config.load.values.clear();
+    // The jobs run concurrently, they shall not export to the output file of the batch process.
+    // A job without its own --output exports next to its input file.
+    cli_config.output.value.clear();
+    cli_config.apply(config, true);
+    DynamicPrintConfig print_config = batch_print_config;
+    for (const std::string &file : cli_config.load.values) {
+        DynamicPrintConfig c;
+        c.load(file);
+        c.normalize();
+        print_config.apply(c);
+    }
+    print_config.apply(config, true);
+
+    std::vector<Model> models;
+    if (! load_models(input_files, cli_config, print_config, models))
+        return "Failed to read the input files";
+    for (Model &model : models) {
+        std::string err = slice_model(model, cli_config, print_config);
+        if (! err.empty())
+            return err;
+    }
+    return std::string();
+}
+
+// Batch mode: Slices the jobs read from the standard input line by line in a single process,
+// saving the process start-up and initialization for each job. Up to cli_config.batch_jobs jobs are sliced
+// concurrently, each of them being parallelized further by TBB.
+// Returns the exit code of the process, non-zero if any job failed.
+static int run_batch(const CLIConfig &cli_config, const DynamicPrintConfig &print_config)
+{
+    std::mutex  input_mutex;
+    std::mutex  output_mutex;
+    size_t      num_jobs   = 0;
+    size_t      num_failed = 0;
+
+    auto worker = [&]() {
+        for (;;) {
+            std::string job;
+            size_t      job_id;
+            {
+                std::lock_guard<std::mutex> lock(input_mutex);
+                do {
+                    if (! std::getline(boost::nowide::cin, job))
+                        return;
+                    boost::trim(job);
+                } while (job.empty());
+                job_id = ++ num_jobs;
+            }
+            auto        t_start = std::chrono::steady_clock::now();
+            std::string err;
+            try {
+                err = run_batch_job(job, cli_config, print_config);
+            } catch (const std::exception &ex) {
+                err = ex.what();
+            }
+            double      t_job = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+            std::replace(err.begin(), err.end(), '\n', ' ');
+            std::lock_guard<std::mutex> lock(output_mutex);
+            if (err.empty())
+                boost::nowide::cout << "job " << job_id << " done " << (boost::format("%.3f") % t_job).str() << "s" << std::endl;
+            else {
+                ++ num_failed;
+                boost::nowide::cout << "job " << job_id << " failed " << (boost::format("%.3f") % t_job).str() << "s: " << err << std::endl;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < std::max(1, cli_config.batch_jobs.value); ++ i)
+        threads.emplace_back(worker);
+    for (std::thread &thread : threads)
+        thread.join();
+    return (num_failed == 0) ? 0 : 1;
+}
+
 #ifdef _MSC_VER
 int slic3r_main_(int argc, char **argv)
 #else
@@ -136,40 +320,13 @@ int main(int argc, char **argv)
         return 0;
     }
 
+    if (cli_config.batch)
+        return run_batch(cli_config, print_config);
+
     // read input file(s) if any
     std::vector<Model> models;
-    for (const t_config_option_key &file : input_files) {
-        if (! boost::filesystem::exists(file)) {
-            boost::nowide::cerr << "No such file: " << file << std::endl;
-            exit(1);
-        }
-        Model model;
-        try {
-            model = Model::read_from_file(file, &print_config, true);
-        } catch (std::exception &e) {
-            boost::nowide::cerr << file << ": " << e.what() << std::endl;
-            exit(1);
-        }
-        if (model.objects.empty()) {
-            boost::nowide::cerr << "Error: file is empty: " << file << std::endl;
-            continue;
-        }
-        model.add_default_instances();        
-        // apply command line transform options
-        for (ModelObject* o : model.objects) {
-/*
-            if (cli_config.scale_to_fit.is_positive_volume())
-                o->scale_to_fit(cli_config.scale_to_fit.value);
-*/
-            // TODO: honor option order?
-            o->scale(cli_config.scale.value);
-            o->rotate(Geometry::deg2rad(cli_config.rotate_x.value), X);
-            o->rotate(Geometry::deg2rad(cli_config.rotate_y.value), Y);
-            o->rotate(Geometry::deg2rad(cli_config.rotate.value), Z);
-        }
-        // TODO: handle --merge
-        models.push_back(model);
-    }
+    if (! load_models(input_files, cli_config, print_config, models))
+        exit(1);
 
     for (Model &model : models) {
         if (cli_config.info) {
@@ -207,35 +364,8 @@ int main(int argc, char **argv)
                 //     lower.mesh().write_binary((outfile + "_lower.stl").c_str());
             }
         } else if (cli_config.slice) {
-            PrinterTechnology printer_technology = print_config.option<ConfigOptionEnum<PrinterTechnology>>("printer_technology", true)->value;
-            std::string outfile = cli_config.output.value;
-            Print       fff_print;
-            SLAPrint    sla_print;
-            PrintBase  *print = (printer_technology == ptFFF) ? static_cast<PrintBase*>(&fff_print) : static_cast<PrintBase*>(&sla_print);
-            if (! cli_config.dont_arrange) {
-                //FIXME make the min_object_distance configurable.
-                model.arrange_objects(fff_print.config().min_object_distance());
-                model.center_instances_around_point(cli_config.print_center);
-            }
-            if (outfile.empty()) {
-                outfile = model.propose_export_file_name();
-                outfile += (printer_technology == ptFFF) ? ".gcode" : ".zip";
-            }
-            if (printer_technology == ptFFF) {
-                for (auto* mo : model.objects)
-                    fff_print.auto_assign_extruders(mo);
-            }
-            print_config.normalize();
-            print->apply(model, print_config);
-            std::string err = print->validate();
-            if (err.empty()) {
-                if (printer_technology == ptFFF) {
-                    fff_print.export_gcode(outfile, nullptr);
-                } else {
-                    assert(printer_technology == ptSLA);
-					//FIXME add the output here
-                }
-            } else
+            std::string err = slice_model(model, cli_config, print_config);
+            if (! err.empty())
                 std::cerr << err << "\n";
         } else {
             boost::nowide::cerr << "error: command not supported" << std::endl;
@@ -781,9 +781,9 @@ int GLVolumeCollection::load_object_volume(
     const int            extruder_id  = model_volume->extruder_id();
     const ModelInstance *instance     = model_object->instances[instance_idx];
 #if ENABLE_MODELVOLUME_TRANSFORM
-    const TriangleMesh& mesh = model_volume->mesh;
+    const TriangleMesh& mesh = model_volume->mesh();
 #else
-    TriangleMesh mesh = model_volume->mesh;
+    TriangleMesh mesh = model_volume->mesh();
 #endif // ENABLE_MODELVOLUME_TRANSFORM
     float color[4];
     memcpy(color, colors[((color_by == "volume") ? volume_idx : obj_idx) % 4], sizeof(float) * 3);
@@ -6998,12 +6998,10 @@ void GLCanvas3D::_load_gcode_extrusion_paths(const GCodePreviewData& preview_dat
     {
         float value;
         ExtrusionRole role;
-        GLVolume* volume;
 
         Filter(float value, ExtrusionRole role)
             : value(value)
             , role(role)
-            , volume(nullptr)
         {
         }
 
@@ -7020,11 +7018,11 @@ void GLCanvas3D::_load_gcode_extrusion_paths(const GCodePreviewData& preview_dat
     };
 
     typedef std::vector<Filter> FiltersList;
-    size_t initial_volumes_count = m_volumes.volumes.size();
+    const GCodePreviewData::Extrusion::LayersList& layers = preview_data.extrusion.layers;
 
     // detects filters
     FiltersList filters;
-    for (const GCodePreviewData::Extrusion::Layer& layer : preview_data.extrusion.layers)
+    for (const GCodePreviewData::Extrusion::Layer& layer : layers)
     {
         for (const ExtrusionPath& path : layer.paths)
         {
@@ -7039,62 +7037,67 @@ void GLCanvas3D::_load_gcode_extrusion_paths(const GCodePreviewData& preview_dat
     if (filters.empty())
         return;
 
-    // creates a new volume for each filter
-    for (Filter& filter : filters)
+    std::vector<GCodePreviewData::Color> filter_colors;
+    for (const Filter& filter : filters)
     {
-        m_gcode_preview_volume_index.first_volumes.emplace_back(GCodePreviewVolumeIndex::Extrusion, (unsigned int)filter.role, (unsigned int)m_volumes.volumes.size());
-        GLVolume* volume = new GLVolume(Helper::path_color(preview_data, tool_colors, filter.value).rgba);
-        if (volume != nullptr)
-        {
-            filter.volume = volume;
-            volume->is_extrusion_path = true;
-            m_volumes.volumes.emplace_back(volume);
-        }
-        else
+        filter_colors.emplace_back(Helper::path_color(preview_data, tool_colors, filter.value));
+    }
+
+    // populates volumes in parallel, each chunk of layers fills its own volume for each of the filters
+    BOOST_LOG_TRIVIAL(debug) << "Loading G-code extrusion paths in parallel - start";
+    size_t chunks_count = std::min<size_t>(layers.size(), 64);
+    std::vector<std::vector<GLVolume*>> chunk_volumes(chunks_count, std::vector<GLVolume*>(filters.size(), nullptr));
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, chunks_count, 1),
+        [&preview_data, &layers, &filters, &filter_colors, &chunk_volumes, chunks_count](const tbb::blocked_range<size_t>& range) {
+        for (size_t chunk = range.begin(); chunk < range.end(); ++chunk)
         {
-            // an error occourred - restore to previous state and return
-            m_gcode_preview_volume_index.first_volumes.pop_back();
-            if (initial_volumes_count != m_volumes.volumes.size())
+            std::vector<GLVolume*>& volumes = chunk_volumes[chunk];
+            for (size_t layer_id = chunk * layers.size() / chunks_count; layer_id < (chunk + 1) * layers.size() / chunks_count; ++layer_id)
             {
-                GLVolumePtrs::iterator begin = m_volumes.volumes.begin() + initial_volumes_count;
-                GLVolumePtrs::iterator end = m_volumes.volumes.end();
-                for (GLVolumePtrs::iterator it = begin; it < end; ++it)
+                const GCodePreviewData::Extrusion::Layer& layer = layers[layer_id];
+                for (const ExtrusionPath& path : layer.paths)
                 {
-                    GLVolume* volume = *it;
-                    delete volume;
+                    float path_filter = Helper::path_filter(preview_data.extrusion.view_type, path);
+                    size_t filter_id = std::find(filters.begin(), filters.end(), Filter(path_filter, path.role())) - filters.begin();
+                    if (filter_id == filters.size())
+                        continue;
+
+                    if (volumes[filter_id] == nullptr)
+                    {
+                        volumes[filter_id] = new GLVolume(filter_colors[filter_id].rgba);
+                        volumes[filter_id]->is_extrusion_path = true;
+                    }
+
+                    GLVolume& volume = *volumes[filter_id];
+                    volume.print_zs.push_back(layer.z);
+                    volume.offsets.push_back(volume.indexed_vertex_array.quad_indices.size());
+                    volume.offsets.push_back(volume.indexed_vertex_array.triangle_indices.size());
+
+                    _3DScene::extrusionentity_to_verts(path, layer.z, volume);
                 }
-                m_volumes.volumes.erase(begin, end);
-                return;
             }
-        }
-    }
 
-    // populates volumes
-    for (const GCodePreviewData::Extrusion::Layer& layer : preview_data.extrusion.layers)
-    {
-        for (const ExtrusionPath& path : layer.paths)
-        {
-            float path_filter = Helper::path_filter(preview_data.extrusion.view_type, path);
-            FiltersList::iterator filter = std::find(filters.begin(), filters.end(), Filter(path_filter, path.role()));
-            if (filter != filters.end())
+            for (GLVolume* volume : volumes)
             {
-                filter->volume->print_zs.push_back(layer.z);
-                filter->volume->offsets.push_back(filter->volume->indexed_vertex_array.quad_indices.size());
-                filter->volume->offsets.push_back(filter->volume->indexed_vertex_array.triangle_indices.size());
-
-                _3DScene::extrusionentity_to_verts(path, layer.z, *filter->volume);
+                if (volume != nullptr)
+                    volume->bounding_box = volume->indexed_vertex_array.bounding_box();
             }
         }
-    }
+    });
+    BOOST_LOG_TRIVIAL(debug) << "Loading G-code extrusion paths in parallel - end";
 
-    // finalize volumes and sends geometry to gpu
-    if (m_volumes.volumes.size() > initial_volumes_count)
+    // stores the volumes of each filter contiguously, ordered by layers, and sends geometry to gpu
+    for (size_t filter_id = 0; filter_id < filters.size(); ++filter_id)
     {
-        for (size_t i = initial_volumes_count; i < m_volumes.volumes.size(); ++i)
+        m_gcode_preview_volume_index.first_volumes.emplace_back(GCodePreviewVolumeIndex::Extrusion, (unsigned int)filters[filter_id].role, (unsigned int)m_volumes.volumes.size());
+        for (std::vector<GLVolume*>& volumes : chunk_volumes)
         {
-            GLVolume* volume = m_volumes.volumes[i];
-            volume->bounding_box = volume->indexed_vertex_array.bounding_box();
-            volume->indexed_vertex_array.finalize_geometry(m_use_VBOs && m_initialized);
+            GLVolume* volume = volumes[filter_id];
+            if (volume != nullptr)
+            {
+                volume->indexed_vertex_array.finalize_geometry(m_use_VBOs && m_initialized);
+                m_volumes.volumes.emplace_back(volume);
+            }
         }
     }
 }
@@ -135,7 +135,7 @@ void ObjectList::set_tooltip_for_item(const wxPoint& pt)
     else if (col->GetTitle() == _("Name") &&
         m_objects_model->GetBitmap(item).GetRefData() == m_bmp_manifold_warning.GetRefData()) {
         int obj_idx = m_objects_model->GetIdByItem(item);
-        auto& stats = (*m_objects)[obj_idx]->volumes[0]->mesh.stl.stats;
+        auto& stats = (*m_objects)[obj_idx]->volumes[0]->mesh().stl.stats;
         int errors = stats.degenerate_facets + stats.edges_fixed + stats.facets_removed +
             stats.facets_added + stats.facets_reversed + stats.backwards_edges;
 
@@ -1090,7 +1090,7 @@ bool ObjectList::is_splittable()
     if (!get_volume_by_item(item, volume) || !volume)
         return false;
 
-    TriangleMeshPtrs meshptrs = volume->mesh.split();
+    TriangleMeshPtrs meshptrs = volume->mesh().split();
     bool splittable = meshptrs.size() > 1;
     for (TriangleMesh* m : meshptrs) { delete m; }
 
@@ -1202,7 +1202,7 @@ void ObjectList::add_object_to_list(size_t obj_idx)
                       model_object->config.option<ConfigOptionInt>("extruder")->value);
 
     // Add error icon if detected auto-repaire
-    auto stats = model_object->volumes[0]->mesh.stl.stats;
+    auto stats = model_object->volumes[0]->mesh().stl.stats;
     int errors = stats.degenerate_facets + stats.edges_fixed + stats.facets_removed +
         stats.facets_added + stats.facets_reversed + stats.backwards_edges;
     if (errors > 0) {
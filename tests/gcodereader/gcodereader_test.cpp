@@ -0,0 +1,53 @@
+#include <libslic3r/GCodeReader.hpp>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "test_utils.hpp"
+
+using namespace Slic3r;
+using test::check;
+
+// Parses the G-code both line by line and through the batch decoder, returning the lines seen by the callback.
+static std::vector<GCodeReader::GCodeLine> parse(const std::string &gcode, bool batch)
+{
+    std::vector<GCodeReader::GCodeLine> out;
+    GCodeReader reader;
+    auto callback = [&out](GCodeReader&, const GCodeReader::GCodeLine &line) { out.emplace_back(line); };
+    if (batch) {
+        GCodeReader::DecodedLines lines;
+        reader.decode_buffer(gcode.data(), gcode.data() + gcode.size(), lines);
+        reader.parse_decoded(lines, callback);
+    } else
+        reader.parse_buffer(gcode, callback);
+    return out;
+}
+
+int main()
+{
+    for (bool batch : { false, true }) {
+        std::vector<GCodeReader::GCodeLine> lines = parse("G92 E\nG1 X 10 Y5\nG92 E Z2 ; comment\nG1 Xabc Y1\n", batch);
+        check(lines.size() == 4, "number of lines");
+        if (lines.size() != 4)
+            continue;
+
+        // A bare axis letter reads zero, so that "G92 E" resets the extruder only.
+        check(lines[0].has(E) && lines[0].e() == 0.f, "G92 E sets E");
+        check(! lines[0].has(X) && ! lines[0].has(Y) && ! lines[0].has(Z), "G92 E sets E only");
+        float value = 1.f;
+        check(lines[0].has_value('E', value) && value == 0.f, "G92 E has_value");
+
+        // The blanks between the axis letter and its value are skipped.
+        check(lines[1].has(X) && lines[1].x() == 10.f, "G1 X 10 sets X");
+        check(lines[1].has(Y) && lines[1].y() == 5.f, "G1 X 10 Y5 sets Y");
+        check(lines[1].has_value('X', value) && value == 10.f, "G1 X 10 has_value");
+
+        check(lines[2].has(E) && lines[2].e() == 0.f && lines[2].has(Z) && lines[2].z() == 2.f, "G92 E Z2");
+
+        // A word, which is not a number, does not set the axis.
+        check(! lines[1].has(Z), "missing axis");
+        check(! lines[3].has(X) && lines[3].has(Y) && lines[3].y() == 1.f, "G1 Xabc Y1");
+    }
+    return test::report();
+}
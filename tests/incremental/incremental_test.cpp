@@ -0,0 +1,162 @@
+#include <libslic3r/ExtrusionEntity.hpp>
+#include <libslic3r/ExtrusionEntityCollection.hpp>
+#include <libslic3r/Layer.hpp>
+#include <libslic3r/Model.hpp>
+#include <libslic3r/Print.hpp>
+#include <libslic3r/TriangleMesh.hpp>
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "test_utils.hpp"
+
+using namespace Slic3r;
+using test::check;
+
+// Z span of the infill modifier, in the object coordinates.
+static const double modifier_min_z = 4.;
+static const double modifier_max_z = 6.;
+
+// A 20x20x10mm cube with a modifier changing the infill density in the middle of its height.
+static void make_model(Model &model, const std::string &modifier_fill_density)
+{
+    ModelObject *object = model.add_object();
+    object->name = "cube";
+    object->add_volume(make_cube(20., 20., 10.));
+    TriangleMesh modifier_mesh = make_cube(20., 20., modifier_max_z - modifier_min_z);
+    modifier_mesh.translate(0.f, 0.f, float(modifier_min_z));
+    ModelVolume *modifier = object->add_volume(modifier_mesh);
+    modifier->set_type(ModelVolume::PARAMETER_MODIFIER);
+    modifier->config.set_deserialize("fill_density", modifier_fill_density);
+    ModelInstance *instance = object->add_instance();
+    instance->set_offset(Vec3d(100., 100., 0.));
+}
+
+static void process(Print &print, const Model &model, const DynamicPrintConfig &config)
+{
+    print.set_status_silent();
+    print.apply(model, config);
+    print.process();
+}
+
+static void dump_entity(std::ostream &out, const ExtrusionEntity &entity)
+{
+    if (const ExtrusionPath *path = dynamic_cast<const ExtrusionPath*>(&entity)) {
+        out << "path " << int(path->role()) << " " << path->mm3_per_mm << " " << path->width << " " << path->height;
+        for (const Point &pt : path->polyline.points)
+            out << " " << pt(0) << "," << pt(1);
+        out << "\n";
+    } else if (const ExtrusionMultiPath *multipath = dynamic_cast<const ExtrusionMultiPath*>(&entity)) {
+        out << "multipath\n";
+        for (const ExtrusionPath &path : multipath->paths)
+            dump_entity(out, path);
+    } else if (const ExtrusionLoop *loop = dynamic_cast<const ExtrusionLoop*>(&entity)) {
+        out << "loop\n";
+        for (const ExtrusionPath &path : loop->paths)
+            dump_entity(out, path);
+    } else if (const ExtrusionEntityCollection *collection = dynamic_cast<const ExtrusionEntityCollection*>(&entity)) {
+        out << "collection\n";
+        for (const ExtrusionEntity *ee : collection->entities)
+            dump_entity(out, *ee);
+    }
+}
+
+// Perimeters and infill of each layer of the single object of the print, as text.
+static std::vector<std::string> dump_layers(const Print &print)
+{
+    std::vector<std::string> out;
+    for (const Layer *layer : print.objects().front()->layers()) {
+        std::ostringstream ss;
+        for (const LayerRegion *layerm : layer->regions()) {
+            ss << "perimeters\n";
+            dump_entity(ss, layerm->perimeters);
+            ss << "fills\n";
+            dump_entity(ss, layerm->fills);
+        }
+        out.emplace_back(ss.str());
+    }
+    return out;
+}
+
+// Addresses of the perimeter and infill entities of each layer. The entities of a layer, which has not been
+// reprocessed, keep their addresses.
+static std::vector<std::vector<const ExtrusionEntity*>> layer_entities(const Print &print)
+{
+    std::vector<std::vector<const ExtrusionEntity*>> out;
+    for (const Layer *layer : print.objects().front()->layers()) {
+        out.emplace_back();
+        for (const LayerRegion *layerm : layer->regions()) {
+            out.back().insert(out.back().end(), layerm->perimeters.entities.begin(), layerm->perimeters.entities.end());
+            out.back().insert(out.back().end(), layerm->fills.entities.begin(), layerm->fills.entities.end());
+        }
+    }
+    return out;
+}
+
+int main()
+{
+    std::unique_ptr<DynamicPrintConfig> config(DynamicPrintConfig::new_from_defaults());
+    config->set_deserialize("layer_height", "0.2");
+    config->set_deserialize("first_layer_height", "0.2");
+    config->set_deserialize("fill_density", "20%");
+    config->set_deserialize("skirts", "0");
+    // Print::apply() passes the preset names to the placeholder parser.
+    for (const char *key : { "print_settings_id", "filament_settings_id", "printer_settings_id" })
+        config->set_deserialize(key, "");
+
+    // Slice, then change the infill density of the modifier and slice again.
+    Model model;
+    make_model(model, "40%");
+    Print print;
+    process(print, model, *config);
+    std::vector<std::string>                         layers_before   = dump_layers(print);
+    std::vector<std::vector<const ExtrusionEntity*>> entities_before = layer_entities(print);
+
+    model.objects.front()->volumes.back()->config.set_deserialize("fill_density", "70%");
+    check(print.apply(model, *config) != Print::APPLY_STATUS_UNCHANGED, "modifier change invalidates the print");
+    print.process();
+    std::vector<std::string>                         layers_after   = dump_layers(print);
+    std::vector<std::vector<const ExtrusionEntity*>> entities_after = layer_entities(print);
+
+    // Slice the modified model from scratch.
+    Model model_scratch;
+    make_model(model_scratch, "70%");
+    Print print_scratch;
+    process(print_scratch, model_scratch, *config);
+    std::vector<std::string> layers_scratch = dump_layers(print_scratch);
+
+    check(layers_after.size() == layers_scratch.size(), "number of layers");
+    check(layers_after.size() == entities_before.size(), "number of layers kept");
+    if (layers_after.size() != layers_scratch.size() || layers_after.size() != entities_before.size())
+        return test::report();
+
+    // The reprocessed print matches the print sliced from scratch.
+    size_t num_mismatched = 0;
+    for (size_t i = 0; i < layers_after.size(); ++ i)
+        if (layers_after[i] != layers_scratch[i])
+            ++ num_mismatched;
+    check(num_mismatched == 0, "reprocessed layers match the layers sliced from scratch");
+
+    // The layers of the modifier were regenerated with the new density, the layers away from the modifier
+    // were left untouched.
+    const LayerPtrs &layers = print.objects().front()->layers();
+    size_t num_changed   = 0;
+    size_t num_untouched = 0;
+    size_t num_far       = 0;
+    for (size_t i = 0; i < layers.size(); ++ i) {
+        const Layer *layer = layers[i];
+        if (layer->slice_z > modifier_min_z + 0.5 && layer->slice_z < modifier_max_z - 0.5 && layers_before[i] != layers_after[i])
+            ++ num_changed;
+        if (layer->slice_z < modifier_min_z - 1. || layer->slice_z > modifier_max_z + 1.) {
+            ++ num_far;
+            if (entities_before[i] == entities_after[i])
+                ++ num_untouched;
+        }
+    }
+    check(num_changed > 0, "layers of the modifier changed");
+    check(num_far > 0 && num_untouched == num_far, "layers away from the modifier were not reprocessed");
+
+    return test::report();
+}
@@ -0,0 +1,99 @@
+#include <libslic3r/ExPolygon.hpp>
+#include <libslic3r/Rasterizer/Rasterizer.hpp>
+
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "test_utils.hpp"
+
+using namespace Slic3r;
+using test::check;
+
+static const Raster::Resolution resolution(320, 240);
+static const Raster::PixelDim   pixel_dim(0.1, 0.1);
+
+// Star shaped polygon around center, with num_points vertices at random distances from the center.
+static Polygon random_star(std::mt19937 &rng, const Vec2d &center, double min_radius, double max_radius, size_t num_points)
+{
+    std::uniform_real_distribution<double> radius(min_radius, max_radius);
+    Polygon out;
+    for (size_t i = 0; i < num_points; ++ i) {
+        double angle = 2. * PI * double(i) / double(num_points);
+        double r     = radius(rng);
+        out.points.emplace_back(Point::new_scale(center(0) + r * cos(angle), center(1) + r * sin(angle)));
+    }
+    return out;
+}
+
+// Random ExPolygons spread over the raster and beyond its border, some of them with a hole.
+static ExPolygons random_expolygons(std::mt19937 &rng, size_t num_expolygons)
+{
+    const double width_mm  = resolution.width_px  * pixel_dim.w_mm;
+    const double height_mm = resolution.height_px * pixel_dim.h_mm;
+    std::uniform_real_distribution<double> x(- 5., width_mm  + 5.);
+    std::uniform_real_distribution<double> y(- 5., height_mm + 5.);
+    std::uniform_real_distribution<double> size(0.05, 10.);
+    std::uniform_int_distribution<size_t>  num_points(3, 40);
+    ExPolygons out;
+    for (size_t i = 0; i < num_expolygons; ++ i) {
+        Vec2d  center(x(rng), y(rng));
+        double r = size(rng);
+        ExPolygon expoly;
+        expoly.contour = random_star(rng, center, 0.6 * r, r, num_points(rng));
+        if (i % 2 == 0) {
+            Polygon hole = random_star(rng, center, 0.2 * r, 0.5 * r, num_points(rng));
+            hole.make_clockwise();
+            expoly.holes.emplace_back(std::move(hole));
+        }
+        out.emplace_back(std::move(expoly));
+    }
+    // A rectangle covering the whole raster and crossing all of its borders.
+    out.emplace_back();
+    out.back().contour.points = { Point::new_scale(- 1., - 1.), Point::new_scale(width_mm + 1., - 1.),
+                                  Point::new_scale(width_mm + 1., height_mm + 1.), Point::new_scale(- 1., height_mm + 1.) };
+    Polygon hole = random_star(rng, Vec2d(0.5 * width_mm, 0.5 * height_mm), 0.3 * height_mm, 0.45 * height_mm, 64);
+    hole.make_clockwise();
+    out.back().holes.emplace_back(std::move(hole));
+    return out;
+}
+
+static std::string save(Raster &raster, Raster::Compression compression)
+{
+    std::stringstream ss;
+    raster.save(ss, compression);
+    return ss.str();
+}
+
+int main()
+{
+    std::mt19937 rng(12345);
+    for (Raster::Origin origin : { Raster::Origin::BOTTOM_LEFT, Raster::Origin::TOP_LEFT }) {
+        Raster buffer(resolution, pixel_dim, origin, Raster::Storage::BUFFER);
+        Raster spans (resolution, pixel_dim, origin, Raster::Storage::SPANS);
+        // The rasters are reused for the layers, as the SLA printer does.
+        for (size_t layer = 0; layer < 20; ++ layer) {
+            buffer.clear();
+            spans.clear();
+            // Just the rectangle on the first layer, a single random ExPolygon on the second.
+            ExPolygons expolygons = random_expolygons(rng, layer * 3);
+            if (layer == 1)
+                expolygons.erase(expolygons.begin() + 1, expolygons.end());
+            for (const ExPolygon &expoly : expolygons) {
+                buffer.draw(expoly);
+                spans.draw(expoly);
+            }
+            std::string raw_buffer = save(buffer, Raster::Compression::RAW);
+            std::string raw_spans  = save(spans,  Raster::Compression::RAW);
+            // The raw raster is a PGM header followed by the pixels.
+            check(raw_buffer.size() > size_t(resolution.pixels()), "size of the raw raster");
+            check(raw_buffer.find_first_not_of('\0', raw_buffer.size() - resolution.pixels()) != std::string::npos, "raster is not empty");
+            check(raw_buffer == raw_spans, "raw rasters of the buffer and spans storages match");
+            check(save(buffer, Raster::Compression::PNG) == save(spans, Raster::Compression::PNG),
+                  "png rasters of the buffer and spans storages match");
+        }
+    }
+    return test::report();
+}
@@ -0,0 +1,38 @@
+#ifndef slic3r_tests_test_utils_hpp_
+#define slic3r_tests_test_utils_hpp_
+
+// Minimal harness shared by the test executables: the failed checks are printed and counted,
+// main() returns the exit code of report().
+
+#include <cstdio>
+
+namespace Slic3r {
+namespace test {
+
+// Number of the failed checks of the test executable.
+inline int& num_failed()
+{
+    static int n = 0;
+    return n;
+}
+
+inline void check(bool condition, const char *what)
+{
+    if (! condition) {
+        printf("FAILED: %s\n", what);
+        ++ num_failed();
+    }
+}
+
+// Print the summary, return the exit code of the test executable.
+inline int report()
+{
+    if (num_failed() == 0)
+        printf("All tests passed.\n");
+    return num_failed() == 0 ? 0 : 1;
+}
+
+} // namespace test
+} // namespace Slic3r
+
+#endif /* slic3r_tests_test_utils_hpp_ */
@@ -4,7 +4,7 @@ use strict;
 use warnings;
 
 use Slic3r::XS;
-use Test::More tests => 3;
+use Test::More tests => 4;
 
 {
     my $collection = Slic3r::Polyline::Collection->new(
@@ -32,4 +32,16 @@ use Test::More tests => 3;
         'chained_path_from';
 }
 
+{
+    # Of the end points at the same distance from the start point, the first one wins.
+    my $collection = Slic3r::Polyline::Collection->new(
+        Slic3r::Polyline->new([10,0], [20,0]),
+        Slic3r::Polyline->new([-10,0], [-20,0]),
+    );
+    is_deeply
+        [ map $_->x, map @$_, @{$collection->chained_path_from(Slic3r::Point->new(0,0), 0)} ],
+        [10, 20, -10, -20],
+        'chained_path_from breaks ties by the lower index';
+}
+
 __END__